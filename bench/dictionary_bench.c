@@ -0,0 +1,312 @@
+/*
+	dictionary_bench.c
+
+	Compares the open-addressed DICTIONARY in ../util/dictionary.c against
+	the original fixed 10000-slot chained dictionary (copied below as
+	LEGACY_DICT, with its inline 2049 byte keys and tail walk in addData).
+
+	INPUT: dictionary_bench [NUM KEYS]...	(default 10000 50000 100000)
+	       dictionary_bench -s			(scaling run of the new dictionary only)
+
+	OUTPUT: for each size, the seconds spent inserting every key, looking
+		every key up again, and the approximate bytes used by each
+		dictionary.
+		With -s, builds dictionaries of 10k to 10M keys and prints the
+		time per insertion, which should stay flat as the size grows.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../util/header.h"
+#include "../util/hash.h"
+#include "../util/dictionary.h"
+
+// -------------------------------------
+// ---- THE ORIGINAL DICTIONARY CODE ----
+// -------------------------------------
+
+#define LEGACY_KEY_LENGTH 2049
+#define LEGACY_MAX_HASH_SLOT 10000
+
+typedef struct _LEGACY_DNODE
+{
+	struct _LEGACY_DNODE *next;
+	struct _LEGACY_DNODE *prev;
+	void* data;
+	char key[LEGACY_KEY_LENGTH];
+} LEGACY_DNODE;
+
+typedef struct _LEGACY_DICT
+{
+	LEGACY_DNODE* hash[LEGACY_MAX_HASH_SLOT];
+	LEGACY_DNODE* start;
+	LEGACY_DNODE* end;
+} LEGACY_DICT;
+
+static int legacyHash(char* string)
+{
+	return (hash1(string) % LEGACY_MAX_HASH_SLOT);
+}
+
+static LEGACY_DICT* legacyInitializeDict()
+{
+	LEGACY_DICT* dict = malloc(sizeof(LEGACY_DICT));
+	MALLOC_CHECK(dict);
+	BZERO(dict, sizeof(LEGACY_DICT));
+
+	return dict;
+}
+
+static int legacyAddData(LEGACY_DICT* dict, void* data, char* key)
+{
+	int hash_index;
+	LEGACY_DNODE* currentdnode;
+	LEGACY_DNODE* newdnode;
+
+	hash_index = legacyHash(key);
+	newdnode = malloc(sizeof(LEGACY_DNODE));
+	MALLOC_CHECK(newdnode);
+	newdnode->data = data;
+	BZERO(newdnode->key, LEGACY_KEY_LENGTH);
+	strncpy(newdnode->key, key, LEGACY_KEY_LENGTH - 1);
+
+	if((dict->hash[hash_index]) != NULL)
+	{
+		currentdnode = dict->hash[hash_index];
+
+		while( 1 )
+		{
+			if(strcmp(currentdnode->key, key) == 0)
+			{
+				free(newdnode);
+				return 1;
+			}
+
+			if(currentdnode->next == NULL || legacyHash(currentdnode->next->key) != hash_index)
+				break;
+			else
+				currentdnode = currentdnode->next;
+		}
+
+		newdnode->next = currentdnode->next;
+		newdnode->prev = currentdnode;
+
+		if((currentdnode->next) != NULL)
+			currentdnode->next->prev = newdnode;
+
+		currentdnode->next = newdnode;
+	}
+	else
+	{
+		currentdnode = dict->start;
+
+		if(currentdnode != NULL)
+		{
+			while(currentdnode->next != NULL)
+				currentdnode = currentdnode->next;
+
+			currentdnode->next = newdnode;
+		}
+		else
+			dict->start = newdnode;
+
+		newdnode->next = NULL;
+		newdnode->prev = currentdnode;
+		dict->end = newdnode;
+		dict->hash[hash_index] = newdnode;
+	}
+
+	return 0;
+}
+
+static LEGACY_DNODE* legacyGetData(LEGACY_DICT* dict, char* key)
+{
+	LEGACY_DNODE* dnode = dict->hash[legacyHash(key)];
+
+	while(dnode != NULL)
+	{
+		if(strcmp(dnode->key, key) == 0)
+			break;
+		else
+			dnode = dnode->next;
+	}
+
+	return dnode;
+}
+
+static void legacyCleanDict(LEGACY_DICT* dict)
+{
+	LEGACY_DNODE* current = dict->start;
+	LEGACY_DNODE* next;
+
+	while(current != NULL)
+	{
+		next = current->next;
+		free(current);
+		current = next;
+	}
+
+	free(dict);
+}
+
+// -----------------------
+// ---- THE BENCHMARK ----
+// -----------------------
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// fills keys with num_keys distinct, word-like strings
+static char** makeKeys(int num_keys)
+{
+	char** keys = malloc(num_keys * sizeof(char*));
+	MALLOC_CHECK(keys);
+
+	for(int i = 0; i < num_keys; i++)
+	{
+		keys[i] = malloc(32);
+		MALLOC_CHECK(keys[i]);
+
+		int length = 3 + rand() % 8;
+		for(int j = 0; j < length; j++)
+			keys[i][j] = 'a' + rand() % 26;
+
+// the suffix keeps every key distinct
+		sprintf(keys[i] + length, "%x", i);
+	}
+
+	return keys;
+}
+
+static void benchmark(char** keys, int num_keys)
+{
+	struct timespec start;
+	double legacy_insert, legacy_lookup, insert, lookup;
+	long legacy_bytes, bytes;
+	int found;
+
+	LEGACY_DICT* legacy_dict;
+	DICTIONARY* dict;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	legacy_dict = legacyInitializeDict();
+	for(int i = 0; i < num_keys; i++)
+		legacyAddData(legacy_dict, NULL, keys[i]);
+	legacy_insert = secondsSince(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	found = 0;
+	for(int i = 0; i < num_keys; i++)
+		found += (legacyGetData(legacy_dict, keys[i]) != NULL);
+	legacy_lookup = secondsSince(&start);
+	MYASSERT(found == num_keys);
+
+	legacy_bytes = sizeof(LEGACY_DICT) + (long)num_keys * sizeof(LEGACY_DNODE);
+	legacyCleanDict(legacy_dict);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	dict = initializeDict();
+	for(int i = 0; i < num_keys; i++)
+		addData(dict, NULL, keys[i]);
+	insert = secondsSince(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	found = 0;
+	for(int i = 0; i < num_keys; i++)
+		found += (getData(dict, keys[i]) != NULL);
+	lookup = secondsSince(&start);
+	MYASSERT(found == num_keys);
+
+	bytes = sizeof(DICTIONARY) + (long)dict->num_slots * sizeof(DSLOT);
+	for(DNODE* node = dict->start; node != NULL; node = node->next)
+		bytes += sizeof(DNODE) + node->key_length + 1;
+	cleanDict(dict);
+
+	printf("%9d   legacy: insert %8.3fs  lookup %8.3fs  %11ld bytes\n", num_keys, legacy_insert, legacy_lookup, legacy_bytes);
+	printf("%9s   new:    insert %8.3fs  lookup %8.3fs  %11ld bytes\n", "", insert, lookup, bytes);
+}
+
+// writes the i'th scaling key into key (distinct for every i)
+static void scalingKey(char* key, unsigned long i)
+{
+	unsigned long mixed = (i + 1) * 0x9e3779b97f4a7c15UL;
+
+	sprintf(key, "%c%c%lx", 'a' + (int)(mixed % 26), 'a' + (int)((mixed >> 8) % 26), i);
+}
+
+// builds dictionaries of 10k, 100k, 1M and 10M keys, timing insertion
+static void scalingBenchmark()
+{
+	struct timespec start;
+	char key[32];
+	double seconds;
+	long num_keys;
+
+	DICTIONARY* dict;
+
+	printf("%9s %10s %12s %10s\n", "keys", "seconds", "ns/insert", "slots");
+
+	for(num_keys = 10000; num_keys <= 10000000; num_keys *= 10)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		dict = initializeDict();
+		for(long i = 0; i < num_keys; i++)
+		{
+			scalingKey(key, i);
+			addData(dict, NULL, key);
+		}
+		seconds = secondsSince(&start);
+
+		MYASSERT(dict->num_entries == num_keys);
+		printf("%9ld %10.3f %12.1f %10d\n", num_keys, seconds, seconds * 1e9 / num_keys, dict->num_slots);
+
+		cleanDict(dict);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int default_sizes[] = { 10000, 50000, 100000 };
+	int num_keys;
+	char** keys;
+
+	srand(1);
+
+	if(argc == 2 && strcmp(argv[1], "-s") == 0)
+	{
+		scalingBenchmark();
+		return 0;
+	}
+
+	for(int i = 0; i < (argc > 1 ? argc - 1 : 3); i++)
+	{
+		num_keys = (argc > 1) ? atoi(argv[i + 1]) : default_sizes[i];
+
+		if(num_keys <= 0)
+		{
+			fprintf(stderr, "%s: Bad number of keys: %s\n", argv[0], argv[i + 1]);
+			return 1;
+		}
+
+		keys = makeKeys(num_keys);
+		benchmark(keys, num_keys);
+
+		for(int j = 0; j < num_keys; j++)
+			free(keys[j]);
+		free(keys);
+	}
+
+	return 0;
+}
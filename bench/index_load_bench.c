@@ -0,0 +1,240 @@
+/*
+	index_load_bench.c
+
+	Compares readTextIndex in ../util/indexfile.c against the fscanf based
+	readIndex it replaced (copied below as legacyReadIndex), loading the
+	same text index file with both.
+
+	INPUT: index_load_bench [-j THREADS] [MEGABYTES]	(default 1024 MB, 4 threads)
+	       index_load_bench [-j THREADS] -f [INDEX FILE]
+
+	OUTPUT: the seconds each loader takes (readTextIndex with 1 thread and
+		with THREADS threads) and the MB/s that works out to.  Every load
+		is checked against the legacy one.
+		Without -f, a synthetic text index of about MEGABYTES megabytes is
+		written to index_load_bench.dat first (and removed afterwards).
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../util/header.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/indexfile.h"
+
+#define GENERATED_FILE_NAME "index_load_bench.dat"
+
+// ------------------------------
+// ---- THE ORIGINAL LOADER ----
+// ------------------------------
+
+static INVERTED_INDEX* legacyReadIndex(char* file_name)
+{
+	FILE* fp;
+	INVERTED_INDEX* new_index;
+
+	char *word;
+	int page_count;
+	int page;
+	int count;
+
+	WordNode* wordnode;
+	PostingList* postings;
+
+	if((fp = fopen(file_name, "r")) == NULL)
+		return NULL;
+
+	new_index = initializeDict();
+
+	word = malloc(500*sizeof(char));
+	MALLOC_CHECK(word);
+	BZERO(word, 500*sizeof(char));
+
+	while(fscanf(fp, "%s %d", word, &page_count) == 2)
+	{
+		if((wordnode = getData(new_index, word)) != NULL)
+			postings = wordnode->data;
+		else
+		{
+			postings = initializePostings(page_count);
+			addData(new_index, postings, word);
+		}
+
+		for(int i = 0; i < page_count; i++)
+		{
+			fscanf(fp, "%d %d", &page, &count);
+			appendPosting(postings, page, count);
+		}
+
+		sortPostings(postings);
+	}
+
+	free(word);
+	fclose(fp);
+
+	return new_index;
+}
+
+// -----------------------
+// ---- THE BENCHMARK ----
+// -----------------------
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// writes a text index of about megabytes MB to file_name, with a few very
+// common words and a long tail of rare ones.  Returns 0 if it succeeds.
+static int generateIndex(char* file_name, long megabytes)
+{
+	FILE* fp;
+	unsigned long mixed;
+	int num_docs, doc_id;
+
+	if((fp = fopen(file_name, "w")) == NULL)
+		return 1;
+
+	for(long i = 0; ftell(fp) < megabytes * 1024 * 1024; i++)
+	{
+		mixed = (i + 1) * 0x9e3779b97f4a7c15UL;
+		num_docs = (i % 100 == 0) ? 1 + rand() % 20000 : 1 + rand() % 40;
+		doc_id = 0;
+
+		fprintf(fp, "%c%c%lx %d ", 'a' + (int)(mixed % 26), 'a' + (int)((mixed >> 8) % 26), i, num_docs);
+
+		for(int d = 0; d < num_docs; d++)
+		{
+			doc_id += 1 + rand() % 50;
+			fprintf(fp, "%d %d ", doc_id, 1 + (rand() % 4 == 0 ? rand() % 30 : 0));
+		}
+
+		fprintf(fp, "\n");
+	}
+
+	return (fclose(fp) != 0);
+}
+
+// returns a checksum of every word and posting in index, in order
+static unsigned long checksum(INVERTED_INDEX* index, long* num_postings)
+{
+	unsigned long sum = 0;
+	PostingList* postings;
+
+	*num_postings = 0;
+
+	for(WordNode* node = index->start; node != NULL; node = node->next)
+	{
+		postings = node->data;
+		sum = sum * 31 + node->hash_value;
+
+		for(int i = 0; i < postings->num_docs; i++)
+			sum = sum * 31 + postings->doc_ids[i] * 7919UL + postings->frequencies[i];
+
+		*num_postings += postings->num_docs;
+	}
+
+	return sum;
+}
+
+// loads file_name with the legacy loader (num_threads 0) or readTextIndex, printing
+// how long it took.  Returns the index's checksum.
+static unsigned long benchmark(char* file_name, long bytes, int num_threads)
+{
+	struct timespec start;
+	INVERTED_INDEX* index;
+	unsigned long sum;
+	long num_postings;
+	double seconds;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	index = (num_threads == 0) ? legacyReadIndex(file_name) : readTextIndex(file_name, num_threads);
+	seconds = secondsSince(&start);
+	MYASSERT(index != NULL);
+
+	sum = checksum(index, &num_postings);
+
+	if(num_threads == 0)
+		printf("%-26s", "legacy readIndex:");
+	else
+		printf("readTextIndex %2d thread%s: ", num_threads, num_threads == 1 ? " " : "s");
+
+	printf("%8.3fs  %8.1f MB/s  (%d words, %ld postings)\n", seconds, bytes / seconds / 1024 / 1024, index->num_entries, num_postings);
+
+	cleanIndex(index);
+
+	return sum;
+}
+
+int main(int argc, char* argv[])
+{
+	char* file_name = GENERATED_FILE_NAME;
+	long megabytes = 1024;
+	int num_threads = 4;
+	int generated = 1;
+	unsigned long legacy_sum;
+	FILE* fp;
+	long bytes;
+	int arg;
+
+	srand(1);
+
+	for(arg = 1; arg < argc; arg++)
+	{
+		if(strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+			num_threads = atoi(argv[++arg]);
+		else if(strcmp(argv[arg], "-f") == 0 && arg + 1 < argc)
+		{
+			file_name = argv[++arg];
+			generated = 0;
+		}
+		else
+			megabytes = atol(argv[arg]);
+	}
+
+	if(num_threads < 1 || num_threads > MAX_READ_THREADS || megabytes <= 0)
+	{
+		fprintf(stderr, "%s: Requires [-j THREADS] [MEGABYTES | -f INDEX FILE]\n", argv[0]);
+		return 1;
+	}
+
+	if(generated)
+	{
+		printf("writing a %ld MB text index to %s\n", megabytes, file_name);
+
+		if(generateIndex(file_name, megabytes))
+		{
+			fprintf(stderr, "%s: Could not write %s\n", argv[0], file_name);
+			return 1;
+		}
+	}
+
+	if((fp = fopen(file_name, "r")) == NULL || fseek(fp, 0, SEEK_END) != 0 || (bytes = ftell(fp)) <= 0)
+	{
+		fprintf(stderr, "%s: Could not read %s\n", argv[0], file_name);
+		return 1;
+	}
+
+	fclose(fp);
+
+	legacy_sum = benchmark(file_name, bytes, 0);
+	MYASSERT(benchmark(file_name, bytes, 1) == legacy_sum);
+
+	if(num_threads > 1)
+		MYASSERT(benchmark(file_name, bytes, num_threads) == legacy_sum);
+
+	if(generated)
+		remove(file_name);
+
+	return 0;
+}
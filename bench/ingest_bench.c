@@ -0,0 +1,187 @@
+/*
+	ingest_bench.c
+
+	Compares the ways the indexer can read a crawl: one file at a time with
+	openDocument (../util/file.c), and INGEST_QUEUE_DEPTH files at a time with
+	an INGEST (../util/ingest.c) through io_uring and through its thread pool.
+
+	INPUT: ingest_bench [-c] [-d DEPTH] DIRECTORY
+
+	       -c	drop each file from the page cache before every pass
+			(posix_fadvise DONTNEED), so the reads go to the disk
+	       -d	the INGEST queue depth (default INGEST_QUEUE_DEPTH)
+
+	OUTPUT: the seconds and MB/s of each way over the files in DIRECTORY,
+		listed with getFileList.  Every way is checked to hand out the
+		same files, in the same order, with the same contents.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "../util/header.h"
+#include "../util/file.h"
+#include "../util/ingest.h"
+
+#define PASSES 3
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// adds length bytes at contents to the checksum *sum, along with the file's position in the list
+static void addToSum(unsigned long* sum, int file, char* contents, long length)
+{
+	unsigned long h = 5381 + file;
+
+	for(long i = 0; i < length; i++)
+		h = h * 33 + (unsigned char)contents[i];
+
+	*sum = *sum * 31 + h;
+}
+
+// asks the kernel to drop the num_files files in files from the page cache
+static void dropFiles(struct dirent** files, int num_files)
+{
+	int fd;
+
+	for(int i = 0; i < num_files; i++)
+	{
+		if((fd = open(files[i]->d_name, O_RDONLY)) == -1)
+			continue;
+
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+// reads every file with openDocument, returning the number of bytes
+static long readDocuments(struct dirent** files, int num_files, unsigned long* sum)
+{
+	DOCUMENT document;
+	long bytes = 0;
+
+	initializeDocument(&document);
+
+	for(int i = 0; i < num_files; i++)
+	{
+		if(openDocument(&document, files[i]->d_name) == 0)
+		{
+			addToSum(sum, i, document.contents, document.length);
+			bytes += document.length;
+			closeDocument(&document);
+		}
+	}
+
+	cleanDocument(&document);
+
+	return bytes;
+}
+
+// reads every file with an INGEST, returning the number of bytes (and setting *used to the method it used)
+static long readIngested(struct dirent** files, int num_files, int depth, int method, int* used, unsigned long* sum)
+{
+	INGEST* ingest = startIngest(files, num_files, depth, method);
+	DOCUMENT* document;
+	long bytes = 0;
+	int file;
+
+	*used = ingest->method;
+
+	while((document = nextIngested(ingest, &file)) != NULL)
+	{
+		addToSum(sum, file, document->contents, document->length);
+		bytes += document->length;
+	}
+
+	finishIngest(ingest);
+
+	return bytes;
+}
+
+int main(int argc, char* argv[])
+{
+	static char* names[] = { "openDocument, one at a time", "INGEST with io_uring", "INGEST with threads" };
+	struct dirent** files;
+	struct timespec start;
+	unsigned long expected_sum = 0;
+	unsigned long sum;
+	long bytes;
+	double seconds;
+	int num_files;
+	int drop = 0;
+	int depth = INGEST_QUEUE_DEPTH;
+	int used = -1;
+	int arg;
+
+	for(arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if(strcmp(argv[arg], "-c") == 0)
+			drop = 1;
+		else if(strcmp(argv[arg], "-d") == 0 && arg + 1 < argc && atoi(argv[arg + 1]) > 0)
+			depth = atoi(argv[++arg]);
+		else
+		{
+			fprintf(stderr, "%s: Unknown option %s\n", argv[0], argv[arg]);
+			return 1;
+		}
+	}
+
+	if(arg != argc - 1 || !directoryExists(argv[arg]) || (num_files = getFileList(argv[arg], &files)) <= 0)
+	{
+		fprintf(stderr, "usage: %s [-c] [-d DEPTH] DIRECTORY\n", argv[0]);
+		return 1;
+	}
+
+	chdir(argv[arg]);
+
+	for(int way = 0; way < 3; way++)
+	{
+		for(int pass = 0; pass < PASSES; pass++)
+		{
+			if(drop)
+				dropFiles(files, num_files);
+
+			sum = 0;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			if(way == 0)
+				bytes = readDocuments(files, num_files, &sum);
+			else
+				bytes = readIngested(files, num_files, depth, (way == 1) ? INGEST_IO_URING : INGEST_THREAD_POOL, &used, &sum);
+
+			seconds = secondsSince(&start);
+
+			if(way == 0 && pass == 0)
+				expected_sum = sum;
+
+			MYASSERT(sum == expected_sum);
+
+			printf("%-30s %8.3fs  %8.1f MB/s%s\n", names[way], seconds, bytes / seconds / 1e6,
+				(way == 1 && used != INGEST_IO_URING) ? "  (no io_uring, used threads)" : "");
+		}
+	}
+
+	printf("%d files, queue depth %d%s\n", num_files, depth, drop ? ", cold cache" : "");
+
+	for(int i = 0; i < num_files; i++)
+		free(files[i]);
+
+	free(files);
+
+	return 0;
+}
@@ -0,0 +1,212 @@
+/*
+	intersect_bench.c
+
+	Compares the ways of intersecting two sorted lists of document ids (see
+	../util/intersect.h): merging, galloping, and comparing blocks at each
+	level of SIMD (scalar, SSE2, AVX2), for a long list and a short one
+	from the same length down to 1/SKEW_LIMIT of its length.
+
+	INPUT: intersect_bench [LONG LENGTH]	(default 1000000 ids)
+
+	OUTPUT: for each skew (how many times longer the long list is), the
+		microseconds each way takes, and the way intersectSorted picks.
+		Levels the processor doesn't support are skipped.  Every way's
+		matches are checked to be the same as merging's.
+		The lists are drawn from ids up to 4 times the long length, with
+		a quarter of the short list's ids taken from the long list, so
+		they overlap about as much as the words of a query do.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../util/header.h"
+#include "../util/intersect.h"
+
+#define SKEW_LIMIT 4096
+#define MIN_BENCH_SECONDS 0.2
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int compareIds(const void* a, const void* b)
+{
+	return (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b);
+}
+
+// sorts the num_ids ids and drops the ones there twice, returning how many are left
+static int sortIds(int* ids, int num_ids)
+{
+	int kept = 0;
+
+	qsort(ids, num_ids, sizeof(int), compareIds);
+
+	for(int i = 0; i < num_ids; i++)
+		if(kept == 0 || ids[kept - 1] != ids[i])
+			ids[kept++] = ids[i];
+
+	return kept;
+}
+
+// fills ids with num_ids random ids under max_id (a quarter of them from others if it isn't
+// NULL), returning how many different ones there are once sorted
+static int generateIds(int* ids, int num_ids, int max_id, int* others, int num_others)
+{
+	for(int i = 0; i < num_ids; i++)
+		ids[i] = (others != NULL && i % 4 == 0) ? others[rand() % num_others] : rand() % max_id;
+
+	return sortIds(ids, num_ids);
+}
+
+// returns the microseconds method takes to intersect a and b (intersectSorted if it's -1),
+// repeating it for at least MIN_BENCH_SECONDS
+static double timeMethod(int method, int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+	struct timespec start;
+	double seconds;
+	long runs = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do
+	{
+		if(method < 0)
+			intersectSorted(a, num_a, b, num_b, a_matches, b_matches);
+		else
+			intersectWith(method, a, num_a, b, num_b, a_matches, b_matches);
+		runs++;
+	} while((seconds = secondsSince(&start)) < MIN_BENCH_SECONDS);
+
+	return seconds / runs * 1e6;
+}
+
+// returns 1 if method finds the same num_expected matches as expected_a and expected_b
+static int sameMatches(int method, int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches,
+	int* expected_a, int* expected_b, int num_expected)
+{
+	int num_found;
+
+	if(method < 0)
+		num_found = intersectSorted(a, num_a, b, num_b, a_matches, b_matches);
+	else
+		num_found = intersectWith(method, a, num_a, b, num_b, a_matches, b_matches);
+
+	return num_found == num_expected && memcmp(a_matches, expected_a, num_found * sizeof(int)) == 0 &&
+		memcmp(b_matches, expected_b, num_found * sizeof(int)) == 0;
+}
+
+int main(int argc, char** argv)
+{
+	char* level_names[] = { "scalar", "SSE2", "AVX2" };
+	char* method_names[] = { "merge", "gallop", "blocks" };
+	long long_length = 1000000;
+
+	int* long_ids;
+	int* short_ids;
+	int* a_matches;
+	int* b_matches;
+	int* expected_a;
+	int* expected_b;
+	int num_long;
+	int num_short;
+	int num_expected;
+	int picked;
+	int num_levels;
+	int default_level = intersectLevel();
+
+	if(argc > 2 || (argc == 2 && (long_length = atol(argv[1])) < 1))
+	{
+		fprintf(stderr, "%s: Requires [LONG LENGTH]\n", argv[0]);
+		return 1;
+	}
+
+	long_ids = malloc(long_length * sizeof(int));
+	short_ids = malloc(long_length * sizeof(int));
+	a_matches = malloc(long_length * sizeof(int));
+	b_matches = malloc(long_length * sizeof(int));
+	expected_a = malloc(long_length * sizeof(int));
+	expected_b = malloc(long_length * sizeof(int));
+	MALLOC_CHECK(long_ids);
+	MALLOC_CHECK(short_ids);
+	MALLOC_CHECK(a_matches);
+	MALLOC_CHECK(b_matches);
+	MALLOC_CHECK(expected_a);
+	MALLOC_CHECK(expected_b);
+
+	srand(1);
+	num_long = generateIds(long_ids, long_length, long_length * 4, NULL, 0);
+	num_levels = setIntersectLevel(INTERSECT_AVX2) + 1;
+
+	printf("%6s %9s %9s %11s %11s", "skew", "short", "matches", "merge (us)", "gallop (us)");
+
+	for(int level = 0; level < num_levels; level++)
+		printf(" %8s (us)", level_names[level]);
+
+	printf(" %12s\n", "picked (us)");
+
+	for(int skew = 1; skew <= SKEW_LIMIT && long_length / skew > 0; skew *= 2)
+	{
+		num_short = generateIds(short_ids, long_length / skew, long_length * 4, long_ids, num_long);
+
+// merging is the reference the others are checked against
+		num_expected = intersectWith(INTERSECT_MERGE, short_ids, num_short, long_ids, num_long, expected_a, expected_b);
+
+		printf("%6d %9d %9d", skew, num_short, num_expected);
+		printf(" %11.1f", timeMethod(INTERSECT_MERGE, short_ids, num_short, long_ids, num_long, a_matches, b_matches));
+
+		if(!sameMatches(INTERSECT_GALLOP, short_ids, num_short, long_ids, num_long, a_matches, b_matches, expected_a, expected_b, num_expected))
+		{
+			fprintf(stderr, "\n%s: galloping differs from merging at skew %d\n", argv[0], skew);
+			return 1;
+		}
+
+		printf(" %11.1f", timeMethod(INTERSECT_GALLOP, short_ids, num_short, long_ids, num_long, a_matches, b_matches));
+
+		for(int level = 0; level < num_levels; level++)
+		{
+			setIntersectLevel(level);
+
+// (the long list goes first here, to check the matches come back the right way round)
+			if(!sameMatches(INTERSECT_BLOCKS, long_ids, num_long, short_ids, num_short, b_matches, a_matches, expected_b, expected_a, num_expected))
+			{
+				fprintf(stderr, "\n%s: %s blocks differ from merging at skew %d\n", argv[0], level_names[level], skew);
+				return 1;
+			}
+
+			printf(" %13.1f", timeMethod(INTERSECT_BLOCKS, short_ids, num_short, long_ids, num_long, a_matches, b_matches));
+		}
+
+// intersectSorted is timed at the level it picks itself
+		setIntersectLevel(default_level);
+
+		if(!sameMatches(-1, short_ids, num_short, long_ids, num_long, a_matches, b_matches, expected_a, expected_b, num_expected))
+		{
+			fprintf(stderr, "\n%s: intersectSorted differs from merging at skew %d\n", argv[0], skew);
+			return 1;
+		}
+
+		picked = (num_long / num_short >= GALLOP_RATIO) ? INTERSECT_GALLOP : INTERSECT_BLOCKS;
+		printf(" %6s %5.1f\n", method_names[picked], timeMethod(-1, short_ids, num_short, long_ids, num_long, a_matches, b_matches));
+		fflush(stdout);
+	}
+
+	free(long_ids);
+	free(short_ids);
+	free(a_matches);
+	free(b_matches);
+	free(expected_a);
+	free(expected_b);
+
+	return 0;
+}
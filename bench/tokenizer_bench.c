@@ -0,0 +1,302 @@
+/*
+	tokenizer_bench.c
+
+	Compares the span TOKENIZER in ../util/html.c against the parseHTML +
+	NormalizeWord pair the indexer used before it, over the same pages,
+	with each level of scans (scalar, SSE2, AVX2, see ../util/textscan.h).
+
+	INPUT: tokenizer_bench [DIRECTORY]	(default: 2000 synthetic pages)
+
+	OUTPUT: the tokens per second of parseHTML + NormalizeWord, then for
+		each level the processor supports, of nextLowercaseToken,
+		nextToken + lowercaseToken, and nextToken alone.  The words every
+		tokenizer finds (lower cased) are checked to be the same, first on
+		FUZZ_PAGES random pages of tag characters, letters and odd bytes.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "../util/header.h"
+#include "../util/html.h"
+#include "../util/file.h"
+#include "../util/dictionary.h"
+#include "../util/textscan.h"
+
+#define NUM_SYNTHETIC_PAGES 2000
+#define PASSES 5
+#define FUZZ_PAGES 20000
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// returns a page that looks like a crawled one: a URL and depth line, then HTML with
+// tags, mixed case words, punctuation and the odd '>' inside a word
+static char* makePage()
+{
+	static char* tags[] = { "<p>", "</p>", "<a href=\"http://www.cs.dartmouth.edu/index.html\">", "</a>",
+		"<div class=\"Main\">", "</div>", "<!-- a comment -->", "<br/>", "<td align=left>" };
+	static char* words[] = { "the", "Dartmouth", "college", "COMPUTER", "science", "of", "and", "search",
+		"Engine", "x", "page", "links", "to", "about", "Hanover", "a>b", "research" };
+	int length = 2000 + rand() % 20000;
+	char* page = malloc(length + 64);
+	int position;
+
+	MALLOC_CHECK(page);
+	position = sprintf(page, "http://www.cs.dartmouth.edu/page%d.html\n1\n<html>", rand());
+
+	while(position < length)
+	{
+		if(rand() % 4 == 0)
+			position += sprintf(page + position, "%s", tags[rand() % 9]);
+		else
+			position += sprintf(page + position, "%s%s", words[rand() % 17], (rand() % 8 == 0) ? ", " : " ");
+	}
+
+	strcpy(page + position, "</html>\n");
+
+	return page;
+}
+
+// the parseHTML + NormalizeWord pair: returns the number of words in pages, adding their hashes to *sum
+static long parseHTMLPages(char** pages, int num_pages, unsigned long* sum)
+{
+	long num_tokens = 0;
+	char* word;
+	int position;
+
+	for(int i = 0; i < num_pages; i++)
+	{
+		word = malloc(strlen(pages[i]) + 1);
+		MALLOC_CHECK(word);
+		position = 0;
+
+		while((position = parseHTML(pages[i], word, position)) != -1)
+		{
+			NormalizeWord(word);
+			*sum += hash(word);
+			num_tokens++;
+		}
+
+		free(word);
+	}
+
+	return num_tokens;
+}
+
+// the same with nextToken + lowercaseToken (or just nextToken if sum is NULL)
+static long tokenizePages(char** pages, long* lengths, int num_pages, unsigned long* sum)
+{
+	TOKENIZER tokenizer;
+	long num_tokens = 0;
+	char* word;
+	int length;
+
+	for(int i = 0; i < num_pages; i++)
+	{
+		initializeTokenizer(&tokenizer, pages[i], lengths[i]);
+
+		while(nextToken(&tokenizer, &word, &length))
+		{
+			if(sum != NULL)
+				*sum += hash(lowercaseToken(&tokenizer, word, length));
+
+			num_tokens++;
+		}
+
+		cleanTokenizer(&tokenizer);
+	}
+
+	return num_tokens;
+}
+
+// the same with nextLowercaseToken
+static long lowercaseTokenizePages(char** pages, long* lengths, int num_pages, unsigned long* sum)
+{
+	TOKENIZER tokenizer;
+	long num_tokens = 0;
+	char* word;
+	int length;
+
+	for(int i = 0; i < num_pages; i++)
+	{
+		initializeTokenizer(&tokenizer, pages[i], lengths[i]);
+
+		while(nextLowercaseToken(&tokenizer, &word, &length))
+		{
+			*sum += hash(word);
+			num_tokens++;
+		}
+
+		cleanTokenizer(&tokenizer);
+	}
+
+	return num_tokens;
+}
+
+// checks every level against parseHTML on short random pages made of the characters
+// the scans treat specially.  Returns the number of pages that came out differently.
+static int fuzz()
+{
+	static char alphabet[] = "aZz<>\n !@[`{\x80\xff\xc1";
+	char page[200];
+	unsigned long expected_sum, sum;
+	long expected_tokens, tokens;
+	long length;
+	char* pointer = page;
+	int failures = 0;
+
+	for(int i = 0; i < FUZZ_PAGES; i++)
+	{
+		length = rand() % (sizeof(page) - 1);
+
+		for(int j = 0; j < length; j++)
+			page[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+
+		page[length] = 0;
+
+		expected_sum = 0;
+		expected_tokens = parseHTMLPages(&pointer, 1, &expected_sum);
+
+		for(int level = TEXT_SCAN_SCALAR; level <= TEXT_SCAN_AVX2; level++)
+		{
+			if(setTextScanLevel(level) != level)
+				continue;
+
+			sum = 0;
+			tokens = tokenizePages(&pointer, &length, 1, &sum);
+			failures += (tokens != expected_tokens || sum != expected_sum);
+
+			sum = 0;
+			tokens = lowercaseTokenizePages(&pointer, &length, 1, &sum);
+			failures += (tokens != expected_tokens || sum != expected_sum);
+		}
+	}
+
+	return failures;
+}
+
+int main(int argc, char* argv[])
+{
+	struct dirent** files = NULL;
+	struct timespec start;
+	char** pages;
+	long* lengths;
+	int num_pages = 0;
+	int num_files = 0;
+	unsigned long parse_sum = 0;
+	unsigned long token_sum = 0;
+	long parse_tokens = 0;
+	long token_tokens = 0;
+	long span_tokens = 0;
+	double seconds;
+
+	srand(1);
+
+	if(fuzz() != 0)
+	{
+		fprintf(stderr, "%s: The tokenizer found different words than parseHTML\n", argv[0]);
+		return 1;
+	}
+
+	if(argc > 1)
+	{
+		if(!directoryExists(argv[1]) || (num_files = getFileList(argv[1], &files)) <= 0)
+		{
+			fprintf(stderr, "%s: Bad directory %s\n", argv[0], argv[1]);
+			return 1;
+		}
+
+		chdir(argv[1]);
+	}
+
+	pages = malloc((num_files > 0 ? num_files : NUM_SYNTHETIC_PAGES) * sizeof(char*));
+	MALLOC_CHECK(pages);
+
+	if(num_files > 0)
+	{
+		for(int i = 0; i < num_files; i++)
+		{
+			if(regularFile(files[i]->d_name) && (pages[num_pages] = readFile(files[i]->d_name)) != NULL)
+				num_pages++;
+
+			free(files[i]);
+		}
+
+		free(files);
+	}
+	else
+	{
+		for(num_pages = 0; num_pages < NUM_SYNTHETIC_PAGES; num_pages++)
+			pages[num_pages] = makePage();
+	}
+
+	lengths = malloc(num_pages * sizeof(long));
+	MALLOC_CHECK(lengths);
+
+	for(int i = 0; i < num_pages; i++)
+		lengths[i] = strlen(pages[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int pass = 0; pass < PASSES; pass++)
+		parse_tokens += parseHTMLPages(pages, num_pages, &parse_sum);
+	seconds = secondsSince(&start);
+	printf("parseHTML + NormalizeWord:   %8.3fs  %12.0f tokens/s\n", seconds, parse_tokens / seconds);
+
+	for(int level = TEXT_SCAN_SCALAR; level <= TEXT_SCAN_AVX2; level++)
+	{
+		if(setTextScanLevel(level) != level)
+			continue;
+
+		printf("%s scans:\n", level == TEXT_SCAN_SCALAR ? "scalar" : (level == TEXT_SCAN_SSE2 ? "SSE2" : "AVX2"));
+
+		token_sum = 0;
+		token_tokens = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(int pass = 0; pass < PASSES; pass++)
+			token_tokens += lowercaseTokenizePages(pages, lengths, num_pages, &token_sum);
+		seconds = secondsSince(&start);
+		printf("  nextLowercaseToken:          %8.3fs  %12.0f tokens/s\n", seconds, token_tokens / seconds);
+		MYASSERT(token_tokens == parse_tokens && token_sum == parse_sum);
+
+		token_sum = 0;
+		token_tokens = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(int pass = 0; pass < PASSES; pass++)
+			token_tokens += tokenizePages(pages, lengths, num_pages, &token_sum);
+		seconds = secondsSince(&start);
+		printf("  nextToken + lowercaseToken:  %8.3fs  %12.0f tokens/s\n", seconds, token_tokens / seconds);
+		MYASSERT(token_tokens == parse_tokens && token_sum == parse_sum);
+
+		span_tokens = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(int pass = 0; pass < PASSES; pass++)
+			span_tokens += tokenizePages(pages, lengths, num_pages, NULL);
+		seconds = secondsSince(&start);
+		printf("  nextToken (spans only):      %8.3fs  %12.0f tokens/s\n", seconds, span_tokens / seconds);
+		MYASSERT(span_tokens == parse_tokens);
+	}
+
+	printf("%d pages, %ld tokens per pass\n", num_pages, parse_tokens / PASSES);
+
+	for(int i = 0; i < num_pages; i++)
+		free(pages[i]);
+
+	free(pages);
+	free(lengths);
+
+	return 0;
+}
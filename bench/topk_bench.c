@@ -0,0 +1,221 @@
+/*
+	topk_bench.c
+
+	Compares the ways the query engine can rank the pages matching a query:
+	the bubble sort sortResults used to do (copied below as legacySort),
+	a full sort (sortDocuments in ../util/topk.c) and keeping only the best
+	K in a heap (TOP_K in ../util/topk.c), for queries matching from 10 to
+	1,000,000 pages.
+
+	INPUT: topk_bench [-k K] [MAX MATCHES]	(default K 10, 1000000 matches)
+
+	OUTPUT: for 10, 100, ... MAX MATCHES matching pages, the microseconds
+		each way takes to rank one query's matches.  The legacy sort is
+		skipped past LEGACY_MAX_MATCHES matches (it's quadratic).  The
+		heap's results are checked against the first K of the full sort,
+		and the full sort against the legacy sort.
+		The matches are in page id order (the order sortResults finds them
+		in), with skewed ranks so there are plenty of ties.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../util/header.h"
+#include "../util/dictionary.h"
+#include "../util/topk.h"
+
+#define LEGACY_MAX_MATCHES 10000
+#define MIN_BENCH_SECONDS 0.2
+
+// ------------------------------------
+// ---- THE ORIGINAL (BUBBLE) SORT ----
+// ------------------------------------
+
+static void legacySort(DocumentNode* sorted_results, int num_results)
+{
+	DocumentNode temp;
+	int s = 1;
+
+	for(int i = 0; i < num_results && s != 0; i++)
+	{
+		s = 0;
+
+		for(int j = 0; j < num_results-1; j++)
+		{
+			if(sorted_results[j].page_word_frequency < sorted_results[j+1].page_word_frequency)
+			{
+				temp = sorted_results[j];
+				sorted_results[j] = sorted_results[j+1];
+				sorted_results[j+1] = temp;
+				s++;
+			}
+		}
+	}
+}
+
+// -------------------
+// ---- THE BENCH ----
+// -------------------
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// fills matches with num_matches pages in page id order, most of them ranked 1 to 3 and
+// an eighth of them up to 50
+static void generateMatches(DocumentNode* matches, int num_matches)
+{
+	for(int i = 0; i < num_matches; i++)
+	{
+		matches[i].document_id = i;
+		matches[i].page_word_frequency = 1 + ((rand() % 8 == 0) ? rand() % 50 : rand() % 3);
+	}
+}
+
+// ranks matches into sorted with the method (0 legacy, 1 full sort, 2 heap of k), returning
+// the number of results
+static int rankMatches(int method, DocumentNode* matches, int num_matches, DocumentNode* sorted, int k)
+{
+	TOP_K* top;
+	int num_results;
+
+	if(method == 2)
+	{
+		top = initializeTopK(k);
+
+		for(int i = 0; i < num_matches; i++)
+			offerTopK(top, matches[i].document_id, matches[i].page_word_frequency);
+
+		num_results = finishTopK(top, sorted);
+		cleanTopK(top);
+
+		return num_results;
+	}
+
+	memcpy(sorted, matches, num_matches * sizeof(DocumentNode));
+
+	if(method == 0)
+		legacySort(sorted, num_matches);
+	else
+		sortDocuments(sorted, num_matches);
+
+	return num_matches;
+}
+
+// returns the microseconds the method takes to rank matches, repeating it for at least
+// MIN_BENCH_SECONDS
+static double timeMethod(int method, DocumentNode* matches, int num_matches, DocumentNode* sorted, int k)
+{
+	struct timespec start;
+	double seconds;
+	long runs = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do
+	{
+		rankMatches(method, matches, num_matches, sorted, k);
+		runs++;
+	} while((seconds = secondsSince(&start)) < MIN_BENCH_SECONDS);
+
+	return seconds / runs * 1e6;
+}
+
+// returns 1 if the first num_results of a and b are the same results
+static int sameResults(DocumentNode* a, DocumentNode* b, int num_results)
+{
+	for(int i = 0; i < num_results; i++)
+		if(a[i].document_id != b[i].document_id || a[i].page_word_frequency != b[i].page_word_frequency)
+			return 0;
+
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	int k = 10;
+	long max_matches = 1000000;
+	int arg = 1;
+
+	DocumentNode* matches;
+	DocumentNode* full;
+	DocumentNode* other;
+	int num_kept;
+
+	if(arg + 1 < argc && strcmp(argv[arg], "-k") == 0)
+	{
+		k = atoi(argv[arg + 1]);
+		arg += 2;
+	}
+
+	if(arg < argc)
+		max_matches = atol(argv[arg++]);
+
+	if(arg != argc || k < 1 || max_matches < 1)
+	{
+		fprintf(stderr, "%s: Requires [-k K] [MAX MATCHES]\n", argv[0]);
+		return 1;
+	}
+
+	matches = malloc(max_matches * sizeof(DocumentNode));
+	full = malloc(max_matches * sizeof(DocumentNode));
+	other = malloc(max_matches * sizeof(DocumentNode));
+	MALLOC_CHECK(matches);
+	MALLOC_CHECK(full);
+	MALLOC_CHECK(other);
+
+	srand(1);
+
+	printf("%10s %14s %14s %14s\n", "matches", "legacy (us)", "full sort (us)", "top k (us)");
+
+	for(long num_matches = 10; num_matches <= max_matches; num_matches *= 10)
+	{
+		generateMatches(matches, num_matches);
+
+// checks every method gives the same results first
+		rankMatches(1, matches, num_matches, full, k);
+		num_kept = rankMatches(2, matches, num_matches, other, k);
+
+		if(num_kept != (num_matches < k ? num_matches : k) || !sameResults(full, other, num_kept))
+		{
+			fprintf(stderr, "%s: top %d differs from the full sort for %ld matches\n", argv[0], k, num_matches);
+			return 1;
+		}
+
+		if(num_matches <= LEGACY_MAX_MATCHES)
+		{
+			rankMatches(0, matches, num_matches, other, k);
+
+			if(!sameResults(full, other, num_matches))
+			{
+				fprintf(stderr, "%s: the full sort differs from the legacy sort for %ld matches\n", argv[0], num_matches);
+				return 1;
+			}
+
+			printf("%10ld %14.1f", num_matches, timeMethod(0, matches, num_matches, other, k));
+		}
+		else
+			printf("%10ld %14s", num_matches, "-");
+
+		printf(" %14.1f", timeMethod(1, matches, num_matches, other, k));
+		printf(" %14.1f\n", timeMethod(2, matches, num_matches, other, k));
+		fflush(stdout);
+	}
+
+	free(matches);
+	free(full);
+	free(other);
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+	union_bench.c
+
+	Compares the ways the query engine can OR the clauses of a query (see
+	../util/losertree.h): adding each clause's matches to an ACCUMULATOR
+	and ending the clause there (which keeps each page's best clause rank),
+	and merging the clauses a page at a time in a LOSER_TREE and adding
+	each page once.  Both end with the pages in an ACCUMULATOR, as
+	buildResults leaves them.  Where the tree wins is where buildResults
+	uses it (see OR_TREE_CLAUSES in ../queryengine/query.h).
+
+	INPUT: union_bench [MAX DOCUMENTS]	(default 10000000 page ids)
+
+	OUTPUT: for 2 to MAX_CLAUSES clauses of 1000 to 1000000 matches each
+		(out of MAX DOCUMENTS pages), the microseconds each way takes
+		with a sparse and a dense ACCUMULATOR.  The ranks each way
+		leaves are checked to be the same.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../util/header.h"
+#include "../util/postings.h"
+#include "../util/accumulator.h"
+#include "../util/losertree.h"
+
+#define MAX_CLAUSES 16
+#define MIN_BENCH_SECONDS 0.2
+
+// returns the seconds elapsed since start
+static double secondsSince(struct timespec* start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// returns a clause's matches: num_matches random pages under max_documents (fewer if some
+// come up twice), ranked 1 to 10
+static PostingList* generateClause(int num_matches, int max_documents)
+{
+	PostingList* clause = initializePostings(num_matches);
+	int kept = 0;
+
+	for(int i = 0; i < num_matches; i++)
+		appendPosting(clause, rand() % max_documents, 1 + rand() % 10);
+
+	sortPostings(clause);
+
+// (a page twice keeps its first rank)
+	for(int i = 0; i < clause->num_docs; i++)
+	{
+		if(kept == 0 || clause->doc_ids[kept - 1] != clause->doc_ids[i])
+		{
+			clause->doc_ids[kept] = clause->doc_ids[i];
+			clause->frequencies[kept++] = clause->frequencies[i];
+		}
+	}
+
+	clause->num_docs = kept;
+
+	return clause;
+}
+
+// ORs the clauses into accumulator with the method (0 a clause at a time, 1 a loser tree)
+static void orClauses(int method, PostingList** clauses, int num_clauses, ACCUMULATOR* accumulator)
+{
+	LOSER_TREE* tree;
+	int page_id;
+	int rank;
+
+	if(method == 0)
+	{
+		for(int c = 0; c < num_clauses; c++)
+		{
+			addPostings(accumulator, clauses[c]);
+			endClause(accumulator);
+		}
+
+		return;
+	}
+
+	tree = initializeLoserTree(clauses, num_clauses);
+
+	while(nextDocument(tree, &page_id, &rank))
+		addRank(accumulator, page_id, rank);
+
+	cleanLoserTree(tree);
+	endClause(accumulator);
+}
+
+// returns the microseconds the method takes to OR the clauses (and empty accumulator again),
+// repeating it for at least MIN_BENCH_SECONDS
+static double timeMethod(int method, PostingList** clauses, int num_clauses, ACCUMULATOR* accumulator)
+{
+	struct timespec start;
+	double seconds;
+	long runs = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do
+	{
+		orClauses(method, clauses, num_clauses, accumulator);
+		resetAccumulator(accumulator);
+		runs++;
+	} while((seconds = secondsSince(&start)) < MIN_BENCH_SECONDS);
+
+	return seconds / runs * 1e6;
+}
+
+// returns 1 if both methods leave the same ranks for every page of the clauses
+static int sameRanks(PostingList** clauses, int num_clauses, ACCUMULATOR* accumulator, ACCUMULATOR* other)
+{
+	int same = 1;
+
+	orClauses(0, clauses, num_clauses, accumulator);
+	orClauses(1, clauses, num_clauses, other);
+
+	for(int c = 0; c < num_clauses && same; c++)
+		for(int i = 0; i < clauses[c]->num_docs && same; i++)
+			same = accumulatedRank(accumulator, clauses[c]->doc_ids[i]) == accumulatedRank(other, clauses[c]->doc_ids[i]);
+
+	same = same && accumulator->num_touched == other->num_touched;
+
+	resetAccumulator(accumulator);
+	resetAccumulator(other);
+
+	return same;
+}
+
+int main(int argc, char** argv)
+{
+	int max_documents = 10000000;
+
+	PostingList* clauses[MAX_CLAUSES];
+	ACCUMULATOR* accumulators[2];
+	ACCUMULATOR* other;
+	long total;
+
+	if(argc > 2 || (argc == 2 && (max_documents = atoi(argv[1])) < 1))
+	{
+		fprintf(stderr, "%s: Requires [MAX DOCUMENTS]\n", argv[0]);
+		return 1;
+	}
+
+	accumulators[ACCUMULATE_SPARSE] = initializeAccumulator(max_documents, ACCUMULATE_SPARSE);
+	accumulators[ACCUMULATE_DENSE] = initializeAccumulator(max_documents, ACCUMULATE_DENSE);
+	other = initializeAccumulator(max_documents, ACCUMULATE_SPARSE);
+
+	srand(1);
+
+	printf("%8s %8s %10s %18s %18s %18s %18s\n", "clauses", "matches", "pages", "sparse clauses", "sparse tree",
+		"dense clauses", "dense tree");
+
+	for(int num_matches = 1000; num_matches <= 1000000 && num_matches <= max_documents; num_matches *= 10)
+	{
+		for(int num_clauses = 2; num_clauses <= MAX_CLAUSES; num_clauses *= 2)
+		{
+			total = 0;
+
+			for(int c = 0; c < num_clauses; c++)
+			{
+				clauses[c] = generateClause(num_matches, max_documents);
+				total += clauses[c]->num_docs;
+			}
+
+			if(!sameRanks(clauses, num_clauses, accumulators[ACCUMULATE_SPARSE], other))
+			{
+				fprintf(stderr, "%s: the loser tree differs from the clauses for %d clauses of %d\n", argv[0], num_clauses, num_matches);
+				return 1;
+			}
+
+			printf("%8d %8d %10ld", num_clauses, num_matches, total);
+
+			for(int mode = ACCUMULATE_SPARSE; mode <= ACCUMULATE_DENSE; mode++)
+			{
+				printf(" %13.1f (us)", timeMethod(0, clauses, num_clauses, accumulators[mode]));
+				printf(" %13.1f (us)", timeMethod(1, clauses, num_clauses, accumulators[mode]));
+			}
+
+			printf("\n");
+			fflush(stdout);
+
+			for(int c = 0; c < num_clauses; c++)
+				cleanPostings(clauses[c]);
+		}
+	}
+
+	for(int mode = ACCUMULATE_SPARSE; mode <= ACCUMULATE_DENSE; mode++)
+		cleanAccumulator(accumulators[mode]);
+
+	cleanAccumulator(other);
+
+	return 0;
+}
@@ -120,6 +120,7 @@ int page_number = 0; // a count of all the pages being download (from 1 to n)
 int url_index;       // a global variable whose value is the final index in url_list
 
 DICTIONARY* dict;    // the main data structure
+DNODE* frontier;     // where getAddressFromTheLinksToBeVisited resumes its search
 
 int main(int argc, char *argv[])
 {
@@ -180,13 +181,7 @@ int main(int argc, char *argv[])
   	dict = initializeDict();
 
 // links the seednode into the dictionary as a dnode
-	dict->start = dict->end = malloc(sizeof(DNODE));
-  	MALLOC_CHECK(dict->start); 
-  	dict->start->prev = dict->start->next = NULL;
-  	dict->hash[hash(seed_url)] = dict->start;
-  	dict->start->data = seednode;
-  	BZERO(dict->start->key, KEY_LENGTH);
-  	strncpy(dict->start->key, seed_url, KEY_LENGTH);
+	addData(dict, seednode, seed_url);
 
 // puts new urls into the doubly linked list to be crawled later
   	updateListLinkToBeVisited(++current_depth);
@@ -240,6 +235,8 @@ void cleanUp()
 }
 
 // getAddressFromTheLinksToBeVisited returns the next unvisited url at the specified depth (current_depth)
+// urls are appended to the list in order of depth and visited in list order, so the search
+// resumes at frontier (the last node it looked at) instead of rescanning from the start
 char* getAddressFromTheLinksToBeVisited(int current_depth)
 {
   	DNODE* current;
@@ -247,10 +244,12 @@ char* getAddressFromTheLinksToBeVisited(int current_depth)
   	int visited;
   	int depth;
 
-  	current = dict->start; 							// starts with the first node
+  	current = (frontier != NULL) ? frontier : dict->start;		// starts where the last search stopped
   
   	while(current != NULL)
   	{
+		frontier = current;
+
     		unode = (URLNODE*)(current->data);				// pulls the urlnode out of it
 
     		visited = unode->visited;
@@ -258,6 +257,8 @@ char* getAddressFromTheLinksToBeVisited(int current_depth)
  
     		if(visited == 0 && depth == current_depth)			// checks to see if it's unvisited and at the right depth, and if so returns it
       			return (unode->url);
+    		else if(depth > current_depth)					// everything after this is deeper still
+      			return NULL;
     		else
       			current = current->next;				// if not, cycles through the remaining nodes
   	}
@@ -0,0 +1,164 @@
+/*
+	compact.c
+
+	Deletes documents from an index file, and compacts it (the indexer's
+	--delete and --compact options).
+
+	Deleting a document only sets its bit in the index's tombstones
+	([INDEX FILE].deleted, see ../util/tombstones.h), so it takes the same
+	time however big the index is, and the query engine stops returning it as
+	soon as it opens the index again.  Its postings stay in the index until it
+	is compacted.
+
+	Compacting reads the index, and if the deleted documents are at least
+	threshold percent of the documents in it, drops their postings (and the
+	words left without any), rewrites the index in the format it was in, and
+	then clears their bits.  The new index replaces the old one with a rename,
+	so a query engine that has the old one open keeps searching it, and
+	documents deleted while the compaction runs stay deleted.  Positions
+	(see ../util/positions.h) are left as they are: phrase queries only read
+	the positions of documents still in the index.  Biwords (see
+	../util/biwords.h) answer phrases on their own, so the deleted documents
+	are dropped from them too, before their bits are cleared.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dirent.h>
+
+#include "indexer.h"
+#include "../util/header.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/indexfile.h"
+#include "../util/tombstones.h"
+#include "../util/biwords.h"
+
+// deleteDocuments marks the num_documents document ids in documents (strings) deleted from
+// index_file_name.  Returns 0 if it succeeds and 1 if any of them fails.
+int deleteDocuments(char* index_file_name, char** documents, int num_documents)
+{
+	char* end;
+	long doc_id;
+	int failed = 0;
+
+	for(int i = 0; i < num_documents; i++)
+	{
+		doc_id = strtol(documents[i], &end, 10);
+
+		if(end == documents[i] || *end != 0 || doc_id < 0 || doc_id > 999999999 ||
+			deleteDocument(index_file_name, doc_id))
+		{
+			fprintf(stderr, "Could not delete document %s from %s\n", documents[i], index_file_name);
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
+
+// compactIndexFile compacts index_file_name as described at the top, if at least threshold percent
+// of its documents are deleted.  Prints how many were deleted if report is 1.  Returns 0 if it
+// succeeds (whether or not the index needed compacting) and 1 if it fails.
+int compactIndexFile(char* index_file_name, int threshold, int num_threads, int report)
+{
+	INVERTED_INDEX* index;
+	INVERTED_INDEX* biwords;
+	TOMBSTONES* tombstones;
+	PostingList* postings;
+	char* seen;
+	char* dropped;
+	int highest;
+	int num_documents = 0;
+	int num_deleted = 0;
+	int format;
+	int compact;
+	int failed;
+
+	if((tombstones = readTombstones(index_file_name)) == NULL)
+	{
+		if(report)
+			printf("%s: no documents deleted\n", index_file_name);
+
+		return 0;
+	}
+
+	format = indexFormat(index_file_name);
+
+	if((index = readIndex(index_file_name)) == NULL)
+	{
+		fprintf(stderr, "Could not read index file %s\n", index_file_name);
+		cleanTombstones(tombstones);
+		return 1;
+	}
+
+// (an empty index has no documents, but still gets arrays of one)
+	if((highest = maxIndexDocument(index)) < 0)
+		highest = 0;
+
+	seen = malloc(highest + 1);
+	MALLOC_CHECK(seen);
+	BZERO(seen, highest + 1);
+
+	dropped = malloc(highest + 1);
+	MALLOC_CHECK(dropped);
+	BZERO(dropped, highest + 1);
+
+// counts the documents in the index, and the deleted ones among them
+	for(WordNode* wordnode = index->start; wordnode != NULL; wordnode = wordnode->next)
+	{
+		postings = wordnode->data;
+
+		for(int i = 0; i < postings->num_docs; i++)
+		{
+			if(postings->doc_ids[i] < 0 || seen[postings->doc_ids[i]])
+				continue;
+
+			seen[postings->doc_ids[i]] = 1;
+			dropped[postings->doc_ids[i]] = isTombstoned(tombstones, postings->doc_ids[i]);
+			num_documents++;
+			num_deleted += dropped[postings->doc_ids[i]];
+		}
+	}
+
+	compact = (num_deleted > 0 && (long)num_deleted * 100 >= (long)threshold * num_documents);
+	failed = 0;
+
+	if(compact)
+	{
+		index = dropDocuments(index, dropped, highest);
+		failed = replaceIndexFile(index, index_file_name, format, num_threads);
+
+// every pair's documents are in the index, so dropped covers them
+		if(!failed && (biwords = readBiwords(index_file_name)) != NULL)
+		{
+			biwords = dropDocuments(biwords, dropped, highest);
+			failed = writeBiwords(biwords, index_file_name);
+			cleanIndex(biwords);
+		}
+
+		if(report)
+			printf("%s: %d of %d documents deleted, compacted\n", index_file_name, num_deleted, num_documents);
+	}
+	else if(report)
+		printf("%s: %d of %d documents deleted, under %d%%, not compacted\n", index_file_name, num_deleted, num_documents, threshold);
+
+// only the dropped documents are undeleted (a deleted document that isn't in the index file may
+// be in one of its segments, see ../util/segments.h)
+	if(!failed && compact)
+	{
+		keepTombstones(tombstones, dropped, highest);
+		failed = clearTombstones(index_file_name, tombstones);
+	}
+
+	free(seen);
+	free(dropped);
+	cleanTombstones(tombstones);
+	cleanIndex(index);
+
+	return failed;
+}
@@ -0,0 +1,104 @@
+/*
+
+  FILE: indexconvert.c
+
+  Description: Converts an index file between the text and binary formats (see ../util/indexfile.h)
+	       and the mapped format (see ../util/mapindex.h).
+
+  Inputs: ./indexconvert [-t | -b | -m] [INPUT INDEX FILE] [OUTPUT INDEX FILE]
+
+	  -t writes the text format, -b the binary format, -m the mapped format.  Without any of
+	  them, a text index is written in the binary format and any other in the text format.
+
+  Outputs: [OUTPUT INDEX FILE], holding the same words (in the same order) and postings.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "../util/header.h"
+#include "../util/file.h"
+#include "../util/dictionary.h"
+#include "../util/indexfile.h"
+#include "../util/mapindex.h"
+
+// the output formats
+#define TEXT_OUTPUT 0
+#define BINARY_OUTPUT 1
+#define MAPPED_OUTPUT 2
+
+int main(int argc, char *argv[])
+{
+	char* program;
+	char* input_file_name;
+	char* output_file_name;
+	int output_format;		// one of the formats above, -1 until it's known
+	int failed;
+
+	INVERTED_INDEX* index;
+
+	program = argv[0];
+	output_format = -1;
+
+	if(argc == 4)
+	{
+		if(strcmp(argv[1], "-t") == 0)
+			output_format = TEXT_OUTPUT;
+		else if(strcmp(argv[1], "-b") == 0)
+			output_format = BINARY_OUTPUT;
+		else if(strcmp(argv[1], "-m") == 0)
+			output_format = MAPPED_OUTPUT;
+		else
+		{
+			fprintf(stderr, "%s: Unknown option %s\n", program, argv[1]);
+			return 1;
+		}
+
+		argc--;
+		argv++;
+	}
+
+	if(argc != 3)
+	{
+		fprintf(stderr, "%s: Requires [-t | -b | -m] [INPUT INDEX FILE] [OUTPUT INDEX FILE] as arguments.\n", program);
+		return 1;
+	}
+
+	input_file_name = argv[1];
+	output_file_name = argv[2];
+
+	if(!regularFile(input_file_name))
+	{
+		fprintf(stderr, "%s: Bad index file: %s\n", program, input_file_name);
+		return 1;
+	}
+
+	if(output_format == -1)
+		output_format = (isBinaryIndex(input_file_name) || isMappedIndex(input_file_name)) ? TEXT_OUTPUT : BINARY_OUTPUT;
+
+	if((index = readIndex(input_file_name)) == NULL)
+	{
+		fprintf(stderr, "%s: Could not read index file %s\n", program, input_file_name);
+		return 1;
+	}
+
+	if(output_format == BINARY_OUTPUT)
+		failed = writeBinaryIndex(index, output_file_name);
+	else if(output_format == MAPPED_OUTPUT)
+		failed = writeMappedIndex(index, output_file_name);
+	else
+		failed = writeTextIndex(index, output_file_name, 1);
+
+	cleanIndex(index);
+
+	if(failed)
+	{
+		fprintf(stderr, "%s: Could not write %s\n", program, output_file_name);
+		return 1;
+	}
+
+	return 0;
+}
@@ -4,21 +4,54 @@
 
   Description:
 
-  Inputs: ./indexer [TARGET DIRECTORY] [OUTPUT FILE NAME] 						-- regular functionality
-	  ./indexer [TARGET DIRECTORY] [OUTPUT FILE NAME] [INPUT FILE NAME] [TEST OUTPUT FILE NAME]	-- testing
+  Inputs: ./indexer [OPTIONS] [TARGET DIRECTORY] [OUTPUT FILE NAME] 						-- regular functionality
+	  ./indexer [OPTIONS] [TARGET DIRECTORY] [OUTPUT FILE NAME] [INPUT FILE NAME] [TEST OUTPUT FILE NAME]	-- testing
+	  ./indexer --update [OPTIONS] [TARGET DIRECTORY] [INDEX FILE NAME]					-- updating
+	  ./indexer --delete [INDEX FILE NAME] [DOCUMENT ID]...							-- deleting
+	  ./indexer --compact [OPTIONS] [INDEX FILE NAME]							-- compacting
+
+  Options: -j N		index (and format the output) with N threads (see parallelindex.c); the index is identical to
+				the one built with 1
+	   -m MB		keep the in-memory index under MB megabytes, building it in sorted runs on disk (see spimi.c);
+			the index holds the same lines, sorted by word
+	   -b		save the index in the binary format (see ../util/indexfile.h) instead of the text format
+	   -s		leave out the words in <script> and <style> elements and <!-- --> comments (inline
+				JavaScript, CSS and commented out HTML), which makes the index smaller
+	   -p		also save where each word occurs in each document in [OUTPUT FILE NAME].positions (see
+				../util/positions.h), for the query engine's phrase queries; can't be used with -j or -m
+	   -w DOCS	also save the pairs of adjacent words found in at least DOCS documents in
+				[OUTPUT FILE NAME].biwords (see ../util/biwords.h), which answer common two-word phrases
+				without reading positions; can't be used with -j or -m
+	   -r		report the number of words and postings in the index and its size in bytes (or, with --update,
+				how many documents were new, changed and removed, or with --compact, how many were deleted)
+	   --update	only index the documents in [TARGET DIRECTORY] that are new or changed since [INDEX FILE NAME]
+				was built or last updated, replacing their old postings and dropping removed documents
+				(see update.c); the index keeps its format, and -s must match the build
+	   --delete	mark the documents deleted from [INDEX FILE NAME] in [INDEX FILE NAME].deleted, without
+				reading or rewriting the index; the query engine leaves them out of its results (see compact.c)
+	   --compact	drop the postings of the deleted documents from [INDEX FILE NAME], if they're at least
+				10 percent (COMPACT_THRESHOLD) of its documents; the index keeps its format (see compact.c)
+	   -t PERCENT	compact when at least PERCENT percent of the documents are deleted (0 always compacts)
 
   Outputs: In the regular functionality mode, it ouputs an index [OUTPUT FILE NAME] outlining the occurences of each words contained in the documents in
 	   [TARGET DIRECTORY] in the following format: "computer 2 1 6 7 10", which means the word "computer" occured in "2" documents.  Specifically, 
 	   it occured in the document whose ID is "1" 6 times, and in the document whose ID is "2" 10 times.
+	   Next to it goes a manifest, [OUTPUT FILE NAME].manifest, listing the documents it was built from for --update.
+	   A rebuilt index has no deleted documents or segments (see ../util/segments.h), so any
+	   [OUTPUT FILE NAME].deleted and segments the query engine's -l wrote are removed, and so are
+	   old positions and biwords if it's rebuilt without -p and -w.
 	   In the testing mode, it does what the regular functionality does, and also reads in an index file, recreates data structures from it,
 	   and outputs it once again.  This is simply to check and make sure the index file is readable by a computer (for the query engine later).
 
   Data Structures: An index, which is a dictionary data structure.  It contains parameters that point to the first and last node in a doubly linked list,
- 		   and a hash table whose hash values point to various nodes in the linked list (for faster retrieval).
+ 		   and an open-addressed hash table whose slots point to the nodes in the linked list (for faster retrieval).
 		   The nodes pointed to by the dictionary are DNODEs, but in this case, they're called WordNodes.  A WordNode has 4 properties: prev and
-		   and next which point to other WordNodes, data which points to a void* (in this case a DocumentNode), and a key (which is a string).
-		   DocumentNodes have 3 parameters: next, which points to another DocumentNode, document_id which is its id, and page_count_occurence
-                   which refers to the number of times the word occured on that page.
+		   and next which point to other WordNodes, data which points to a void* (in this case a PostingList), and a key (which is a variable-length string).
+		   A PostingList holds num_docs, the number of documents the word occurs in, and two growable arrays sorted by document id: doc_ids,
+		   and frequencies, which refers to the number of times the word occured on that page.  Files are indexed in numeric order, so new
+		   postings are always appended.
+		   The words of each file are first counted in a DOC_TERMS, a small hash table that's reused for every file, so the index itself is
+		   only updated once per distinct word per file.
 
 */
 
@@ -31,6 +64,7 @@
 #include <string.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -40,7 +74,15 @@
 #include "../util/html.h"
 #include "../util/file.h"
 #include "../util/hash.h"
+#include "../util/postings.h"
 #include "../util/dictionary.h"
+#include "../util/docterms.h"
+#include "../util/indexfile.h"
+#include "../util/ingest.h"
+#include "../util/tombstones.h"
+#include "../util/segments.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
 
 int main(int argc, char *argv[])
 {
@@ -54,26 +96,221 @@ int main(int argc, char *argv[])
 // determines which mode the program is running in
 	int indexer_test_flag;
 
+// the number of threads to index with (-j)
+	int num_threads;
+
+// the memory budget in bytes (-m), 0 if there isn't one
+	long memory_limit;
+
+// 1 if the index is saved in the binary format (-b)
+	int binary_flag;
+
+// 1 if script, style and comment bodies aren't indexed (-s)
+	int skip_code_flag;
+
+// 1 if the index's size is reported (-r)
+	int report_flag;
+
+// 1 if the positions of the words are saved too (-p)
+	int positions_flag;
+
+// the least number of documents a pair of words is saved for (-w), 0 if pairs aren't saved
+	int biword_threshold;
+
+// where the positions and pairs are gathered (with -p or -w)
+	PhraseIndexes phrases;
+
+// 1 if an existing index is brought up to date (--update)
+	int update_flag;
+
+// 1 if documents are deleted from an index (--delete), or it's compacted (--compact)
+	int delete_flag;
+	int compact_flag;
+
+// the percentage of deleted documents --compact starts at (-t)
+	int compact_threshold;
+
+// the documents the index is built from (written next to it for --update)
+	Manifest* manifest;
+
+// position of the first argument that isn't an option
+	int arg;
+
 // overall data structure
 	INVERTED_INDEX* index;
 
-// these variables handle the scandir results and pulling information from files
+// these variables handle the scandir results
 	int numfiles = 0;
 	struct dirent **files;	
-	char* file_name;
-	char* file_contents;
-
-// this variable is used for parsing the HTML
-	int file_pos;
-
-// variables used for WordNode (word == key) and DocumentNode (doc_id)
-	char* word;
-	int doc_id;
 
 	indexer_test_flag = 0; // default is basic funcitonality
+	num_threads = 1;
+	memory_limit = 0;
+	binary_flag = 0;
+	skip_code_flag = 0;
+	report_flag = 0;
+	positions_flag = 0;
+	biword_threshold = 0;
+	BZERO(&phrases, sizeof(phrases));
+	update_flag = 0;
+	delete_flag = 0;
+	compact_flag = 0;
+	compact_threshold = COMPACT_THRESHOLD;
 
 	program = argv[0];
 
+// options come before the other arguments
+	for(arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if(strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+		{
+			num_threads = atoi(argv[++arg]);
+
+			if(num_threads < 1 || num_threads > MAX_INDEX_THREADS)
+			{
+				fprintf(stderr, "%s: -j must be followed by a number of threads between 1 and %d\n", program, MAX_INDEX_THREADS);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[arg], "-m") == 0 && arg + 1 < argc)
+		{
+			memory_limit = atol(argv[++arg]) * 1024 * 1024;
+
+			if(memory_limit <= 0)
+			{
+				fprintf(stderr, "%s: -m must be followed by a memory budget in megabytes\n", program);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[arg], "-b") == 0)
+		{
+			binary_flag = 1;
+		}
+		else if(strcmp(argv[arg], "-s") == 0)
+		{
+			skip_code_flag = 1;
+		}
+		else if(strcmp(argv[arg], "-r") == 0)
+		{
+			report_flag = 1;
+		}
+		else if(strcmp(argv[arg], "-p") == 0)
+		{
+			positions_flag = 1;
+		}
+		else if(strcmp(argv[arg], "-w") == 0 && arg + 1 < argc)
+		{
+			biword_threshold = atoi(argv[++arg]);
+
+			if(biword_threshold < 1)
+			{
+				fprintf(stderr, "%s: -w must be followed by a number of documents (at least 1)\n", program);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[arg], "--update") == 0)
+		{
+			update_flag = 1;
+		}
+		else if(strcmp(argv[arg], "--delete") == 0)
+		{
+			delete_flag = 1;
+		}
+		else if(strcmp(argv[arg], "--compact") == 0)
+		{
+			compact_flag = 1;
+		}
+		else if(strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+		{
+			compact_threshold = atoi(argv[++arg]);
+
+			if(compact_threshold < 0 || compact_threshold > 100)
+			{
+				fprintf(stderr, "%s: -t must be followed by a percentage between 0 and 100\n", program);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "%s: Unknown option %s\n", program, argv[arg]);
+			return 1;
+		}
+	}
+
+	if(memory_limit > 0 && num_threads > 1)
+	{
+		fprintf(stderr, "%s: -m and -j can't be used together\n", program);
+		return 1;
+	}
+
+	if(memory_limit > 0 && binary_flag)
+	{
+		fprintf(stderr, "%s: -m and -b can't be used together (use indexconvert afterwards)\n", program);
+		return 1;
+	}
+
+	if(memory_limit > 0 && report_flag)
+	{
+		fprintf(stderr, "%s: -m and -r can't be used together\n", program);
+		return 1;
+	}
+
+	if((positions_flag || biword_threshold > 0) && (memory_limit > 0 || num_threads > 1 || update_flag || delete_flag || compact_flag))
+	{
+		fprintf(stderr, "%s: -p and -w can't be used with -j, -m, --update, --delete or --compact\n", program);
+		return 1;
+	}
+
+	if(update_flag && (memory_limit > 0 || binary_flag))
+	{
+		fprintf(stderr, "%s: --update can't be used with -m or -b (the index keeps its own format)\n", program);
+		return 1;
+	}
+
+	if(update_flag + delete_flag + compact_flag > 1 || ((delete_flag || compact_flag) && (memory_limit > 0 || binary_flag)))
+	{
+		fprintf(stderr, "%s: --update, --delete and --compact can't be used together, or with -m or -b\n", program);
+		return 1;
+	}
+
+	argc -= arg - 1;
+	argv += arg - 1;
+
+// only the tombstones are changed, the index isn't read
+	if(delete_flag)
+	{
+		if(argc < 3)
+		{
+			fprintf(stderr, "%s: --delete requires the index file name and the ids of the documents to delete\n", program);
+			return 1;
+		}
+
+		return deleteDocuments(argv[1], argv + 2, argc - 2);
+	}
+
+	if(compact_flag)
+	{
+		if(argc != 2 || !regularFile(argv[1]))
+		{
+			fprintf(stderr, "%s: --compact requires the file name of an index\n", program);
+			return 1;
+		}
+
+		if(compactIndexFile(argv[1], compact_threshold, num_threads, report_flag))
+		{
+			fprintf(stderr, "%s: Could not compact %s\n", program, argv[1]);
+			return 1;
+		}
+
+		return 0;
+	}
+
+	if(update_flag && argc != 3)
+	{
+		fprintf(stderr, "%s: --update requires a target directory and the index file name to update\n", program);
+		return 1;
+	}
+
 // if incorrect number of arguments
 	if(argc != 3 && argc != 5)
 	{
@@ -111,171 +348,117 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	index = initializeDict();
-
-// this for loop goes through each file in "files", pulls each word out of the HTML, and updates the index data structure
-	for(int i=0; i < numfiles; i++)
+// only the new and changed files are indexed into the existing index
+	if(update_flag)
 	{
-		file_name = files[i]->d_name;
-
-// if it's a regular file (to avoid . and .. files)
-		if(regularFile(file_name))
+		if(updateIndexFile(files, numfiles, skip_code_flag, output_file_name, num_threads, report_flag))
 		{
-			file_contents = NULL;	
-			file_contents = readFile(file_name);
-			file_pos = 0;
-			doc_id = atoi(file_name);
-
-// just in case a 404 wasn't caught by the crawler
-			if(file_contents != NULL)
-			{
-				word = NULL;
-				word = malloc(500*sizeof(char));
-				MALLOC_CHECK(word);
-				BZERO(word, 500*sizeof(char));
-
-// GetNextWord returns the index in file_contents where it stopped parsing, while assigning a new word to the "word"
-				while((file_pos = parseHTML(file_contents, word, file_pos)) != -1)
-				{
-					updateIndex(word, doc_id, index);
-
-					free(word);
-					//word = NULL;
-					word = malloc(500*sizeof(char));
-					MALLOC_CHECK(word);
-					BZERO(word, 500*sizeof(char));
-				}
-
-				free(word);
-			}
-
-			free(file_contents);
+			fprintf(stderr, "%s: Could not update %s\n", program, output_file_name);
+			return 1;
 		}
 
-		free(files[i]);
-	}
+		for(int i=0; i < numfiles; i++)
+			free(files[i]);
 
-	free(files);
+		free(files);
 
-// outputs to a file
-	saveFile(index, output_file_name);
-	cleanIndex(index);
-
-// if it's in testing mode
-	if(indexer_test_flag)
-	{
-		INVERTED_INDEX* newindex;
-		newindex = readIndex(input_file_name);
-		saveFile(newindex, rewritten_file_name);
-		cleanIndex(newindex);
+		return 0;
 	}
-}
 
-// saveFile takes an index and a file_name, and saves the contents of the index
-// to the file "file_name" in the format specified in the header 
-// Returns 0 if it succeeds and 1 if it fails. 
-int saveFile(INVERTED_INDEX* in_index, char* file_name)
-{
-	FILE* fp;
-	int doc_count;
-	WordNode* current;
-	DocumentNode* docnode;
+	manifest = scanDocuments(files, numfiles, skip_code_flag);
 
-	fp = fopen(file_name, "w");
+// old positions and biwords would be out of date as soon as the index is written
+	removePositions(output_file_name);
+	removeBiwords(output_file_name);
 
-	current = (WordNode*)(in_index->start);
+	if(positions_flag)
+		phrases.positional = initializePositionalIndex();
 
-// cycles through the nodes in the index
-	while(current != NULL)
+	if(biword_threshold > 0)
 	{
-// prints the word to the file pointed to by fp
-		fprintf(fp, "%s ", (current->key));
+		phrases.biwords = initializeDict();
+		phrases.pairs = initializeDocTerms();
+	}
 
-		doc_count = 0;
-		docnode = current->data;		
+// goes through each file in "files", counts the words in its HTML, and builds the index data structure
+// with a memory budget, the index is built in runs on disk and merged straight into the output file
+	if(memory_limit > 0)
+	{
+		if(indexFilesExternal(files, numfiles, skip_code_flag, memory_limit, output_file_name))
+		{
+			fprintf(stderr, "%s: Could not write %s\n", program, output_file_name);
+			return 1;
+		}
+	}
+	else
+	{
+		if(num_threads > 1)
+			index = indexFilesParallel(files, numfiles, skip_code_flag, num_threads);
+		else
+			index = indexFiles(files, numfiles, skip_code_flag, (positions_flag || biword_threshold > 0) ? &phrases : NULL);
 
-// calculates the document count for that word
-		while(docnode != NULL)
+// outputs to a file
+		if((binary_flag ? writeBinaryIndex(index, output_file_name) : saveFile(index, output_file_name, num_threads)) != 0)
 		{
-			doc_count++;
-			docnode = docnode->next;
+			fprintf(stderr, "%s: Could not write %s\n", program, output_file_name);
+			cleanIndex(index);
+			return 1;
 		}
 
-// prints the document count to the same line
-		fprintf(fp, "%d ", doc_count);
+		if(report_flag)
+			reportIndex(index, output_file_name);
 
-		docnode = current->data;
+		cleanIndex(index);
+	}
 
-// prints the breakdown by document to the same line
-		while(docnode != NULL)
-		{
-			fprintf(fp, "%d %d ", (docnode->document_id), (docnode->page_word_frequency));
-			docnode = docnode->next;
-		}
+	if(phrases.positional != NULL)
+	{
+		if(writePositions(phrases.positional, output_file_name))
+			fprintf(stderr, "%s: Could not write the positions of %s\n", program, output_file_name);
 
-		fprintf(fp, "\n");
+		cleanPositionalIndex(phrases.positional);
+	}
 
-		current = current->next;
-	}	
+// only the common pairs are kept
+	if(phrases.biwords != NULL)
+	{
+		phrases.biwords = commonBiwords(phrases.biwords, biword_threshold);
 
-	fclose(fp);
+		if(writeBiwords(phrases.biwords, output_file_name))
+			fprintf(stderr, "%s: Could not write the biwords of %s\n", program, output_file_name);
 
-	return 0;
-}
+		if(report_flag)
+			printf("%s%s: %d pairs of words\n", output_file_name, BIWORDS_SUFFIX, phrases.biwords->num_entries);
 
-// updateIndex takes a word, a document_id, and an index.  It adds the document to the index,
-// and the word itself if it's not already contained in the index.  Returns 0 if success, 1 if failure.
-int updateIndex(char* word, int document_id, INVERTED_INDEX* in_index)
-{
-	DocumentNode* docnode;
-	WordNode* wordnode;
-	DocumentNode* current_doc_node;
+		cleanIndex(phrases.biwords);
+		cleanDocTerms(phrases.pairs);
+	}
 
-	int page_node_exists;
+	removeTombstones(output_file_name);
+	removeSegments(output_file_name);
 
-	page_node_exists = 0;
+	if(writeManifest(manifest, output_file_name))
+		fprintf(stderr, "%s: Could not write the manifest of %s\n", program, output_file_name);
 
-// creates a DocumentNode from the doc_id
-	docnode = malloc(sizeof(DocumentNode));
-  	MALLOC_CHECK(docnode);
-  	docnode->document_id = document_id;
-  	docnode->page_word_frequency = 1;
-	docnode->next = NULL;
+	cleanManifest(manifest);
 
-// makes it lower case (necessary for the query system)
-	NormalizeWord(word);
+	for(int i=0; i < numfiles; i++)
+		free(files[i]);
 
-	if(addData(in_index, docnode, word))	// if the wordnode already exists
+	free(files);
+
+// if it's in testing mode
+	if(indexer_test_flag)
 	{
-		wordnode = getData(in_index, word);
+		INVERTED_INDEX* newindex;
 
-		if(wordnode != NULL)
+		if((newindex = readIndex(input_file_name)) == NULL)
 		{
-			current_doc_node = wordnode->data;
-
-			while(current_doc_node != NULL)
-			{
-				if((current_doc_node->document_id) == document_id)
-				{
-					page_node_exists = 1;
-					current_doc_node->page_word_frequency = (current_doc_node->page_word_frequency)+1;
-					free(docnode);
-					break;
-				}
-				else
-					if(current_doc_node->next == NULL)
-						break;
-					else
-						current_doc_node = current_doc_node->next;
-			}
+			fprintf(stderr, "%s: Could not read index file %s\n", program, input_file_name);
+			return 1;
+		}
 
-			if(!page_node_exists)
-			{
-				current_doc_node->next = docnode;
-			}
-		}			
+		saveFile(newindex, rewritten_file_name, 1);
+		cleanIndex(newindex);
 	}
-
-	return 0;
 }
-
@@ -1,12 +1,144 @@
 // DESIGN SPECS FOR INDEXER.C
 
 #include "../util/dictionary.h"
+#include "../util/docterms.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
 
-// updateIndex takes a word, a document_id, and an index.  It adds the document to the index,
-// and the word itself if it's not already contained in the index.  Returns 0 if success, 1 if failure.
-int updateIndex(char* word, int document_id, INVERTED_INDEX* index);
+#include <dirent.h>
+
+// the most threads the indexer will run with -j
+#define MAX_INDEX_THREADS 256
+
+// bytes per word (key and allocation overhead) assumed when estimating the size of an index for -m
+#define SPIMI_BYTES_PER_WORD 48
+
+// the most runs -m merges at once (each is an open file), more are merged in several passes
+#define SPIMI_MERGE_FAN_IN 64
+
+// the formats an index file can be in (see ../util/indexfile.h and ../util/mapindex.h)
+#define TEXT_INDEX_FORMAT 0
+#define BINARY_INDEX_FORMAT 1
+#define MAPPED_INDEX_FORMAT 2
+
+// the least percentage of deleted documents --compact drops from an index (-t changes it)
+#define COMPACT_THRESHOLD 10
+
+// the extra indexes phrase queries use, built along with an index (see ../util/positions.h and
+// ../util/biwords.h): positional is NULL without -p, and biwords (with pairs, which counts the
+// pairs of one document at a time) without -w
+typedef struct _PhraseIndexes
+{
+	POSITIONAL_INDEX* positional;
+	INVERTED_INDEX* biwords;
+	DOC_TERMS* pairs;
+} __PhraseIndexes;
+
+typedef struct _PhraseIndexes PhraseIndexes;
+
+// the manifest of an index file is [INDEX FILE].manifest (see update.c)
+#define MANIFEST_SUFFIX ".manifest"
+#define MANIFEST_MAGIC "manifest"
+#define MANIFEST_VERSION 1
+
+// what the manifest remembers about one indexed document
+typedef struct _ManifestEntry
+{
+	int doc_id;
+	long mtime_sec;
+	long mtime_nsec;
+	long size;
+} __ManifestEntry;
+
+typedef struct _ManifestEntry ManifestEntry;
+
+// the documents an index was built from, sorted by doc id
+// skip_code is 1 if it was built with -s, high_water_mark is the highest doc id it has held
+typedef struct _Manifest
+{
+	int skip_code;
+	int high_water_mark;
+	int num_entries;
+	int capacity;
+	ManifestEntry* entries;
+} __Manifest;
+
+typedef struct _Manifest Manifest;
+
+// updateIndex takes a (lower case) word, a document_id, the word's frequency in that document,
+// and an index.  It adds the document to the index, and the word itself if it's not already
+// contained in the index.  Returns 0 if success, 1 if failure.
+int updateIndex(char* word, int document_id, int frequency, INVERTED_INDEX* index);
+
+// indexDocument takes a document's contents (length characters) and id, counts its words in
+// doc_terms, and then adds each distinct word to index with a single updateIndex call.
+// skip_code is passed to countDocument.  If phrases isn't NULL (and doc_terms is recording
+// positions), the document's positions and pairs of words are added to its indexes as well.
+void indexDocument(char* contents, long length, int document_id, DOC_TERMS* doc_terms, int skip_code, INVERTED_INDEX* index, PhraseIndexes* phrases);
 
 // saveFile takes an index and a file_name, and saves the contents of the index
-// to the file "file_name" in the format specified in the header 
-// Returns 0 if it succeeds and 1 if it fails.
-int saveFile(INVERTED_INDEX* index, char* file_name);
+// to the file "file_name" in the format specified in the header, formatting it
+// with num_threads threads.  Returns 0 if it succeeds and 1 if it fails.
+int saveFile(INVERTED_INDEX* index, char* file_name, int num_threads);
+
+// countDocument counts every word in a document's contents (length characters, see DOCUMENT in
+// ../util/file.h) in doc_terms, leaving out the words in script, style and comment bodies if
+// skip_code is 1 (see skipCode in ../util/html.h).
+void countDocument(char* contents, long length, DOC_TERMS* doc_terms, int skip_code);
+
+// isDocumentName returns 1 if name is a crawler page's file name (a document id of up to 9 digits),
+// and 0 for anything else in the crawl directory, like an index file saved there.
+int isDocumentName(char* name);
+
+// indexFiles builds an index from the num_files files in files (in the current directory),
+// one file at a time.  skip_code is passed to countDocument.  If phrases isn't NULL, the positions
+// and pairs of words of every file are added to its indexes too.
+INVERTED_INDEX* indexFiles(struct dirent** files, int num_files, int skip_code, PhraseIndexes* phrases);
+
+// indexFilesParallel builds the same index as indexFiles, using num_threads threads
+// (see parallelindex.c).
+INVERTED_INDEX* indexFilesParallel(struct dirent** files, int num_files, int skip_code, int num_threads);
+
+// indexFilesExternal builds an index from the num_files files in files into file_name, keeping the
+// in-memory part under roughly memory_limit bytes (see spimi.c).  Returns 0 if it succeeds and 1 if it fails.
+int indexFilesExternal(struct dirent** files, int num_files, int skip_code, long memory_limit, char* file_name);
+
+// scanDocuments returns a manifest of the pages (regular files named by document id) among the
+// num_files files in files (in the current directory), for an index built with skip_code (see update.c).
+Manifest* scanDocuments(struct dirent** files, int num_files, int skip_code);
+
+// writeManifest saves manifest as the manifest of index_file_name.  Returns 0 if it succeeds and 1 if it fails.
+int writeManifest(Manifest* manifest, char* index_file_name);
+
+// cleanManifest frees manifest.
+void cleanManifest(Manifest* manifest);
+
+// updateIndexFile brings the index file index_file_name up to date with the num_files files in files
+// (in the current directory), only indexing the documents that are new or changed since its manifest was
+// written (see update.c).  Prints what changed if report is 1.  Returns 0 if it succeeds and 1 if it fails.
+int updateIndexFile(struct dirent** files, int num_files, int skip_code, char* index_file_name, int num_threads, int report);
+
+// indexFormat returns the format (one of the formats above) of the index file index_file_name.
+int indexFormat(char* index_file_name);
+
+// dropDocuments removes the postings of the documents marked in dropped (indexed by doc id, up to
+// max_doc_id) from index, and the words left without any.  Returns the index, which is a new one
+// if any word was removed (see update.c).
+INVERTED_INDEX* dropDocuments(INVERTED_INDEX* index, char* dropped, int max_doc_id);
+
+// replaceIndexFile writes index over index_file_name in format, through a temporary file that's
+// renamed over it.  Returns 0 if it succeeds and 1 if it fails.
+int replaceIndexFile(INVERTED_INDEX* index, char* index_file_name, int format, int num_threads);
+
+// deleteDocuments marks the num_documents document ids in documents (as strings) deleted from
+// index_file_name, without reading the index (see compact.c).  Returns 0 if it succeeds and 1 if it fails.
+int deleteDocuments(char* index_file_name, char** documents, int num_documents);
+
+// compactIndexFile drops the postings of the documents deleted from index_file_name if they're at
+// least threshold percent of its documents (see compact.c).  Prints how many were deleted if report
+// is 1.  Returns 0 if it succeeds and 1 if it fails.
+int compactIndexFile(char* index_file_name, int threshold, int num_threads, int report);
+
+// reportIndex prints the number of words and postings in index, and the size of the
+// index file file_name, to stdout (the indexer's -r option).
+void reportIndex(INVERTED_INDEX* index, char* file_name);
@@ -4,7 +4,7 @@
 outputfile="indexer_testlog"
 
 make clean >> "$outputfile"
-make indexer >> "$outputfile"
+make indexer indexconvert >> "$outputfile"
 
 if [ $? -ne 0 ] 
     then
@@ -42,7 +42,7 @@ echo "Testing regular functionality after crawling at depth 3" >> "$outputfile"
 
 echo "Test complete.  For results, look at file 'index.dat'" >> "$outputfile"
 
-rm -f ../crawler/data/index.dat
+rm -f ../crawler/data/index.dat ../crawler/data/index.dat.manifest
 
 echo "Testing ability to read in an index file, store in data structures, and output it again." >> "$outputfile"
 
@@ -52,4 +52,195 @@ echo "The following is the results of diff index.dat testindex.dat" >> "$outputf
 
 diff ../crawler/data/index.dat ../crawler/data/testindex.dat >> "$outputfile"
 
+echo "Testing that indexing with 4 threads (-j 4) builds an identical index" >> "$outputfile"
+
+rm -f ../crawler/data/index.dat* ../crawler/data/testindex.dat*
+
+./indexer ../crawler/data ../serialindex.dat >> "$outputfile"
+./indexer -j 4 ../crawler/data ../threadedindex.dat >> "$outputfile"
+
+cmp ../crawler/serialindex.dat ../crawler/threadedindex.dat >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "-j 4 test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+echo "-j 4 test passed!" >> "$outputfile"
+
+echo "Testing that a 1 MB memory budget (-m 1) builds the same index, sorted by word" >> "$outputfile"
+
+./indexer -m 1 ../crawler/data ../budgetindex.dat >> "$outputfile"
+
+LC_ALL=C sort ../crawler/serialindex.dat | cmp - ../crawler/budgetindex.dat >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "-m 1 test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+echo "-m 1 test passed!" >> "$outputfile"
+
+echo "Testing that a binary index (-b) converts back to the same text index (its words sorted) and back again" >> "$outputfile"
+
+./indexer -b ../crawler/data ../binaryindex.dat >> "$outputfile"
+./indexconvert -t ../crawler/binaryindex.dat ../crawler/convertedindex.dat >> "$outputfile"
+./indexconvert -b ../crawler/convertedindex.dat ../crawler/convertedindex.dat.bin >> "$outputfile"
+
+LC_ALL=C sort ../crawler/serialindex.dat > ../crawler/serialindex.dat.sorted
+cmp ../crawler/serialindex.dat.sorted ../crawler/convertedindex.dat >> "$outputfile" &&
+cmp ../crawler/binaryindex.dat ../crawler/convertedindex.dat.bin >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "-b test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+echo "-b test passed!" >> "$outputfile"
+
+echo "Testing that skipping script, style and comment bodies (-s) makes the index no bigger, and reporting by how much" >> "$outputfile"
+
+./indexer -r ../crawler/data ../serialindex.dat > ../crawler/fullreport
+./indexer -s -r ../crawler/data ../skipindex.dat > ../crawler/skipreport
+cat ../crawler/fullreport ../crawler/skipreport >> "$outputfile"
+
+# each report is "file: W words, P postings, B bytes"
+paste ../crawler/fullreport ../crawler/skipreport | awk '{
+	printf("-s shrinks the vocabulary by %.1f%%, the postings by %.1f%% and the index file by %.1f%%\n",
+		100 * (1 - $9 / $2), 100 * (1 - $11 / $4), 100 * (1 - $13 / $6));
+	exit ($9 > $2 || $11 > $4 || $13 > $6) }' >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "-s test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+rm -f ../crawler/serialindex.dat* ../crawler/threadedindex.dat* ../crawler/budgetindex.dat* ../crawler/binaryindex.dat* ../crawler/convertedindex.dat*
+rm -f ../crawler/skipindex.dat* ../crawler/fullreport ../crawler/skipreport
+
+echo "-s test passed!" >> "$outputfile"
+
+echo "Testing that -p and -w build the same index along with its positions and biwords, and that --update removes them" >> "$outputfile"
+
+rm -rf ../crawler/positionsdata
+mkdir ../crawler/positionsdata
+cp ../crawler/data/[0-9]* ../crawler/positionsdata/
+
+./indexer ../crawler/positionsdata ../serialindex.dat >> "$outputfile"
+./indexer -p -w 10 ../crawler/positionsdata ../positionsindex.dat >> "$outputfile"
+
+cmp ../crawler/serialindex.dat ../crawler/positionsindex.dat >> "$outputfile"
+if [ $? -ne 0 ] || [ ! -s ../crawler/positionsindex.dat.positions ] || [ ! -s ../crawler/positionsindex.dat.biwords ]
+    then
+        echo "-p test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+first=$(ls ../crawler/positionsdata | sort -n | head -1)
+echo "<p>recrawled page</p>" >> ../crawler/positionsdata/$first
+
+./indexer --update ../crawler/positionsdata ../positionsindex.dat 2>> "$outputfile"
+if [ -e ../crawler/positionsindex.dat.positions ] || [ -e ../crawler/positionsindex.dat.biwords ]
+    then
+        echo "-p --update test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+rm -rf ../crawler/positionsdata ../crawler/serialindex.dat* ../crawler/positionsindex.dat*
+
+echo "-p test passed!" >> "$outputfile"
+
+echo "Testing that --update after changing, removing and adding pages gives the same index as rebuilding" >> "$outputfile"
+
+rm -rf ../crawler/updatedata
+mkdir ../crawler/updatedata
+cp ../crawler/data/[0-9]* ../crawler/updatedata/
+
+./indexer ../crawler/updatedata ../updateindex.dat >> "$outputfile"
+
+first=$(ls ../crawler/updatedata | sort -n | head -1)
+second=$(ls ../crawler/updatedata | sort -n | head -2 | tail -1)
+last=$(ls ../crawler/updatedata | sort -n | tail -1)
+echo "<p>recrawled page</p>" >> ../crawler/updatedata/$first
+rm ../crawler/updatedata/$second
+cp ../crawler/updatedata/$last ../crawler/updatedata/$((last + 1))
+
+./indexer -r --update ../crawler/updatedata ../updateindex.dat >> "$outputfile"
+./indexer ../crawler/updatedata ../rebuiltindex.dat >> "$outputfile"
+
+LC_ALL=C sort ../crawler/updateindex.dat > ../crawler/updatesorted
+LC_ALL=C sort ../crawler/rebuiltindex.dat | cmp - ../crawler/updatesorted >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "--update test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+rm -rf ../crawler/updatedata ../crawler/updatesorted ../crawler/updateindex.dat* ../crawler/rebuiltindex.dat*
+
+echo "--update test passed!" >> "$outputfile"
+
+echo "Testing that --update with the index inside the crawl directory finds nothing changed and leaves the index alone" >> "$outputfile"
+
+rm -rf ../crawler/insidedata
+mkdir ../crawler/insidedata
+cp ../crawler/data/[0-9]* ../crawler/insidedata/
+
+./indexer ../crawler/insidedata index.dat >> "$outputfile"
+./indexer -r --update ../crawler/insidedata index.dat >> "$outputfile"
+cp ../crawler/insidedata/index.dat ../crawler/insidecopy.dat
+
+./indexer -r --update ../crawler/insidedata index.dat > ../crawler/insidereport
+cat ../crawler/insidereport >> "$outputfile"
+
+grep -q "0 new, 0 changed, 0 removed" ../crawler/insidereport && cmp ../crawler/insidedata/index.dat ../crawler/insidecopy.dat >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "--update inside the crawl directory test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+rm -rf ../crawler/insidedata ../crawler/insidecopy.dat ../crawler/insidereport
+
+echo "--update inside the crawl directory test passed!" >> "$outputfile"
+
+echo "Testing that --delete and then --compact gives the same index as rebuilding without the deleted pages" >> "$outputfile"
+
+rm -rf ../crawler/deletedata
+mkdir ../crawler/deletedata
+cp ../crawler/data/[0-9]* ../crawler/deletedata/
+
+./indexer ../crawler/deletedata ../deleteindex.dat >> "$outputfile"
+cp ../crawler/deleteindex.dat ../crawler/deletecopy.dat
+
+first=$(ls ../crawler/deletedata | sort -n | head -1)
+last=$(ls ../crawler/deletedata | sort -n | tail -1)
+
+./indexer --delete ../crawler/deleteindex.dat $first $last >> "$outputfile"
+./indexer -r -t 100 --compact ../crawler/deleteindex.dat >> "$outputfile"
+
+# under the threshold, the index is left alone
+cmp ../crawler/deleteindex.dat ../crawler/deletecopy.dat >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "--compact threshold test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+./indexer -r -t 0 --compact ../crawler/deleteindex.dat >> "$outputfile"
+rm ../crawler/deletedata/$first ../crawler/deletedata/$last
+./indexer ../crawler/deletedata ../rebuiltindex.dat >> "$outputfile"
+
+LC_ALL=C sort ../crawler/deleteindex.dat > ../crawler/deletesorted
+LC_ALL=C sort ../crawler/rebuiltindex.dat | cmp - ../crawler/deletesorted >> "$outputfile"
+if [ $? -ne 0 ] 
+    then
+        echo "--delete test FAILED." >> "$outputfile"
+        exit 1
+fi
+
+rm -rf ../crawler/deletedata ../crawler/deletesorted ../crawler/deleteindex.dat* ../crawler/deletecopy.dat ../crawler/rebuiltindex.dat*
+
+echo "--delete test passed!" >> "$outputfile"
+
 echo "Indexer testing complete!"
@@ -0,0 +1,167 @@
+/*
+	indexfuncs.c
+
+	Contains the functional code for indexer.c, apart from its main, so the
+	query engine's live index (see ../queryengine/live.c) indexes documents
+	with the same functions.
+
+	INVERTED_INDEX* indexFiles	- builds an index from a list of files, one at a time
+	int saveFile			- saves an index in the text format
+	int updateIndex			- adds a word's postings for a document to an index
+	void reportIndex		- prints the size of an index (-r)
+	void countDocument		- counts the words of a document in a DOC_TERMS
+	void indexDocument		- counts a document's words and adds them to an index
+	int isDocumentName		- tells a crawler page's file name from anything else
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "indexer.h"
+#include "../util/header.h"
+#include "../util/html.h"
+#include "../util/file.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/docterms.h"
+#include "../util/indexfile.h"
+#include "../util/ingest.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
+
+// indexFiles takes the list of num_files files (in the current directory), and builds
+// an index from them one at a time, in the order they're listed.  skip_code is passed to countDocument.
+// The files are read INGEST_QUEUE_DEPTH at a time ahead of the one being indexed (see ../util/ingest.h).
+// If phrases isn't NULL, the positions (-p) and pairs of words (-w) are added to its indexes too.
+INVERTED_INDEX* indexFiles(struct dirent** files, int num_files, int skip_code, PhraseIndexes* phrases)
+{
+	INVERTED_INDEX* index;
+	int file;
+
+// counts the words of one document at a time before they go into the index
+	DOC_TERMS* doc_terms;
+
+// reads the regular files (not . and ..) ahead, and gives back one at a time
+	INGEST* ingest;
+	DOCUMENT* document;
+
+	index = initializeDict();
+	doc_terms = initializeDocTerms();
+	recordPositions(doc_terms, phrases != NULL);
+	ingest = startIngest(files, num_files, INGEST_QUEUE_DEPTH, INGEST_IO_URING);
+
+	while((document = nextIngested(ingest, &file)) != NULL)
+		indexDocument(document->contents, document->length, atoi(files[file]->d_name), doc_terms, skip_code, index, phrases);
+
+	finishIngest(ingest);
+	cleanDocTerms(doc_terms);
+
+	return index;
+}
+
+// saveFile takes an index and a file_name, and saves the contents of the index
+// to the file "file_name" in the format specified in the header 
+// (see writeTextIndex in ../util/indexfile.c), formatting it with num_threads threads.
+// Returns 0 if it succeeds and 1 if it fails. 
+int saveFile(INVERTED_INDEX* in_index, char* file_name, int num_threads)
+{
+	return writeTextIndex(in_index, file_name, num_threads);
+}
+
+// updateIndex takes a word, a document_id, the number of times the word occurs in that
+// document, and an index.  It adds the document to the index, and the word itself if it's
+// not already contained in the index.  word must already be lower case.
+// Documents are indexed in increasing id order, so the document is either the last one in the
+// word's PostingList already or gets appended to it.  Returns 0 if success, 1 if failure.
+int updateIndex(char* word, int document_id, int frequency, INVERTED_INDEX* in_index)
+{
+	WordNode* wordnode;
+	PostingList* postings;
+
+	if((wordnode = getData(in_index, word)) != NULL)	// if the wordnode already exists
+		postings = wordnode->data;
+	else
+	{
+		postings = initializePostings(INITIAL_POSTINGS_CAPACITY);
+		addData(in_index, postings, word);
+	}
+
+	addPosting(postings, document_id, frequency);
+
+	return 0;
+}
+
+// reportIndex prints the number of words (the vocabulary) and postings in index, and the size of
+// the index file file_name, in one line: "file_name: 1234 words, 56789 postings, 1011121 bytes".
+void reportIndex(INVERTED_INDEX* index, char* file_name)
+{
+	struct stat file_stat;
+	long num_postings = 0;
+
+	for(WordNode* wordnode = index->start; wordnode != NULL; wordnode = wordnode->next)
+		num_postings += ((PostingList*)wordnode->data)->num_docs;
+
+	if(stat(file_name, &file_stat) != 0)
+		file_stat.st_size = 0;
+
+	printf("%s: %d words, %ld postings, %ld bytes\n", file_name, index->num_entries, num_postings, (long)file_stat.st_size);
+}
+
+// countDocument takes the contents of a crawled file (length characters) and counts every word in
+// it in doc_terms.  The words are counted straight out of contents, which may be a mapping of the file
+// (see TOKENIZER in ../util/html.h).  If skip_code is 1, the words in script, style and comment
+// bodies aren't counted.
+void countDocument(char* contents, long length, DOC_TERMS* doc_terms, int skip_code)
+{
+	TOKENIZER tokenizer;
+	char* word;
+	int word_length;
+
+	initializeTokenizer(&tokenizer, contents, length);
+	skipCode(&tokenizer, skip_code);
+
+	while(nextToken(&tokenizer, &word, &word_length))
+		countTerm(doc_terms, word, word_length);
+
+	cleanTokenizer(&tokenizer);
+}
+
+// indexDocument takes the contents of a crawled file, its document_id, a DOC_TERMS to count
+// the words in, and an index.  Every word is counted in doc_terms first, then each distinct
+// word is added to the index once (in the order they first occur in the document).
+// If phrases isn't NULL, doc_terms records positions, and they're added to phrases' positional
+// index, and the pairs of adjacent words to its biwords, as well.
+void indexDocument(char* contents, long length, int document_id, DOC_TERMS* doc_terms, int skip_code, INVERTED_INDEX* in_index, PhraseIndexes* phrases)
+{
+	countDocument(contents, length, doc_terms, skip_code);
+
+	for(int t = 0; t < doc_terms->num_terms; t++)
+		updateIndex(docTermKey(doc_terms, t), document_id, doc_terms->terms[t].frequency, in_index);
+
+	if(phrases != NULL && phrases->positional != NULL)
+		addPositions(phrases->positional, doc_terms, document_id);
+
+	if(phrases != NULL && phrases->biwords != NULL)
+	{
+		countBiwords(doc_terms, phrases->pairs);
+
+		for(int t = 0; t < phrases->pairs->num_terms; t++)
+			updateIndex(docTermKey(phrases->pairs, t), document_id, phrases->pairs->terms[t].frequency, phrases->biwords);
+
+		resetDocTerms(phrases->pairs);
+	}
+
+	resetDocTerms(doc_terms);
+}
+
+// isDocumentName returns 1 if name is a crawler page's (named by document id), and 0 for anything
+// else in the crawl directory, like an index file and its manifest saved there.
+int isDocumentName(char* name)
+{
+	return name[0] != 0 && name[strspn(name, "0123456789")] == 0 && strlen(name) <= 9;
+}
@@ -0,0 +1,334 @@
+/*
+	parallelindex.c
+
+	Builds an index with several threads (the indexer's -j option).  The
+	resulting index is the same one the serial indexer builds: the same words
+	in the same order, with the same PostingLists.
+
+	Phase 1: worker threads take files from a shared counter.  Each one counts
+	a file's words in its own DOC_TERMS and adds them to its own partial index.
+	A partial word remembers where it first occured: the position of the file
+	in the file list, and the word's position (ordinal) in that file's
+	DOC_TERMS.  When the files run out, the worker splits its partial index
+	into one shard per thread by hash value.
+
+	Phase 2: thread s merges shard s of every partial index, so each word is
+	merged by exactly one thread.  Partial PostingLists hold different
+	documents, and are merged in document id order.
+
+	Finally the merged words are sorted by where they first occured and added
+	to the index in that order, which is the order the serial indexer adds
+	them in.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <dirent.h>
+
+#include "indexer.h"
+#include "../util/header.h"
+#include "../util/file.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/docterms.h"
+
+// the data of the WordNodes in partial and merged indexes
+// first_file and first_ordinal say where the word first occured
+typedef struct _PartialTerm
+{
+	PostingList* postings;
+	int first_file;
+	int first_ordinal;
+} __PartialTerm;
+
+typedef struct _PartialTerm PartialTerm;
+
+typedef struct _IndexJob IndexJob;
+
+// one per thread
+// partial is the index built from the files this thread took (phase 1)
+// shards[s] lists the WordNodes of partial whose hash value % num_threads == s
+// merged is shard id of every partial index merged together (phase 2)
+typedef struct _IndexWorker
+{
+	pthread_t thread;
+	int id;
+	IndexJob* job;
+	DICTIONARY* partial;
+	WordNode*** shards;
+	int* shard_sizes;
+	DICTIONARY* merged;
+} __IndexWorker;
+
+typedef struct _IndexWorker IndexWorker;
+
+// shared by every thread
+// next_file is the position in files of the next file to index (protected by lock)
+struct _IndexJob
+{
+	struct dirent** files;
+	int num_files;
+	int skip_code;
+	int next_file;
+	pthread_mutex_t lock;
+	int num_threads;
+	IndexWorker* workers;
+};
+
+// Returns the position in the file list of the next file to index, or -1 if there are none left.
+static int takeFile(IndexJob* job)
+{
+	int file;
+
+	pthread_mutex_lock(&(job->lock));
+	file = (job->next_file < job->num_files) ? job->next_file++ : -1;
+	pthread_mutex_unlock(&(job->lock));
+
+	return file;
+}
+
+// Adds the words counted in doc_terms (from the file at position file in the
+// file list) to the partial index.
+static void updatePartialIndex(DICTIONARY* partial, DOC_TERMS* doc_terms, int document_id, int file)
+{
+	WordNode* wordnode;
+	PartialTerm* term;
+	char* word;
+
+	for(int t = 0; t < doc_terms->num_terms; t++)
+	{
+		word = docTermKey(doc_terms, t);
+
+		if((wordnode = getData(partial, word)) != NULL)
+			term = wordnode->data;
+		else
+		{
+			term = malloc(sizeof(PartialTerm));
+			MALLOC_CHECK(term);
+			term->postings = initializePostings(INITIAL_POSTINGS_CAPACITY);
+			term->first_file = file;
+			term->first_ordinal = t;
+			addData(partial, term, word);
+		}
+
+		addPosting(term->postings, document_id, doc_terms->terms[t].frequency);
+	}
+}
+
+// Splits the WordNodes of worker's partial index into one shard per thread.
+static void shardPartialIndex(IndexWorker* worker)
+{
+	int num_threads = worker->job->num_threads;
+	int shard;
+	WordNode* wordnode;
+
+	worker->shards = malloc(num_threads * sizeof(WordNode**));
+	MALLOC_CHECK(worker->shards);
+	worker->shard_sizes = malloc(num_threads * sizeof(int));
+	MALLOC_CHECK(worker->shard_sizes);
+	BZERO(worker->shard_sizes, num_threads * sizeof(int));
+
+	for(wordnode = worker->partial->start; wordnode != NULL; wordnode = wordnode->next)
+		worker->shard_sizes[wordnode->hash_value % num_threads]++;
+
+	for(int s = 0; s < num_threads; s++)
+	{
+		worker->shards[s] = malloc((worker->shard_sizes[s] + 1) * sizeof(WordNode*));
+		MALLOC_CHECK(worker->shards[s]);
+		worker->shard_sizes[s] = 0;
+	}
+
+	for(wordnode = worker->partial->start; wordnode != NULL; wordnode = wordnode->next)
+	{
+		shard = wordnode->hash_value % num_threads;
+		worker->shards[shard][worker->shard_sizes[shard]++] = wordnode;
+	}
+}
+
+// Phase 1: indexes files until there are none left, then shards the partial index.
+static void* indexFilesWorker(void* arg)
+{
+	IndexWorker* worker = arg;
+	DOC_TERMS* doc_terms = initializeDocTerms();
+	DOCUMENT document;
+	char* file_name;
+	int file;
+
+	worker->partial = initializeDict();
+	initializeDocument(&document);
+
+	while((file = takeFile(worker->job)) != -1)
+	{
+		file_name = worker->job->files[file]->d_name;
+
+// if it's a regular file that can be read (to avoid . and .. files)
+		if(openDocument(&document, file_name) != 0)
+			continue;
+
+		countDocument(document.contents, document.length, doc_terms, worker->job->skip_code);
+		closeDocument(&document);
+
+		updatePartialIndex(worker->partial, doc_terms, atoi(file_name), file);
+		resetDocTerms(doc_terms);
+	}
+
+	cleanDocument(&document);
+	cleanDocTerms(doc_terms);
+	shardPartialIndex(worker);
+
+	return NULL;
+}
+
+// Phase 2: merges shard worker->id of every partial index into worker->merged.
+// The PostingLists are moved out of the partial indexes (their data is left NULL).
+static void* mergeShardWorker(void* arg)
+{
+	IndexWorker* worker = arg;
+	IndexJob* job = worker->job;
+	IndexWorker* other;
+	WordNode* wordnode;
+	WordNode* mergednode;
+	PartialTerm* term;
+	PartialTerm* merged_term;
+	PostingList* merged_postings;
+
+	worker->merged = initializeDict();
+
+	for(int w = 0; w < job->num_threads; w++)
+	{
+		other = &(job->workers[w]);
+
+		for(int i = 0; i < other->shard_sizes[worker->id]; i++)
+		{
+			wordnode = other->shards[worker->id][i];
+			term = wordnode->data;
+
+			if((mergednode = getData(worker->merged, wordnode->key)) == NULL)
+			{
+				merged_term = malloc(sizeof(PartialTerm));
+				MALLOC_CHECK(merged_term);
+				*merged_term = *term;
+				addData(worker->merged, merged_term, wordnode->key);
+			}
+			else
+			{
+				merged_term = mergednode->data;
+				merged_postings = mergePostings(merged_term->postings, term->postings);
+				cleanPostings(merged_term->postings);
+				cleanPostings(term->postings);
+				merged_term->postings = merged_postings;
+
+// keeps whichever occurence came first
+				if(term->first_file < merged_term->first_file)
+				{
+					merged_term->first_file = term->first_file;
+					merged_term->first_ordinal = term->first_ordinal;
+				}
+			}
+
+			term->postings = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+// compares two merged WordNodes by where their word first occured (for qsort)
+static int compareFirstOccurences(const void* a, const void* b)
+{
+	PartialTerm* first = (*(WordNode* const*)a)->data;
+	PartialTerm* second = (*(WordNode* const*)b)->data;
+
+	if(first->first_file != second->first_file)
+		return (first->first_file > second->first_file) - (first->first_file < second->first_file);
+
+	return (first->first_ordinal > second->first_ordinal) - (first->first_ordinal < second->first_ordinal);
+}
+
+// Starts num_threads threads running start_routine on each of job's workers and waits for them.
+static void runWorkers(IndexJob* job, void* (*start_routine)(void*))
+{
+	for(int w = 0; w < job->num_threads; w++)
+	{
+		if(pthread_create(&(job->workers[w].thread), NULL, start_routine, &(job->workers[w])) != 0)
+		{
+			fprintf(stderr, "Could not create indexer thread %d\n", w);
+			exit(-1);
+		}
+	}
+
+	for(int w = 0; w < job->num_threads; w++)
+		pthread_join(job->workers[w].thread, NULL);
+}
+
+// indexFilesParallel indexes the num_files files in files (in the current directory)
+// with num_threads threads and returns the resulting index.
+INVERTED_INDEX* indexFilesParallel(struct dirent** files, int num_files, int skip_code, int num_threads)
+{
+	IndexJob job;
+	INVERTED_INDEX* index;
+	WordNode** merged_nodes;
+	int num_merged;
+
+	job.files = files;
+	job.num_files = num_files;
+	job.skip_code = skip_code;
+	job.next_file = 0;
+	job.num_threads = num_threads;
+	pthread_mutex_init(&(job.lock), NULL);
+
+	job.workers = malloc(num_threads * sizeof(IndexWorker));
+	MALLOC_CHECK(job.workers);
+	BZERO(job.workers, num_threads * sizeof(IndexWorker));
+
+	for(int w = 0; w < num_threads; w++)
+	{
+		job.workers[w].id = w;
+		job.workers[w].job = &job;
+	}
+
+	runWorkers(&job, indexFilesWorker);
+	runWorkers(&job, mergeShardWorker);
+
+// puts the merged words back in the order the serial indexer would have added them
+	num_merged = 0;
+	for(int w = 0; w < num_threads; w++)
+		num_merged += job.workers[w].merged->num_entries;
+
+	merged_nodes = malloc((num_merged + 1) * sizeof(WordNode*));
+	MALLOC_CHECK(merged_nodes);
+
+	num_merged = 0;
+	for(int w = 0; w < num_threads; w++)
+		for(WordNode* wordnode = job.workers[w].merged->start; wordnode != NULL; wordnode = wordnode->next)
+			merged_nodes[num_merged++] = wordnode;
+
+	qsort(merged_nodes, num_merged, sizeof(WordNode*), compareFirstOccurences);
+
+	index = initializeDict();
+
+	for(int i = 0; i < num_merged; i++)
+		addData(index, ((PartialTerm*)merged_nodes[i]->data)->postings, merged_nodes[i]->key);
+
+// the PostingLists now belong to index, so only the PartialTerms and WordNodes are freed
+	free(merged_nodes);
+
+	for(int w = 0; w < num_threads; w++)
+	{
+		for(int s = 0; s < num_threads; s++)
+			free(job.workers[w].shards[s]);
+
+		free(job.workers[w].shards);
+		free(job.workers[w].shard_sizes);
+		cleanDict(job.workers[w].partial);
+		cleanDict(job.workers[w].merged);
+	}
+
+	free(job.workers);
+	pthread_mutex_destroy(&(job.lock));
+
+	return index;
+}
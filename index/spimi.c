@@ -0,0 +1,418 @@
+/*
+	spimi.c
+
+	Builds an index within a memory budget (the indexer's -m option), using
+	single-pass in-memory indexing (SPIMI).
+
+	Files are indexed in order into an ordinary in-memory index.  Whenever its
+	estimated size passes the budget, its words are sorted and written to a
+	run file ([OUTPUT FILE NAME].run0, .run1, ...) in the index file format,
+	and a new, empty index is started.  At the end, the runs are merged k ways
+	into [OUTPUT FILE NAME] and deleted.  With more than SPIMI_MERGE_FAN_IN
+	runs, so they wouldn't all be open at once, groups of that many are first
+	merged into longer runs ([OUTPUT FILE NAME].pass1.0, ...), pass after pass.
+
+	Each run holds later documents than the runs before it, so a word's
+	postings are merged by simply concatenating them in run order (a group
+	of consecutive runs merges into a run that keeps its place).  The merge
+	streams one line per run at a time, so it never needs more memory than the
+	longest lines.
+
+	The index holds the same lines as the in-memory indexer's, but sorted by
+	word instead of in the order words first occured.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "indexer.h"
+#include "../util/header.h"
+#include "../util/file.h"
+#include "../util/ingest.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/docterms.h"
+
+// Returns a conservative estimate of the bytes used by index, which holds num_postings postings.
+// Every PostingList is assumed to be at most half full.
+static long estimateIndexBytes(INVERTED_INDEX* index, long num_postings)
+{
+	long bytes;
+
+	bytes = (long)(index->num_slots + index->num_old_slots) * sizeof(DSLOT);
+	bytes += (long)index->num_entries * (sizeof(DNODE) + sizeof(PostingList) + SPIMI_BYTES_PER_WORD);
+	bytes += num_postings * 4 * sizeof(int);
+
+	return bytes;
+}
+
+// compares two WordNodes by key (for qsort)
+static int compareKeys(const void* a, const void* b)
+{
+	return strcmp((*(WordNode* const*)a)->key, (*(WordNode* const*)b)->key);
+}
+
+// Writes index to run_file_name in the index file format, sorted by word.
+// Returns 0 if it succeeds and 1 if it fails.
+static int writeRun(INVERTED_INDEX* index, char* run_file_name)
+{
+	FILE* fp;
+	WordNode** words;
+	WordNode* current;
+	PostingList* postings;
+	int num_words = 0;
+	int failed;
+
+	if((fp = fopen(run_file_name, "w")) == NULL)
+		return 1;
+
+	words = malloc((index->num_entries + 1) * sizeof(WordNode*));
+	MALLOC_CHECK(words);
+
+	for(current = index->start; current != NULL; current = current->next)
+		words[num_words++] = current;
+
+	qsort(words, num_words, sizeof(WordNode*), compareKeys);
+
+	for(int i = 0; i < num_words; i++)
+	{
+		postings = words[i]->data;
+		fprintf(fp, "%s %d ", words[i]->key, postings->num_docs);
+
+		for(int p = 0; p < postings->num_docs; p++)
+			fprintf(fp, "%d %d ", postings->doc_ids[p], postings->frequencies[p]);
+
+		fprintf(fp, "\n");
+	}
+
+	free(words);
+
+	failed = ferror(fp);
+
+	return (fclose(fp) != 0 || failed);
+}
+
+// one run being merged
+// line is its current line (NULL once the run is used up)
+// word_length is the length of the word at the start of line
+// postings is where the document ids and frequencies start in line
+typedef struct _RunReader
+{
+	FILE* fp;
+	char* line;
+	size_t line_capacity;
+	int word_length;
+	int num_docs;
+	char* postings;
+} __RunReader;
+
+typedef struct _RunReader RunReader;
+
+// Reads the next line of run, splitting it into its word, document count and postings.
+static void readRunLine(RunReader* run)
+{
+	char* end;
+	ssize_t length;
+
+	if((length = getline(&(run->line), &(run->line_capacity), run->fp)) <= 0)
+	{
+		free(run->line);
+		run->line = NULL;
+		return;
+	}
+
+// drops the newline, it's added back when the merged line is written
+	if(run->line[length - 1] == '\n')
+		run->line[length - 1] = 0;
+
+	run->word_length = strcspn(run->line, " ");
+	run->num_docs = (int)strtol(run->line + run->word_length, &end, 10);
+	run->postings = (*end == ' ') ? end + 1 : end;
+}
+
+// compares the current words of two runs, using run order to break ties
+static int compareRuns(RunReader* runs, int a, int b)
+{
+	int shorter = (runs[a].word_length < runs[b].word_length) ? runs[a].word_length : runs[b].word_length;
+	int compare = memcmp(runs[a].line, runs[b].line, shorter);
+
+	if(compare == 0)
+		compare = runs[a].word_length - runs[b].word_length;
+
+	return (compare != 0) ? compare : a - b;
+}
+
+// Restores the heap property of heap (run numbers, smallest current word first) below position.
+static void siftDown(RunReader* runs, int* heap, int heap_size, int position)
+{
+	int child;
+	int temp;
+
+	while((child = 2 * position + 1) < heap_size)
+	{
+		if(child + 1 < heap_size && compareRuns(runs, heap[child + 1], heap[child]) < 0)
+			child++;
+
+		if(compareRuns(runs, heap[child], heap[position]) >= 0)
+			break;
+
+		temp = heap[child];
+		heap[child] = heap[position];
+		heap[position] = temp;
+		position = child;
+	}
+}
+
+// Restores the heap property of heap above position.
+static void siftUp(RunReader* runs, int* heap, int position)
+{
+	int parent;
+	int temp;
+
+	while(position > 0 && compareRuns(runs, heap[position], heap[parent = (position - 1) / 2]) < 0)
+	{
+		temp = heap[parent];
+		heap[parent] = heap[position];
+		heap[position] = temp;
+		position = parent;
+	}
+}
+
+// Returns 1 if runs a and b are on the same word.
+static int sameWord(RunReader* runs, int a, int b)
+{
+	return (runs[a].word_length == runs[b].word_length && memcmp(runs[a].line, runs[b].line, runs[a].word_length) == 0);
+}
+
+// Merges the num_runs run files into file_name.  Returns 0 if it succeeds and 1 if it fails.
+static int mergeRuns(char** run_file_names, int num_runs, char* file_name)
+{
+	FILE* fp;
+	RunReader* runs;
+	int* heap;
+	int heap_size = 0;
+	int* same;		// the runs on the smallest word, in run order
+	int num_same;
+	int num_docs;
+	int r;
+	int failed = 0;
+
+	if((fp = fopen(file_name, "w")) == NULL)
+		return 1;
+
+	runs = malloc(num_runs * sizeof(RunReader));
+	MALLOC_CHECK(runs);
+	BZERO(runs, num_runs * sizeof(RunReader));
+	heap = malloc(num_runs * sizeof(int));
+	MALLOC_CHECK(heap);
+	same = malloc(num_runs * sizeof(int));
+	MALLOC_CHECK(same);
+
+	for(r = 0; r < num_runs; r++)
+	{
+		if((runs[r].fp = fopen(run_file_names[r], "r")) == NULL)
+		{
+			failed = 1;
+			continue;
+		}
+
+		readRunLine(&(runs[r]));
+
+		if(runs[r].line != NULL)
+		{
+			heap[heap_size] = r;
+			siftUp(runs, heap, heap_size++);
+		}
+	}
+
+	while(heap_size > 0)
+	{
+// pops every run on the smallest word (ties come out in run order, ie document order)
+		num_same = 0;
+		num_docs = 0;
+
+		do
+		{
+			same[num_same++] = heap[0];
+			num_docs += runs[heap[0]].num_docs;
+			heap[0] = heap[--heap_size];
+			siftDown(runs, heap, heap_size, 0);
+		}
+		while(heap_size > 0 && sameWord(runs, heap[0], same[0]));
+
+		fprintf(fp, "%.*s %d ", runs[same[0]].word_length, runs[same[0]].line, num_docs);
+
+		for(int i = 0; i < num_same; i++)
+			fputs(runs[same[i]].postings, fp);
+
+		fprintf(fp, "\n");
+
+// moves those runs on to their next lines
+		for(int i = 0; i < num_same; i++)
+		{
+			r = same[i];
+			readRunLine(&(runs[r]));
+
+			if(runs[r].line != NULL)
+			{
+				heap[heap_size] = r;
+				siftUp(runs, heap, heap_size++);
+			}
+		}
+	}
+
+	for(r = 0; r < num_runs; r++)
+	{
+		if(runs[r].fp != NULL)
+			fclose(runs[r].fp);
+
+		free(runs[r].line);
+	}
+
+	free(runs);
+	free(heap);
+	free(same);
+
+	failed |= ferror(fp);
+
+	return (fclose(fp) != 0 || failed);
+}
+
+// Merges the num_runs run files into file_name, SPIMI_MERGE_FAN_IN at a time.  While there are
+// more, each group of that many consecutive runs is merged into a longer one, and deleted.
+// Returns 0 if it succeeds and 1 if it fails.
+static int mergeRunsInPasses(char** run_file_names, int num_runs, char* file_name)
+{
+	char** names = run_file_names;
+	char** merged_names;
+	int num_merged;
+	int group_size;
+	int pass = 0;
+	int failed = 0;
+
+	while(num_runs > SPIMI_MERGE_FAN_IN && !failed)
+	{
+		pass++;
+		num_merged = (num_runs + SPIMI_MERGE_FAN_IN - 1) / SPIMI_MERGE_FAN_IN;
+		merged_names = malloc(num_merged * sizeof(char*));
+		MALLOC_CHECK(merged_names);
+
+		for(int m = 0; m < num_merged; m++)
+		{
+			group_size = (num_runs - m * SPIMI_MERGE_FAN_IN < SPIMI_MERGE_FAN_IN) ? num_runs - m * SPIMI_MERGE_FAN_IN : SPIMI_MERGE_FAN_IN;
+			merged_names[m] = malloc(strlen(file_name) + 40);
+			MALLOC_CHECK(merged_names[m]);
+			sprintf(merged_names[m], "%s.pass%d.%d", file_name, pass, m);
+
+			if(!failed)
+				failed = mergeRuns(names + m * SPIMI_MERGE_FAN_IN, group_size, merged_names[m]);
+
+			for(int r = m * SPIMI_MERGE_FAN_IN; r < m * SPIMI_MERGE_FAN_IN + group_size; r++)
+				unlink(names[r]);
+		}
+
+// (the runs it was given are the caller's to free)
+		if(names != run_file_names)
+		{
+			for(int r = 0; r < num_runs; r++)
+				free(names[r]);
+
+			free(names);
+		}
+
+		names = merged_names;
+		num_runs = num_merged;
+	}
+
+	if(!failed)
+		failed = mergeRuns(names, num_runs, file_name);
+
+	if(names != run_file_names)
+	{
+		for(int r = 0; r < num_runs; r++)
+		{
+			unlink(names[r]);
+			free(names[r]);
+		}
+
+		free(names);
+	}
+
+	return failed;
+}
+
+// indexFilesExternal indexes the num_files files in files (in the current directory) into
+// file_name, never holding an in-memory index estimated to be bigger than memory_limit bytes.
+// Returns 0 if it succeeds and 1 if it fails.
+int indexFilesExternal(struct dirent** files, int num_files, int skip_code, long memory_limit, char* file_name)
+{
+	INVERTED_INDEX* index;
+	DOC_TERMS* doc_terms;
+	INGEST* ingest;
+	DOCUMENT* document;
+	long num_postings = 0;
+	int file;
+
+	char** run_file_names = NULL;
+	int num_runs = 0;
+	int failed = 0;
+
+	index = initializeDict();
+	doc_terms = initializeDocTerms();
+	ingest = startIngest(files, num_files, INGEST_QUEUE_DEPTH, INGEST_IO_URING);
+
+	do
+	{
+		if((document = nextIngested(ingest, &file)) != NULL)
+		{
+			countDocument(document->contents, document->length, doc_terms, skip_code);
+			num_postings += doc_terms->num_terms;
+
+			for(int t = 0; t < doc_terms->num_terms; t++)
+				updateIndex(docTermKey(doc_terms, t), atoi(files[file]->d_name), doc_terms->terms[t].frequency, index);
+
+			resetDocTerms(doc_terms);
+		}
+
+// flushes a run when the index gets too big, and the last one after the last file
+		if(index->num_entries > 0 && (document == NULL || estimateIndexBytes(index, num_postings) >= memory_limit))
+		{
+			run_file_names = realloc(run_file_names, (num_runs + 1) * sizeof(char*));
+			MALLOC_CHECK(run_file_names);
+			run_file_names[num_runs] = malloc(strlen(file_name) + 20);
+			MALLOC_CHECK(run_file_names[num_runs]);
+			sprintf(run_file_names[num_runs], "%s.run%d", file_name, num_runs);
+
+			failed |= writeRun(index, run_file_names[num_runs++]);
+
+			cleanIndex(index);
+			index = initializeDict();
+			num_postings = 0;
+		}
+	} while(document != NULL);
+
+	finishIngest(ingest);
+	cleanDocTerms(doc_terms);
+	cleanIndex(index);
+
+	if(!failed)
+		failed = mergeRunsInPasses(run_file_names, num_runs, file_name);
+	else
+		fprintf(stderr, "Could not write the runs for %s\n", file_name);
+
+	for(int r = 0; r < num_runs; r++)
+	{
+		unlink(run_file_names[r]);
+		free(run_file_names[r]);
+	}
+
+	free(run_file_names);
+
+	return failed;
+}
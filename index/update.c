@@ -0,0 +1,498 @@
+/*
+	update.c
+
+	Brings an existing index up to date with its crawl directory without
+	reindexing the whole crawl (the indexer's --update option).
+
+	Every build also writes a manifest next to the index ([INDEX FILE].manifest):
+	whether -s was used, the high-water mark (the highest document id in the
+	index), and the modification time and size of every document it indexed.
+
+		manifest 1
+		skip_code 0
+		high_water_mark 1987
+		1 1697040000 123456789 5321		(doc id, mtime seconds, nanoseconds, size)
+		...
+
+	An update compares the directory against the manifest.  Documents past the
+	high-water mark are new, documents whose mtime or size changed are changed,
+	and documents that are gone are removed.  The old postings of changed and
+	removed documents are dropped from the index, and then only the new and
+	changed documents are read and indexed (see ../util/ingest.h).  The index
+	is rewritten in the format it was in, and then the manifest.
+
+	Only the documents that changed are tokenized, so an update's time grows
+	with the change.  Loading, filtering and writing the index still take time
+	in proportion to its size.  Without a manifest, documents past the
+	high-water mark of the index itself are added, and nothing else is checked.
+
+	An update that rewrites the index also drops the documents deleted from it
+	(see compact.c), the same way it drops removed ones, and a deleted document
+	is never indexed again.  The pages past the high-water mark in segments
+	written by the query engine (see ../util/segments.h) are added to the
+	index like any other new page, and then the segments are removed.  Positions written with -p (see
+	../util/positions.h) and biwords written with -w (see ../util/biwords.h)
+	aren't updated; they're removed before the index is rewritten, so phrase
+	queries need a rebuild with -p to be exact again.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "indexer.h"
+#include "../util/header.h"
+#include "../util/file.h"
+#include "../util/ingest.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/docterms.h"
+#include "../util/indexfile.h"
+#include "../util/mapindex.h"
+#include "../util/tombstones.h"
+#include "../util/segments.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
+
+// Returns the name of the manifest of index_file_name (malloced).
+static char* manifestName(char* index_file_name)
+{
+	char* name = malloc(strlen(index_file_name) + strlen(MANIFEST_SUFFIX) + 1);
+
+	MALLOC_CHECK(name);
+	sprintf(name, "%s%s", index_file_name, MANIFEST_SUFFIX);
+
+	return name;
+}
+
+// compares two ManifestEntries by doc id (for qsort)
+static int compareEntries(const void* a, const void* b)
+{
+	const ManifestEntry* first = a;
+	const ManifestEntry* second = b;
+
+	return (first->doc_id > second->doc_id) - (first->doc_id < second->doc_id);
+}
+
+// Returns the entry for doc_id in manifest, or NULL if it doesn't have one.
+static ManifestEntry* findEntry(Manifest* manifest, int doc_id)
+{
+	ManifestEntry key;
+
+	key.doc_id = doc_id;
+
+	return bsearch(&key, manifest->entries, manifest->num_entries, sizeof(ManifestEntry), compareEntries);
+}
+
+// Adds an entry to manifest, growing it if it's full.
+static void addEntry(Manifest* manifest, ManifestEntry* entry)
+{
+	if(manifest->num_entries == manifest->capacity)
+	{
+		manifest->capacity = manifest->capacity * 2 + 64;
+		manifest->entries = realloc(manifest->entries, manifest->capacity * sizeof(ManifestEntry));
+		MALLOC_CHECK(manifest->entries);
+	}
+
+	manifest->entries[manifest->num_entries++] = *entry;
+
+	if(entry->doc_id > manifest->high_water_mark)
+		manifest->high_water_mark = entry->doc_id;
+}
+
+static Manifest* initializeManifest(int skip_code)
+{
+	Manifest* manifest = malloc(sizeof(Manifest));
+
+	MALLOC_CHECK(manifest);
+	manifest->skip_code = skip_code;
+	manifest->high_water_mark = 0;
+	manifest->num_entries = 0;
+	manifest->capacity = 0;
+	manifest->entries = NULL;
+
+	return manifest;
+}
+
+void cleanManifest(Manifest* manifest)
+{
+	free(manifest->entries);
+	free(manifest);
+}
+
+// Stats every page in files (in the current directory), before it's indexed, so a file that
+// changes during the build looks changed to the next update.
+Manifest* scanDocuments(struct dirent** files, int num_files, int skip_code)
+{
+	Manifest* manifest = initializeManifest(skip_code);
+	ManifestEntry entry;
+	struct stat s;
+
+	for(int i = 0; i < num_files; i++)
+	{
+		if(!isDocumentName(files[i]->d_name) || stat(files[i]->d_name, &s) != 0 || !S_ISREG(s.st_mode))
+			continue;
+
+		entry.doc_id = atoi(files[i]->d_name);
+		entry.mtime_sec = s.st_mtim.tv_sec;
+		entry.mtime_nsec = s.st_mtim.tv_nsec;
+		entry.size = s.st_size;
+		addEntry(manifest, &entry);
+	}
+
+	qsort(manifest->entries, manifest->num_entries, sizeof(ManifestEntry), compareEntries);
+
+	return manifest;
+}
+
+// Writes manifest next to index_file_name (through a temporary file, so an update never sees
+// half of one).  Returns 0 if it succeeds and 1 if it fails.
+int writeManifest(Manifest* manifest, char* index_file_name)
+{
+	char* name = manifestName(index_file_name);
+	char* temporary_name = malloc(strlen(name) + 5);
+	FILE* fp;
+	int failed;
+
+	MALLOC_CHECK(temporary_name);
+	sprintf(temporary_name, "%s.new", name);
+
+	if((fp = fopen(temporary_name, "w")) == NULL)
+	{
+		free(temporary_name);
+		free(name);
+		return 1;
+	}
+
+	fprintf(fp, "%s %d\nskip_code %d\nhigh_water_mark %d\n", MANIFEST_MAGIC, MANIFEST_VERSION, manifest->skip_code, manifest->high_water_mark);
+
+	for(int i = 0; i < manifest->num_entries; i++)
+	{
+		fprintf(fp, "%d %ld %ld %ld\n", manifest->entries[i].doc_id, manifest->entries[i].mtime_sec,
+			manifest->entries[i].mtime_nsec, manifest->entries[i].size);
+	}
+
+	failed = (ferror(fp) != 0);
+	failed |= (fclose(fp) != 0);
+	failed = failed || (rename(temporary_name, name) != 0);
+
+	if(failed)
+		unlink(temporary_name);
+
+	free(temporary_name);
+	free(name);
+
+	return failed;
+}
+
+// Reads the manifest of index_file_name.  Returns NULL if there isn't one (or it's broken).
+static Manifest* readManifest(char* index_file_name)
+{
+	char* name = manifestName(index_file_name);
+	FILE* fp = fopen(name, "r");
+	Manifest* manifest;
+	ManifestEntry entry;
+	char magic[16];
+	int version;
+	int skip_code;
+	int high_water_mark;
+
+	free(name);
+
+	if(fp == NULL)
+		return NULL;
+
+	if(fscanf(fp, "%15s %d skip_code %d high_water_mark %d", magic, &version, &skip_code, &high_water_mark) != 4 ||
+		strcmp(magic, MANIFEST_MAGIC) != 0 || version != MANIFEST_VERSION)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	manifest = initializeManifest(skip_code);
+
+	while(fscanf(fp, "%d %ld %ld %ld", &entry.doc_id, &entry.mtime_sec, &entry.mtime_nsec, &entry.size) == 4)
+		addEntry(manifest, &entry);
+
+	if(!feof(fp))
+	{
+		fclose(fp);
+		cleanManifest(manifest);
+		return NULL;
+	}
+
+	fclose(fp);
+
+// the high-water mark covers documents indexed before they were removed from the manifest
+	if(high_water_mark > manifest->high_water_mark)
+		manifest->high_water_mark = high_water_mark;
+
+	return manifest;
+}
+
+// Removes the postings of the documents marked in dropped (indexed by doc id, up to
+// max_doc_id) from every word in index, and the words left without any postings.
+// Returns the index, which is a new one if any word was removed.
+INVERTED_INDEX* dropDocuments(INVERTED_INDEX* index, char* dropped, int max_doc_id)
+{
+	INVERTED_INDEX* kept;
+	PostingList* postings;
+	int num_empty = 0;
+	int num_kept;
+
+	for(WordNode* wordnode = index->start; wordnode != NULL; wordnode = wordnode->next)
+	{
+		postings = wordnode->data;
+		num_kept = 0;
+
+		for(int i = 0; i < postings->num_docs; i++)
+		{
+			if(postings->doc_ids[i] >= 0 && postings->doc_ids[i] <= max_doc_id && dropped[postings->doc_ids[i]])
+				continue;
+
+			postings->doc_ids[num_kept] = postings->doc_ids[i];
+			postings->frequencies[num_kept++] = postings->frequencies[i];
+		}
+
+		postings->num_docs = num_kept;
+		num_empty += (num_kept == 0);
+	}
+
+	if(num_empty == 0)
+		return index;
+
+// words can't be taken out of a dictionary, so the others are moved to a new one (in the same order)
+	kept = initializeDict();
+
+	for(WordNode* wordnode = index->start; wordnode != NULL; wordnode = wordnode->next)
+	{
+		postings = wordnode->data;
+
+		if(postings->num_docs > 0)
+		{
+			addData(kept, postings, wordnode->key);
+			wordnode->data = NULL;
+		}
+	}
+
+	for(WordNode* wordnode = index->start; wordnode != NULL; wordnode = wordnode->next)
+	{
+		if(wordnode->data != NULL)
+			cleanPostings(wordnode->data);
+
+		wordnode->data = NULL;
+	}
+
+	cleanDict(index);
+
+	return kept;
+}
+
+// Returns the format index_file_name is in.
+int indexFormat(char* index_file_name)
+{
+	if(isBinaryIndex(index_file_name))
+		return BINARY_INDEX_FORMAT;
+	else if(isMappedIndex(index_file_name))
+		return MAPPED_INDEX_FORMAT;
+
+	return TEXT_INDEX_FORMAT;
+}
+
+
+// Writes index over index_file_name in the given format (through a temporary file, so a query
+// engine with the old file open or mapped keeps a whole one).  Returns 0 if it succeeds and 1 if it fails.
+int replaceIndexFile(INVERTED_INDEX* index, char* index_file_name, int format, int num_threads)
+{
+	char* temporary_name = malloc(strlen(index_file_name) + 5);
+	int failed;
+
+	MALLOC_CHECK(temporary_name);
+	sprintf(temporary_name, "%s.new", index_file_name);
+
+	if(format == BINARY_INDEX_FORMAT)
+		failed = writeBinaryIndex(index, temporary_name);
+	else if(format == MAPPED_INDEX_FORMAT)
+		failed = writeMappedIndex(index, temporary_name);
+	else
+		failed = saveFile(index, temporary_name, num_threads);
+
+	failed = failed || (rename(temporary_name, index_file_name) != 0);
+
+	if(failed)
+		unlink(temporary_name);
+
+	free(temporary_name);
+
+	return failed;
+}
+
+// updateIndexFile brings index_file_name up to date with the num_files files in files (in the current
+// directory), as described at the top.  Prints what changed if report is 1.  Returns 0 if it
+// succeeds and 1 if it fails.
+int updateIndexFile(struct dirent** files, int num_files, int skip_code, char* index_file_name, int num_threads, int report)
+{
+	INVERTED_INDEX* index;
+	Manifest* old_manifest;
+	Manifest* new_manifest;
+	TOMBSTONES* tombstones;
+	ManifestEntry* old_entry;
+	ManifestEntry* new_entry;
+	struct dirent** changed_files;
+	int num_changed = 0;
+	int num_new = 0;
+	int num_removed = 0;
+	int high_water_mark;
+	char* dropped;
+	int format;
+	int rewrite;
+	int failed;
+
+	DOC_TERMS* doc_terms;
+	INGEST* ingest;
+	DOCUMENT* document;
+	int file;
+
+	format = indexFormat(index_file_name);
+
+	if((index = readIndex(index_file_name)) == NULL)
+	{
+		fprintf(stderr, "Could not read index file %s\n", index_file_name);
+		return 1;
+	}
+
+	if((old_manifest = readManifest(index_file_name)) == NULL)
+	{
+		fprintf(stderr, "No manifest for %s, so only documents past its highest document id are added\n", index_file_name);
+		old_manifest = initializeManifest(skip_code);
+
+// (an empty index has a high-water mark of 0, like an empty manifest)
+		if((old_manifest->high_water_mark = maxIndexDocument(index)) < 0)
+			old_manifest->high_water_mark = 0;
+	}
+	else if(old_manifest->skip_code != skip_code)
+	{
+		fprintf(stderr, "%s was built %s -s, so it has to be updated %s it too\n", index_file_name,
+			old_manifest->skip_code ? "with" : "without", old_manifest->skip_code ? "with" : "without");
+		cleanManifest(old_manifest);
+		cleanIndex(index);
+		return 1;
+	}
+
+	new_manifest = scanDocuments(files, num_files, skip_code);
+	high_water_mark = old_manifest->high_water_mark;
+	tombstones = readTombstones(index_file_name);
+
+	dropped = malloc(high_water_mark + 1);
+	MALLOC_CHECK(dropped);
+	BZERO(dropped, high_water_mark + 1);
+
+	changed_files = malloc((num_files + 1) * sizeof(struct dirent*));
+	MALLOC_CHECK(changed_files);
+
+// new and changed documents, in the order they're listed (document id order)
+	for(int i = 0; i < num_files; i++)
+	{
+		if(!isDocumentName(files[i]->d_name) || (new_entry = findEntry(new_manifest, atoi(files[i]->d_name))) == NULL)
+			continue;
+
+// a deleted document isn't indexed again (one past the high-water mark may have been added by the
+// query engine's -l and deleted since, see ../util/segments.h)
+		if(tombstones != NULL && isTombstoned(tombstones, new_entry->doc_id))
+			continue;
+
+		if(new_entry->doc_id > high_water_mark || new_entry->doc_id < 0)
+			num_new++;
+		else if(old_manifest->num_entries == 0 || ((old_entry = findEntry(old_manifest, new_entry->doc_id)) != NULL &&
+			old_entry->mtime_sec == new_entry->mtime_sec && old_entry->mtime_nsec == new_entry->mtime_nsec && old_entry->size == new_entry->size))
+			continue;
+		else
+		{
+			dropped[new_entry->doc_id] = 1;
+			num_changed++;
+		}
+
+		changed_files[num_new + num_changed - 1] = files[i];
+	}
+
+// documents that are gone
+	for(int i = 0; i < old_manifest->num_entries; i++)
+	{
+		if(findEntry(new_manifest, old_manifest->entries[i].doc_id) == NULL && old_manifest->entries[i].doc_id >= 0)
+		{
+			dropped[old_manifest->entries[i].doc_id] = 1;
+			num_removed++;
+		}
+	}
+
+// the index is only rewritten if something changed, and then the deleted documents are dropped with
+// the rest (see ../util/tombstones.h)
+	rewrite = (num_new + num_changed + num_removed > 0);
+
+	for(int doc_id = 0; rewrite && tombstones != NULL && doc_id <= high_water_mark; doc_id++)
+		dropped[doc_id] |= isTombstoned(tombstones, doc_id);
+
+	if(num_changed + num_removed > 0 || (rewrite && tombstones != NULL))
+		index = dropDocuments(index, dropped, high_water_mark);
+
+	doc_terms = initializeDocTerms();
+	ingest = startIngest(changed_files, num_new + num_changed, INGEST_QUEUE_DEPTH, INGEST_IO_URING);
+
+	while((document = nextIngested(ingest, &file)) != NULL)
+		indexDocument(document->contents, document->length, atoi(changed_files[file]->d_name), doc_terms, skip_code, index, NULL);
+
+	finishIngest(ingest);
+	cleanDocTerms(doc_terms);
+
+// documents removed past the new files' ids still count towards the high-water mark
+	if(high_water_mark > new_manifest->high_water_mark)
+		new_manifest->high_water_mark = high_water_mark;
+
+	failed = 0;
+
+// the positions and biwords (see ../util/positions.h and ../util/biwords.h) would be out of date,
+// so they go before the index changes
+	if(rewrite && removePositions(index_file_name))
+		fprintf(stderr, "%s: removed its positions, which --update doesn't keep (rebuild it with -p for phrase queries)\n", index_file_name);
+
+	if(rewrite && removeBiwords(index_file_name))
+		fprintf(stderr, "%s: removed its biwords, which --update doesn't keep (rebuild it with -w)\n", index_file_name);
+
+	if(rewrite)
+		failed = replaceIndexFile(index, index_file_name, format, num_threads);
+
+// only the documents whose postings were dropped are undeleted: the ones past the high-water
+// mark that were skipped stay deleted
+	if(!failed && rewrite && tombstones != NULL)
+	{
+		keepTombstones(tombstones, dropped, high_water_mark);
+		failed = clearTombstones(index_file_name, tombstones);
+	}
+
+	if(!failed)
+		failed = writeManifest(new_manifest, index_file_name);
+
+// the pages in segments written by the query engine's -l are in the index now
+	if(!failed)
+		removeSegments(index_file_name);
+
+	if(report)
+		printf("%s: %d new, %d changed, %d removed documents\n", index_file_name, num_new, num_changed, num_removed);
+
+	if(tombstones != NULL)
+		cleanTombstones(tombstones);
+
+	free(changed_files);
+	free(dropped);
+	cleanManifest(old_manifest);
+	cleanManifest(new_manifest);
+	cleanIndex(index);
+
+	return failed;
+}
@@ -0,0 +1,537 @@
+/*
+	live.c
+
+	Keeps an index up to date with its crawl directory while the query engine
+	searches it (query -l).  New pages show up in results a few seconds after
+	the crawler writes them, instead of after the next rebuild.
+
+	LIVE_INDEX* openLiveIndex	- opens an index and its segments for searching,
+					  with an empty in-memory segment after them
+
+	int refreshLiveIndex		- reads the documents deleted from the index again,
+					  and indexes the pages in the crawl directory past the
+					  high-water mark into the in-memory segment, with
+					  the indexer's countDocument and updateIndex
+
+	int flushLiveIndex		- writes the in-memory segment out as a new mapped
+					  segment, and merges segments
+
+	void startLiveIndex		- starts a thread that refreshes the index every
+					  LIVE_POLL_SECONDS, and flushes it every
+					  LIVE_FLUSH_SECONDS (or LIVE_FLUSH_DOCUMENTS)
+
+	void closeLiveIndex		- stops the thread, flushes what's left, and frees
+					  the LIVE_INDEX
+
+	The index file itself is never changed.  Every flush adds a segment (see
+	../util/segments.h), and once LIVE_MERGE_FACTOR neighbouring segments are on
+	the same level (a power of LIVE_MERGE_FACTOR times LIVE_MERGE_FLOOR postings)
+	they're merged into one, so there are only a few segments per level.  A
+	search holds the lock (lockLiveIndex) while it goes through the segments.
+	The thread only takes it to add a document's postings to the in-memory
+	segment and to swap segments in and out of the list, so segments are
+	written and merged while searches go on.
+
+	Documents deleted from the index (see ../util/tombstones.h) are deleted from
+	its segments too, from the next refresh on.  Rebuilding or updating the index with the indexer takes
+	in every page, so it removes the segments.
+*/
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "query.h"
+#include "queryfuncs.h"
+#include "live.h"
+#include "../index/indexer.h"
+#include "../util/header.h"
+#include "../util/file.h"
+#include "../util/postings.h"
+#include "../util/dictionary.h"
+#include "../util/docterms.h"
+#include "../util/mapindex.h"
+#include "../util/tombstones.h"
+#include "../util/segments.h"
+
+// returns a new, empty in-memory segment
+static SEARCH_INDEX* memorySegment(void)
+{
+	SEARCH_INDEX* segment = malloc(sizeof(SEARCH_INDEX));
+
+	MALLOC_CHECK(segment);
+	BZERO(segment, sizeof(SEARCH_INDEX));
+	segment->index = initializeDict();
+	segment->segment = -1;
+
+	return segment;
+}
+
+// returns the segment before segment in live's list (segment is never the first, the index file)
+static SEARCH_INDEX* segmentBefore(LIVE_INDEX* live, SEARCH_INDEX* segment)
+{
+	SEARCH_INDEX* before = live->search;
+
+	while(before->next != segment)
+		before = before->next;
+
+	return before;
+}
+
+// takes the name of an index file, its crawl directory and whether it was built with -s
+// opens the index and its segments, ready to add the pages past the highest document id in them
+// returns NULL if the index can't be opened
+LIVE_INDEX* openLiveIndex(char* index_file_name, char* target_dir, int skip_code)
+{
+	LIVE_INDEX* live;
+	SEARCH_INDEX* last;
+	int highest;
+
+	live = malloc(sizeof(LIVE_INDEX));
+	MALLOC_CHECK(live);
+	BZERO(live, sizeof(LIVE_INDEX));
+
+// the names are made absolute, so they still work after the query engine changes directory
+	live->index_file_name = realpath(index_file_name, NULL);
+	live->target_dir = realpath(target_dir, NULL);
+
+	if(live->index_file_name == NULL || live->target_dir == NULL ||
+		(live->search = openSearchIndex(live->index_file_name)) == NULL)
+	{
+		free(live->index_file_name);
+		free(live->target_dir);
+		free(live);
+		return NULL;
+	}
+
+	if((live->segments = readSegmentList(live->index_file_name)) == NULL)
+		live->segments = initializeSegmentList();
+
+	live->high_water_mark = live->segments->high_water_mark;
+
+// (each segment keeps its highest document id, see maxDocumentId)
+	if((highest = maxDocumentId(live->search)) > live->high_water_mark)
+		live->high_water_mark = highest;
+
+	for(last = live->search; last->next != NULL; last = last->next)
+		;
+
+	live->memory = memorySegment();
+	last->next = live->memory;
+
+	live->skip_code = skip_code;
+	live->last_flush = time(NULL);
+	live->doc_terms = initializeDocTerms();
+
+	pthread_mutex_init(&live->lock, NULL);
+	pthread_cond_init(&live->changed, NULL);
+
+	return live;
+}
+
+// reads the documents deleted from live's index again (swapping them in under the lock), then
+// indexes the pages in live's crawl directory past its high-water mark into its in-memory segment,
+// in document id order, stopping at the first one that was changed in the last LIVE_SETTLE_SECONDS
+// each page is counted without the lock, and only its postings are added with it
+// returns the number of pages indexed
+int refreshLiveIndex(LIVE_INDEX* live)
+{
+	struct dirent** files;
+	struct stat s;
+	DOCUMENT document;
+	char* name;
+	char* path;
+	int num_files;
+	int num_indexed = 0;
+	int doc_id;
+	time_t now = time(NULL);
+	TOMBSTONES* deleted;
+	TOMBSTONES* swapped;
+
+// the indexer may have deleted documents (or compacted them away) since the last refresh
+	deleted = readTombstones(live->index_file_name);
+
+	pthread_mutex_lock(&live->lock);
+	swapped = live->search->deleted;
+	live->search->deleted = deleted;
+	pthread_mutex_unlock(&live->lock);
+
+	if(swapped != NULL)
+		cleanTombstones(swapped);
+
+	if((num_files = getFileList(live->target_dir, &files)) <= 0)
+		return 0;
+
+	path = malloc(strlen(live->target_dir) + sizeof(files[0]->d_name) + 2);
+	MALLOC_CHECK(path);
+
+	initializeDocument(&document);
+
+	for(int i = 0; i < num_files; i++)
+	{
+		name = files[i]->d_name;
+
+// only the crawler's pages (named by document id) are indexed
+		if(!isDocumentName(name))
+			continue;
+
+		if((doc_id = atoi(name)) <= live->high_water_mark)
+			continue;
+
+		sprintf(path, "%s/%s", live->target_dir, name);
+
+		if(stat(path, &s) != 0 || !S_ISREG(s.st_mode))
+			continue;
+
+		if(now - s.st_mtime < LIVE_SETTLE_SECONDS)
+			break;
+
+		if(openDocument(&document, path) != 0)
+			continue;
+
+		countDocument(document.contents, document.length, live->doc_terms, live->skip_code);
+		closeDocument(&document);
+
+		pthread_mutex_lock(&live->lock);
+
+		for(int t = 0; t < live->doc_terms->num_terms; t++)
+			updateIndex(docTermKey(live->doc_terms, t), doc_id, live->doc_terms->terms[t].frequency, live->memory->index);
+
+		pthread_mutex_unlock(&live->lock);
+
+		resetDocTerms(live->doc_terms);
+
+		live->high_water_mark = doc_id;
+		live->memory_documents++;
+		num_indexed++;
+	}
+
+	cleanDocument(&document);
+	free(path);
+
+	for(int i = 0; i < num_files; i++)
+		free(files[i]);
+
+	free(files);
+
+	return num_indexed;
+}
+
+// returns the level of a (mapped) segment: 0 under LIVE_MERGE_FLOOR postings, and one more for
+// every LIVE_MERGE_FACTOR times as many
+static int segmentLevel(SEARCH_INDEX* segment)
+{
+	long postings = segment->mapped->num_postings / LIVE_MERGE_FLOOR;
+	int level = 0;
+
+	while(postings > 0)
+	{
+		postings /= LIVE_MERGE_FACTOR;
+		level++;
+	}
+
+	return level;
+}
+
+// returns the position in live's segment list of the newest LIVE_MERGE_FACTOR neighbouring
+// segments on the same level, or -1 if there aren't any
+static int findMerge(LIVE_INDEX* live)
+{
+	SEARCH_INDEX* segment;
+	int levels[live->segments->num_segments + 1];
+	int same;
+
+	segment = live->search->next;
+
+	for(int i = 0; i < live->segments->num_segments; i++, segment = segment->next)
+		levels[i] = segmentLevel(segment);
+
+	for(int first = live->segments->num_segments - LIVE_MERGE_FACTOR; first >= 0; first--)
+	{
+		same = 1;
+
+		for(int i = first + 1; i < first + LIVE_MERGE_FACTOR; i++)
+			same &= (levels[i] == levels[first]);
+
+		if(same)
+			return first;
+	}
+
+	return -1;
+}
+
+// merges the LIVE_MERGE_FACTOR segments starting at position first of live's segment list into
+// a new segment, adding their postings in document id order with updateIndex
+// returns 0 if it succeeds and 1 if it fails (leaving the segments as they were)
+static int mergeSegments(LIVE_INDEX* live, int first)
+{
+	INVERTED_INDEX* merged;
+	INVERTED_INDEX* index;
+	PostingList* postings;
+	SEARCH_INDEX* before;
+	SEARCH_INDEX* segment;
+	SEARCH_INDEX* next;
+	SEARCH_INDEX* replacement;
+	SEGMENT_LIST* list;
+	char* name;
+	int number;
+
+	merged = initializeDict();
+	before = live->search;
+
+	for(int i = 0; i < first; i++)
+		before = before->next;
+
+	segment = before->next;
+
+	for(int i = 0; i < LIVE_MERGE_FACTOR; i++, segment = segment->next)
+	{
+		name = segmentName(live->index_file_name, segment->segment);
+		index = readMappedIndex(name);
+		free(name);
+
+		if(index == NULL)
+		{
+			cleanIndex(merged);
+			return 1;
+		}
+
+		for(WordNode* wordnode = index->start; wordnode != NULL; wordnode = wordnode->next)
+		{
+			postings = wordnode->data;
+
+			for(int p = 0; p < postings->num_docs; p++)
+				updateIndex(wordnode->key, postings->doc_ids[p], postings->frequencies[p], merged);
+		}
+
+		cleanIndex(index);
+	}
+
+	number = live->segments->next_number;
+	name = segmentName(live->index_file_name, number);
+
+	if(writeMappedIndex(merged, name) != 0 || (replacement = openSegment(name, number)) == NULL)
+	{
+		unlink(name);
+		free(name);
+		cleanIndex(merged);
+		return 1;
+	}
+
+	free(name);
+	cleanIndex(merged);
+
+// the new list has the merged segment in place of the others
+	list = initializeSegmentList();
+	list->high_water_mark = live->segments->high_water_mark;
+
+	for(int i = 0; i < live->segments->num_segments; i++)
+	{
+		if(i == first)
+			addSegment(list, number);
+		else if(i < first || i >= first + LIVE_MERGE_FACTOR)
+			addSegment(list, live->segments->numbers[i]);
+	}
+
+	if(list->next_number <= number)
+		list->next_number = number + 1;
+
+	if(writeSegmentList(list, live->index_file_name) != 0)
+	{
+		name = segmentName(live->index_file_name, number);
+		unlink(name);
+		free(name);
+		closeSegment(replacement);
+		cleanSegmentList(list);
+		return 1;
+	}
+
+	cleanSegmentList(live->segments);
+	live->segments = list;
+
+	pthread_mutex_lock(&live->lock);
+
+	segment = before->next;
+	next = segment;
+
+	for(int i = 0; i < LIVE_MERGE_FACTOR; i++)
+		next = next->next;
+
+	before->next = replacement;
+	replacement->next = next;
+
+	pthread_mutex_unlock(&live->lock);
+
+// nothing can be searching the old segments now
+	while(segment != next)
+	{
+		replacement = segment->next;
+		name = segmentName(live->index_file_name, segment->segment);
+		closeSegment(segment);
+		unlink(name);
+		free(name);
+		segment = replacement;
+	}
+
+	return 0;
+}
+
+// writes live's in-memory segment (if it has any documents) out as a new segment, replaces it
+// with an empty one, and then merges segments until no LIVE_MERGE_FACTOR neighbours are on the
+// same level
+// returns 0 if it succeeds and 1 if it fails
+int flushLiveIndex(LIVE_INDEX* live)
+{
+	SEARCH_INDEX* flushed;
+	SEARCH_INDEX* before;
+	SEARCH_INDEX* memory;
+	char* name;
+	int number;
+	int first;
+
+	live->last_flush = time(NULL);
+
+	if(live->memory_documents == 0)
+		return 0;
+
+// only this thread changes the in-memory segment, so it's written out without the lock
+	number = live->segments->next_number;
+	name = segmentName(live->index_file_name, number);
+
+	if(writeMappedIndex(live->memory->index, name) != 0 || (flushed = openSegment(name, number)) == NULL)
+	{
+		unlink(name);
+		free(name);
+		return 1;
+	}
+
+	addSegment(live->segments, number);
+	live->segments->high_water_mark = live->high_water_mark;
+
+	if(writeSegmentList(live->segments, live->index_file_name) != 0)
+	{
+		live->segments->num_segments--;
+		closeSegment(flushed);
+		unlink(name);
+		free(name);
+		return 1;
+	}
+
+	free(name);
+
+	pthread_mutex_lock(&live->lock);
+
+	memory = live->memory;
+	before = segmentBefore(live, memory);
+	before->next = flushed;
+	live->memory = memorySegment();
+	flushed->next = live->memory;
+
+	pthread_mutex_unlock(&live->lock);
+
+	closeSegment(memory);
+	live->memory_documents = 0;
+
+	while((first = findMerge(live)) != -1)
+	{
+		if(mergeSegments(live, first) != 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+// the thread started by startLiveIndex
+static void* liveIndexWorker(void* arg)
+{
+	LIVE_INDEX* live = arg;
+	struct timespec until;
+
+	pthread_mutex_lock(&live->lock);
+
+	while(!live->stop)
+	{
+		pthread_mutex_unlock(&live->lock);
+
+		refreshLiveIndex(live);
+
+		if(live->memory_documents >= LIVE_FLUSH_DOCUMENTS ||
+			(live->memory_documents > 0 && time(NULL) - live->last_flush >= LIVE_FLUSH_SECONDS))
+		{
+			if(flushLiveIndex(live) != 0)
+				fprintf(stderr, "Could not flush the new pages of %s (they're still searched in memory)\n", live->index_file_name);
+		}
+
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += LIVE_POLL_SECONDS;
+
+		pthread_mutex_lock(&live->lock);
+
+		if(!live->stop)
+			pthread_cond_timedwait(&live->changed, &live->lock, &until);
+	}
+
+	pthread_mutex_unlock(&live->lock);
+
+	return NULL;
+}
+
+// starts keeping live up to date in the background
+void startLiveIndex(LIVE_INDEX* live)
+{
+	live->stop = 0;
+	live->running = (pthread_create(&live->thread, NULL, liveIndexWorker, live) == 0);
+
+	if(!live->running)
+		fprintf(stderr, "Could not start keeping %s up to date\n", live->index_file_name);
+}
+
+// has to be held while searching live->search
+void lockLiveIndex(LIVE_INDEX* live)
+{
+	pthread_mutex_lock(&live->lock);
+}
+
+void unlockLiveIndex(LIVE_INDEX* live)
+{
+	pthread_mutex_unlock(&live->lock);
+}
+
+// stops the thread, flushes the in-memory segment (so its pages aren't indexed again next time),
+// and frees live
+void closeLiveIndex(LIVE_INDEX* live)
+{
+	if(live->running)
+	{
+		pthread_mutex_lock(&live->lock);
+		live->stop = 1;
+		pthread_cond_signal(&live->changed);
+		pthread_mutex_unlock(&live->lock);
+
+		pthread_join(live->thread, NULL);
+		live->running = 0;
+	}
+
+	if(flushLiveIndex(live) != 0)
+		fprintf(stderr, "Could not flush the new pages of %s\n", live->index_file_name);
+
+	closeSearchIndex(live->search);
+	cleanSegmentList(live->segments);
+	cleanDocTerms(live->doc_terms);
+
+	pthread_mutex_destroy(&live->lock);
+	pthread_cond_destroy(&live->changed);
+
+	free(live->index_file_name);
+	free(live->target_dir);
+	free(live);
+}
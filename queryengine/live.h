@@ -0,0 +1,79 @@
+/*
+	live.h
+
+	A LIVE_INDEX keeps an index up to date with its crawl directory while
+	it's being searched (the query engine's -l option, see live.c).
+
+	LIVE_INDEX data structure
+		search			- the index and its segments (a SEARCH_INDEX list),
+					  with the in-memory segment (memory) last
+		segments		- the segment list on disk (see ../util/segments.h)
+		high_water_mark		- the highest document id indexed so far
+		memory_documents	- the number of documents in the in-memory segment
+		lock			- held while searching, and while the list or the
+					  in-memory segment changes
+*/
+
+#ifndef _LIVE_H_
+#define _LIVE_H_
+
+#include <time.h>
+#include <pthread.h>
+
+#include "../util/docterms.h"
+#include "../util/segments.h"
+
+// seconds between looks at the crawl directory for new pages
+#define LIVE_POLL_SECONDS 1
+
+// a page is only indexed once it hasn't changed for this many seconds (so the crawler is done with it)
+#define LIVE_SETTLE_SECONDS 1
+
+// the in-memory segment is flushed once it's this old (in seconds) or holds this many documents
+#define LIVE_FLUSH_SECONDS 30
+#define LIVE_FLUSH_DOCUMENTS 1000
+
+// this many neighbouring segments of the same level are merged into one
+#define LIVE_MERGE_FACTOR 4
+
+// segments with fewer postings than this are all on the lowest level
+#define LIVE_MERGE_FLOOR 100000
+
+typedef struct _LIVE_INDEX
+{
+	char* index_file_name;
+	char* target_dir;
+	int skip_code;
+
+	SEARCH_INDEX* search;
+	SEARCH_INDEX* memory;
+	SEGMENT_LIST* segments;
+	int high_water_mark;
+	int memory_documents;
+	time_t last_flush;
+	DOC_TERMS* doc_terms;
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	pthread_t thread;
+	int running;
+	int stop;
+} __LIVE_INDEX;
+
+typedef struct _LIVE_INDEX LIVE_INDEX;
+
+LIVE_INDEX* openLiveIndex(char* index_file_name, char* target_dir, int skip_code);
+
+int refreshLiveIndex(LIVE_INDEX* live);
+
+int flushLiveIndex(LIVE_INDEX* live);
+
+void startLiveIndex(LIVE_INDEX* live);
+
+void lockLiveIndex(LIVE_INDEX* live);
+
+void unlockLiveIndex(LIVE_INDEX* live);
+
+void closeLiveIndex(LIVE_INDEX* live);
+
+#endif
@@ -1,23 +1,57 @@
 /*
-	INPUT: query [INDEX FILE] [TARGET DIR WHERE PAGES ARE LOCATED]
+	INPUT: query [-l [-s]] [-k N] [INDEX FILE] [TARGET DIR WHERE PAGES ARE LOCATED]
+
+	[INDEX FILE] can be in any index format.  A mapped index (made by 
+	../index/indexconvert -m) is searched in place instead of being read,
+	so startup takes the same time however big the index is.  Documents
+	deleted from the index (with ../index/indexer --delete) are left out.
+
+	-l keeps the index up to date while it's searched (see live.c): pages the
+	crawler adds to [TARGET DIR] are indexed in the background and show up in
+	results within a few seconds, and are written out as segments of the
+	index (see ../util/segments.h), which any later query engine searches too.
+	-s (with -l) leaves out script, style and comment bodies, and has to match
+	how the index was built (see ../index/indexer.c).
+	-k N lists the top N results instead of MAX_OUTPUTTED_RESULTS, and -k 0
+	lists all of them.
 
 	While looping, waits for KEY WORD(s)
 		- words separated by " " are ANDed together
 		- words separated by "OR" are ORed together
 		- AND > OR (ie cat dog OR mouse = (cat AND dog) OR mouse)
+		- words in double quotes are a phrase, which only matches pages
+		  where they occur next to each other, in that order ("new york");
+		  this needs an index built with ../index/indexer -p, otherwise
+		  (and in segments written by -l) a phrase matches any page
+		  holding all of its words; with ../index/indexer -w, common
+		  two-word phrases are looked up as pairs without reading positions
 		
 		- entering q will break out of the loop and quit the program
 
 	OUTPUT: Lists the top MAX_OUTPUTTED_RESULTS (in this case 10) for a
-		given search (as outlined above), ordered in rank from least
-		to greatest.
+		given search (as outlined above), ordered in rank from greatest
+		to least, pages with the same rank by page id.  Only the top
+		results are kept while they're ranked (see ../util/topk.h), so
+		a query matching every page costs about as much as one matching
+		a few.
 	
 	Calculating Rank:
-		For words ANDed together, rank = sum of individual occurences per page.
+		For words ANDed together, only pages holding all of them match, and
+		rank = sum of individual occurences per page.  The rarest word's
+		list is intersected with each of the others' (see
+		../util/intersect.h), so a common word in a query costs little.
+		A phrase counts as one word, occuring as many times as the phrase does.
 		
 		For a certain page, if (cat AND dog) OR mouse was the query, and the 
 		first QUERY had a rank of 10 for that page, and the second QUERY had
 		a rank of 11, the page's overall rank is 11 (OR defaults to the larger).
+		With OR_TREE_CLAUSES QUERYs or more, big, scattered matches are
+		merged a page at a time instead (see ../util/losertree.h), so each
+		page is ranked once. useOrTree in query.h makes that choice: it
+		needs OR_TREE_MATCHES matches in all, each QUERY's under 1 in
+		OR_TREE_SPREAD of the pages, so on the crawls this engine builds
+		it only happens with enough QUERYs over an index of millions of
+		pages; smaller ones always add a QUERY at a time.
 
 	Data Structures:
 		Uses: All the structures used in crawler + indexer
@@ -36,7 +70,10 @@
 					1) search_words = ["cat", "dog"]
 					2) search_words = ["fish"]
 
-		RESULT* results[MAX_NUM_FILES] - each index corresponds to a file
+		ACCUMULATOR (see ../util/accumulator.h) - the rank of each page a
+			query matches, kept in a hash table when it matches a few
+			pages and in arrays indexed by page id (as big as the
+			highest page id in the index) when it matches many
 
 	Definitions:
 		MAX_NUM_KEYWORDS	- the maximum number of individual words per QUERY
@@ -50,19 +87,18 @@
 		MAX_INPUT_LENGTH	- maximum length of an input line from the terminal
 					- set to 1000
 		MAX_OUTPUTTED_RESULTS	- max # of results outputted 
-					- set to 10
-		MAX_NUM_FILES		- maximum number of files contained in [TARGET DIR]
-					- set to 3000 (about 1000 more than crawled at depth 3)
+					- set to 10 (or to N with -k N)
 		
 		Besides MAX_OUTPUTTED_RESULTS, breaking any of these boundaries results 
-		in a SEGFAULT.
+		in a SEGFAULT.  There's no limit on the number of pages.
 
 	Pseudocode:
 		1) Validates input
-		2) Read index into INVERTED_INDEX data structure.
+		2) Open the index (see openSearchIndex in queryfuncs.c), and with -l,
+		   start keeping it up to date (see startLiveIndex in live.c).
 		3) Continuous while loop
 			1) Separate user query into QUERYs (pullQueries)
-			2) buildResult() using QUERYs
+			2) buildResult() using QUERYs (holding the live index's lock)
 			3) sortResults()
 			4) printResults()
 
@@ -80,11 +116,13 @@
 
 #include "query.h"
 #include "queryfuncs.h"
+#include "live.h"
 #include "../util/header.h"
 #include "../util/html.h"
 #include "../util/file.h"
 #include "../util/hash.h"
 #include "../util/dictionary.h"
+#include "../util/mapindex.h"
 
 int main(int argc, char *argv[])
 {
@@ -92,26 +130,62 @@ int main(int argc, char *argv[])
 	char* index_file;
 	char* target_dir;
 
-	INVERTED_INDEX* index;				// where index_file is read into
+	SEARCH_INDEX* index;				// where index_file is opened (or read into)
+	LIVE_INDEX* live;					// keeps index up to date with -l, NULL otherwise
+
+	int live_flag;						// 1 with -l
+	int skip_code_flag;					// 1 with -s
+	int max_results;					// N with -k N, 0 for all results
+	int arg;
 
 	char* input_line;					// reads input_line
 
 	QUERY* queries[MAX_NUM_QUERIES];	// holds QUERY structures
 	int num_queries;					// corresponds to the length of queries
 
-	RESULT results[MAX_NUM_FILES];		
-	RESULT sorted_results[MAX_NUM_FILES];	
+	ACCUMULATOR* accumulator;			// adds up the rank of each page
+	RESULT* sorted_results;				// the results printed
+	int results_capacity;				// room in sorted_results
 	int num_results;					// length of sorted_results
-
-	int temp_counts[MAX_NUM_FILES];		// used for ORing 
 	
 	int query_return_val;				// stores the return value of pullQueries
 
 	program_name = argv[0];
+	live = NULL;
+	live_flag = 0;
+	skip_code_flag = 0;
+	max_results = MAX_OUTPUTTED_RESULTS;
+
+// options come before the other arguments
+	for(arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if(strcmp(argv[arg], "-l") == 0)
+			live_flag = 1;
+		else if(strcmp(argv[arg], "-s") == 0)
+			skip_code_flag = 1;
+		else if(strcmp(argv[arg], "-k") == 0 && arg + 1 < argc)
+		{
+			max_results = atoi(argv[++arg]);
+
+			if(max_results < 0 || strspn(argv[arg], "0123456789") != strlen(argv[arg]))
+			{
+				fprintf(stderr, "%s: Bad number of results: %s\n", program_name, argv[arg]);
+				return -1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "%s: Unknown option %s\n", program_name, argv[arg]);
+			return -1;
+		}
+	}
+
+	argc -= arg - 1;
+	argv += arg - 1;
 
 	if(argc != 3)						// if incorrect # of arguments
 	{
-		fprintf(stderr, "%s: Requires [INDEX FILE] [TARGET DIRECTORY] as arguments.\n", program_name);
+		fprintf(stderr, "%s: Requires [-l [-s]] [-k N] [INDEX FILE] [TARGET DIRECTORY] as arguments.\n", program_name);
 		return -1;
 	}
 
@@ -130,9 +204,35 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	index = readIndex(index_file);	// reads index_file into INVERTED_INDEX
+// opens index_file (a mapped index is searched in place, any other is read into an INVERTED_INDEX)
+	if(live_flag)
+	{
+		if((live = openLiveIndex(index_file, target_dir, skip_code_flag)) == NULL)
+		{
+			fprintf(stderr, "%s: Could not read index file: %s\n", program_name, index_file);
+			return -1;
+		}
+
+		index = live->search;
+	}
+	else if((index = openSearchIndex(index_file)) == NULL)
+	{
+		fprintf(stderr, "%s: Could not read index file: %s\n", program_name, index_file);
+		return -1;
+	}
+
 	chdir(target_dir);				// changes directory to the target_dir
 
+// sized for the pages in the index (it grows if pages with higher ids come along)
+	accumulator = initializeAccumulator(maxDocumentId(index) + 1, ACCUMULATE_SPARSE);
+
+	results_capacity = (max_results > 0) ? max_results : 1;
+	sorted_results = malloc(results_capacity * sizeof(RESULT));
+	MALLOC_CHECK(sorted_results);
+
+	if(live != NULL)
+		startLiveIndex(live);
+
 	while( 1 )					// continuous loop
 	{
 		num_queries = 0;
@@ -166,26 +266,43 @@ int main(int argc, char *argv[])
 		}
 
 // buildResults goes through each query and each keyword contained in each 
-// query it generates DocumentNodes (ie RESULTs) for each page which contains 
-// any of the words, placing them into "results," using page_id as the index
-// temp_counts corresponds to results, and is used to determine ORing and 
-// whether or not a result exists
-		buildResults(index, results, temp_counts, queries, num_queries);	
+// query and adds up the rank of each page which contains any of the words
+// in accumulator, which also takes care of ORing
+// with -l, the segments don't change while they're being searched
+		if(live != NULL)
+			lockLiveIndex(live);
+
+		buildResults(index, accumulator, queries, num_queries);	
 
-// sortResults goes through the entirety of buildResults, sorts it from 
-// greatest rank to least rank and places them into sorted_results 
-// (ignoring empty indices) it returns the total number of results sorted
-		num_results = sortResults(results, temp_counts, sorted_results);
+		if(live != NULL)
+			unlockLiveIndex(live);
+
+// with -k 0, sorted_results needs room for every page matched
+		if(max_results == 0 && accumulator->num_touched > results_capacity)
+		{
+			results_capacity = accumulator->num_touched;
+			sorted_results = realloc(sorted_results, results_capacity * sizeof(RESULT));
+			MALLOC_CHECK(sorted_results);
+		}
+
+// sortResults goes through the pages buildResults matched, keeps the best
+// max_results of them, sorts those from greatest rank to least rank and
+// places them into sorted_results (emptying accumulator) it returns the
+// total number of results sorted
+		num_results = sortResults(accumulator, sorted_results, max_results);
 
 // printResults outputs the sorted_results in an easily understandable fashion
 		printResults(sorted_results, num_results);
 		
-		BZERO(results, MAX_NUM_FILES);
-		BZERO(temp_counts, MAX_NUM_FILES);
 		BZERO(queries, num_queries);
-		BZERO(sorted_results, MAX_NUM_FILES);
 	}
 
-// frees index data structure
-	cleanIndex(index);
+	cleanAccumulator(accumulator);
+	free(sorted_results);
+
+// frees index data structure (writing out the pages only indexed in memory with -l)
+	if(live != NULL)
+		closeLiveIndex(live);
+	else
+		closeSearchIndex(index);
 }
@@ -5,8 +5,20 @@
 
 	QUERY data structure 	- contains a list of keywords ANDed together
 							- OR separates different QUERYs
+							- a phrase in double quotes is one keyword, its
+							  words separated by single spaces
 
 	RESULT data structure = DocumentNode (each one matches a page)
+
+	SEARCH_INDEX data structure - the index queries are run against, either
+							read into an INVERTED_INDEX or a mapped index
+							file searched in place (see ../util/mapindex.h),
+							the documents deleted from it (see
+							../util/tombstones.h), and the positions of its
+							words and its biwords (see ../util/positions.h
+							and ../util/biwords.h)
+							- an index with segments (see ../util/segments.h)
+							is a list of SEARCH_INDEXes, one per segment
 */
 
 #define MAX_NUM_QUERIES 20
@@ -14,9 +26,27 @@
 #define MAX_KEYWORD_LENGTH 50
 #define MAX_URL_LENGTH 2096
 #define MAX_INPUT_LENGTH 1000
-#define MAX_NUM_FILES 3000
+#define MAX_OUTPUTTED_RESULTS 10
+
+// the QUERYs are ORed through a loser tree (see ../util/losertree.h) only when there are at
+// least OR_TREE_CLAUSES of them, matching OR_TREE_MATCHES pages in all, each under 1 in
+// OR_TREE_SPREAD of the pages (see ../bench/union_bench.c); otherwise a QUERY at a time is faster
+#define OR_TREE_CLAUSES 4
+#define OR_TREE_MATCHES 400000
+#define OR_TREE_SPREAD 32
+
+// 1 if num_clauses QUERYs matching num_matches pages in all, in an index of max_documents pages,
+// are ORed through the loser tree, 0 if a QUERY at a time
+#define useOrTree(num_clauses, num_matches, max_documents) \
+	((num_clauses) >= OR_TREE_CLAUSES && (num_matches) >= OR_TREE_MATCHES && \
+	(num_matches) / (num_clauses) < (max_documents) / OR_TREE_SPREAD)
 
 #include "../util/dictionary.h"
+#include "../util/mapindex.h"
+#include "../util/tombstones.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
+#include "../util/accumulator.h"
 
 typedef struct _QUERY
 {
@@ -26,3 +56,22 @@ typedef struct _QUERY
 typedef struct _QUERY QUERY;
 
 typedef struct _DocumentNode RESULT;
+
+// exactly one of index and mapped is set, deleted is NULL if no documents are deleted
+// positions is NULL if the index was built without them (the indexer's -p), biwords
+// without -w
+// segment is the segment's number (0 for the index file itself, -1 for one still in memory)
+// next is the segment after it (with higher document ids), NULL for the last one
+// the deleted documents of the first segment are deleted from all of them
+typedef struct _SEARCH_INDEX
+{
+	INVERTED_INDEX* index;
+	MAPPED_INDEX* mapped;
+	TOMBSTONES* deleted;
+	POSITIONS_FILE* positions;
+	MAPPED_INDEX* biwords;
+	int segment;
+	struct _SEARCH_INDEX* next;
+} __SEARCH_INDEX;
+
+typedef struct _SEARCH_INDEX SEARCH_INDEX;
@@ -11,8 +11,8 @@
    It tests the following functions, which can all be found in query.h/.c:
 
    	int pullQueries(char* input_line);
-	void buildResults(INVERTED_INDEX* index, RESULT* results, int* temp_counts);
-	int sortResults(RESULT* results, int* temp_counts, RESULT* sorted_results);
+	void buildResults(SEARCH_INDEX* index, ACCUMULATOR* accumulator, QUERY** queries, int num_queries);
+	int sortResults(ACCUMULATOR* accumulator, RESULT* sorted_results, int k);
 	void printResults(RESULT* sorted_results, int num_results);	
 
    It depends on the following functions which are defined elsewhere and not tested here:
@@ -53,9 +53,13 @@
    This test case calls pullQueries() for the condition where input_line should create
    3 separate QUERY structures (ie at least 2 ORs and multiple ANDs).
 
+   Test case: pullQueries:9
+   This test case calls pullQueries() for the condition where input_line has phrases in
+   double quotes (with an "OR" inside one, and one left open at the end).
+
    -----
 
-   void buildResults(INVERTED_INDEX* index, RESULT* results, int* temp_counts);
+   void buildResults(SEARCH_INDEX* index, ACCUMULATOR* accumulator, QUERY** queries, int num_queries);
 
    Test case: buildResults:1
    This test case calls buildResults() for keywords that don't exist in index.
@@ -63,13 +67,57 @@
    Test case: buildResults:2
    This test case calls buildResults() for a keyword which should return results.
 
+   Test case: buildResults:3
+   This test case calls buildResults() on a mapped copy of the index, which should give
+   the same results as the index that was read in.
+
+   Test case: buildResults:4
+   This test case calls buildResults() on a copy of the index with a document deleted,
+   which should give the same results without that document.
+
+   Test case: buildResults:5
+   This test case calls buildResults() on a live index (see live.c) after pages are added
+   to its crawl directory, which should find them before and after they're written out as
+   segments, and merges the segments once there are LIVE_MERGE_FACTOR of them.
+
+   Test case: buildResults:6
+   This test case calls buildResults() for phrase queries on an index built with positions,
+   which should only match pages with the words next to each other, and on the same index
+   without them, which should match every page holding all the words.  A common word is also
+   put in a phrase with a rare one on an index of several POSITIONS_SKIP_INTERVALs of pages,
+   so its positions are skipped through (see ../util/positions.h).
+
+   Test case: buildResults:7
+   This test case calls buildResults() for phrase queries on an index built with biwords of
+   pairs in at least 2 documents (and no positions), which should answer two-word phrases in
+   them exactly and narrow down longer phrases, and should give the same results as positions.
+
+   Test case: buildResults:8
+   This test case calls buildResults() with a sparse and a dense ACCUMULATOR, on an index with
+   page ids in the millions, for queries matching a few of its pages and most of them, which
+   should give the same results either way (and leave nothing behind for the next query).
+
+   Test case: buildResults:9
+   This test case calls buildResults() for words ANDed together, a rare one and common ones,
+   which should only match the pages holding all of them (ranked by the sum of their counts),
+   as worked out page by page, with every level of SIMD intersection (see ../util/intersect.h).
+
+   Test case: buildResults:10
+   This test case calls buildResults() for up to 7 QUERYs ORed together, overlapping and not,
+   one matching nothing and one repeated, and for 4 big, scattered ones (ORed through a loser
+   tree), which should rank each page by its best QUERY (as worked out page by page).
+
    -----
 
-   int sortResults(RESULT* results, int* temp_counts, RESULT* sorted_results);
+   int sortResults(ACCUMULATOR* accumulator, RESULT* sorted_results, int k);
 
    Test case: sortResults:1
    This test case calls sortResults() in the case where results is unordered.
 
+   Test case: sortResults:2
+   This test case calls sortResults() for only the best 3 results, which should be the first 3
+   of all of them sorted, with ties in rank sorted by page id.
+
    -----
 
    void printResults(RESULT* sorted_results, int num_results);
@@ -84,9 +132,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
 #include "query.h"
 #include "queryfuncs.h"
+#include "live.h"
+#include "../index/indexer.h"
 #include "../util/header.h"
+#include "../util/segments.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
+#include "../util/intersect.h"
 
 // -----------------
 //      MACROS
@@ -135,7 +193,7 @@
 // Test case: pullQueries:1
 // This test case calls pullQueries() for the condition where input_line is an empty string.
 
-INVERTED_INDEX* index; 
+SEARCH_INDEX* index; 
 
 int pullQueries1()
 {
@@ -330,6 +388,39 @@ int pullQueries8()
 	END_TEST_CASE;
 }
 
+// Test case: pullQueries:9
+// This test case calls pullQueries() for the condition where input_line has phrases in
+// double quotes (with an "OR" inside one, and one left open at the end).
+
+int pullQueries9()
+{
+	START_TEST_CASE;
+	
+	int return_val;
+	char* input_line="\"New York\" pizza OR \"this OR that\" \"left open\n";
+	int num_queries;
+	QUERY* queries[MAX_NUM_QUERIES];
+	
+	return_val = pullQueries(input_line, queries, &num_queries);
+	
+	SHOULD_BE(return_val == 0);
+	SHOULD_BE(num_queries == 2);
+	SHOULD_BE(strcmp((queries[0]->search_words)[0], "new york") == 0);
+	SHOULD_BE(strcmp((queries[0]->search_words)[1], "pizza") == 0);
+	SHOULD_BE((queries[0]->search_words)[2] == NULL);
+	SHOULD_BE(strcmp((queries[1]->search_words)[0], "this or that") == 0);
+	SHOULD_BE(strcmp((queries[1]->search_words)[1], "left open") == 0);
+	SHOULD_BE((queries[1]->search_words)[2] == NULL);
+
+	free(queries[0]->search_words[0]);
+	free(queries[0]->search_words[1]);
+	free(queries[0]);
+	free(queries[1]->search_words[0]);
+	free(queries[1]->search_words[1]);
+	free(queries[1]);
+	END_TEST_CASE;
+}
+
 // Test case: buildResults:1
 // This test case calls buildResults() for keywords that don't exist in index.
 
@@ -340,20 +431,21 @@ int buildResults1()
 	QUERY* queries[MAX_NUM_QUERIES];
 	int num_queries;
 
-	RESULT results[MAX_NUM_FILES];
-	int temp_counts[MAX_NUM_FILES];
-
-	BZERO(results, MAX_NUM_FILES);
-	BZERO(temp_counts, MAX_NUM_FILES);
+	int max_id = maxDocumentId(index);
+	ACCUMULATOR* accumulator = initializeAccumulator(max_id + 1, ACCUMULATE_SPARSE);
 
 	char* input_line = "thisclearlydoesntexist OR neitherdoesthissilly\n";
 
 	pullQueries(input_line, queries, &num_queries);
 
-	buildResults(index, results, temp_counts, queries, num_queries);
+	buildResults(index, accumulator, queries, num_queries);
 
-	for(int i=0; i < MAX_NUM_FILES; i++)
-		SHOULD_BE(temp_counts[i] == 0);
+	SHOULD_BE(accumulator->num_touched == 0);
+
+	for(int i=0; i <= max_id; i++)
+		SHOULD_BE(accumulatedRank(accumulator, i) == 0);
+
+	cleanAccumulator(accumulator);
 
 	END_TEST_CASE;
 }
@@ -368,28 +460,781 @@ int buildResults2()
 	QUERY* queries[MAX_NUM_QUERIES];
 	int num_queries;
 
-	RESULT results[MAX_NUM_FILES];
-	int temp_counts[MAX_NUM_FILES];
+	int max_id = maxDocumentId(index);
+	ACCUMULATOR* accumulator = initializeAccumulator(max_id + 1, ACCUMULATE_SPARSE);
 	int flag = 0;
 
-	BZERO(results, MAX_NUM_FILES);
-	BZERO(temp_counts, MAX_NUM_FILES);
-
 	char* input_line = "dartmouth\n";
 
 	pullQueries(input_line, queries, &num_queries);
 
-	buildResults(index, results, temp_counts, queries, num_queries);
+	buildResults(index, accumulator, queries, num_queries);
 
-	for(int i=0; i < MAX_NUM_FILES; i++)
-		if(temp_counts[i] != 0)
+	for(int i=0; i <= max_id; i++)
+		if(accumulatedRank(accumulator, i) != 0)
 			flag = 1;
 
 	SHOULD_BE(flag == 1);
 
+	cleanAccumulator(accumulator);
+
+	END_TEST_CASE;
+}
+
+// Test case: buildResults:3
+// This test case calls buildResults() on a mapped copy of the index, which should give
+// the same results as the index that was read in.
+
+int buildResults3()
+{
+	START_TEST_CASE;
+
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+
+	SEARCH_INDEX* mapped;
+
+	int max_id = maxDocumentId(index);
+	ACCUMULATOR* accumulator = initializeAccumulator(max_id + 1, ACCUMULATE_SPARSE);
+	ACCUMULATOR* mapped_accumulator;
+
+	char* input_line = "dartmouth college OR computer OR thisclearlydoesntexist\n";
+
+	SHOULD_BE(writeMappedIndex(index->index, "mapped_test_index.dat") == 0);
+	SHOULD_BE((mapped = openSearchIndex("mapped_test_index.dat")) != NULL);
+
+	if(mapped == NULL)
+		END_TEST_CASE;
+
+	SHOULD_BE(mapped->mapped != NULL);
+	SHOULD_BE(maxDocumentId(mapped) == max_id);
+
+	mapped_accumulator = initializeAccumulator(maxDocumentId(mapped) + 1, ACCUMULATE_SPARSE);
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(index, accumulator, queries, num_queries);
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(mapped, mapped_accumulator, queries, num_queries);
+
+	SHOULD_BE(accumulator->num_touched == mapped_accumulator->num_touched);
+
+	for(int i=0; i <= max_id; i++)
+		SHOULD_BE(accumulatedRank(accumulator, i) == accumulatedRank(mapped_accumulator, i));
+
+	cleanAccumulator(accumulator);
+	cleanAccumulator(mapped_accumulator);
+	closeSearchIndex(mapped);
+	remove("mapped_test_index.dat");
+
+	END_TEST_CASE;
+}
+
+// Test case: buildResults:4
+// This test case calls buildResults() on a copy of the index with a document deleted,
+// which should give the same results without that document.
+
+int buildResults4()
+{
+	START_TEST_CASE;
+
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+
+	SEARCH_INDEX* deleted;
+
+	int max_id = maxDocumentId(index);
+	ACCUMULATOR* accumulator = initializeAccumulator(max_id + 1, ACCUMULATE_SPARSE);
+	ACCUMULATOR* deleted_accumulator = initializeAccumulator(max_id + 1, ACCUMULATE_SPARSE);
+	int deleted_id = -1;
+
+	char* input_line = "dartmouth\n";
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(index, accumulator, queries, num_queries);
+
+	for(int i=0; i <= max_id && deleted_id == -1; i++)
+		if(accumulatedRank(accumulator, i))
+			deleted_id = i;
+
+	SHOULD_BE(deleted_id != -1);
+	SHOULD_BE(writeMappedIndex(index->index, "deleted_test_index.dat") == 0);
+	SHOULD_BE(deleteDocument("deleted_test_index.dat", deleted_id) == 0);
+	SHOULD_BE((deleted = openSearchIndex("deleted_test_index.dat")) != NULL);
+
+	if(deleted == NULL)
+		END_TEST_CASE;
+
+	SHOULD_BE(deleted->deleted != NULL && deleted->deleted->num_deleted == 1);
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(deleted, deleted_accumulator, queries, num_queries);
+
+	for(int i=0; i <= max_id; i++)
+	{
+		SHOULD_BE(accumulatedRank(deleted_accumulator, i) == ((i == deleted_id) ? 0 : accumulatedRank(accumulator, i)));
+	}
+
+	cleanAccumulator(accumulator);
+	cleanAccumulator(deleted_accumulator);
+	closeSearchIndex(deleted);
+	remove("deleted_test_index.dat");
+	remove("deleted_test_index.dat.deleted");
+
+	END_TEST_CASE;
+}
+
+// writes a page (its URL, its depth, and then the HTML) with the given text as document doc_id
+// in directory, dated a minute ago
+// (so a live index takes it straight away)
+void writePage(char* directory, int doc_id, char* text)
+{
+	char name[100];
+	struct utimbuf times;
+	FILE* fp;
+
+	sprintf(name, "%s/%d", directory, doc_id);
+	fp = fopen(name, "w");
+	fprintf(fp, "http://test/%d\n1\n<html><body>%s</body></html>\n", doc_id, text);
+	fclose(fp);
+
+	times.actime = time(NULL) - 60;
+	times.modtime = times.actime;
+	utime(name, &times);
+}
+
+// runs input_line against index, returning the rank of doc_id (0 if it isn't found)
+int rankOf(SEARCH_INDEX* index, char* input_line, int doc_id)
+{
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+	ACCUMULATOR* accumulator = initializeAccumulator(maxDocumentId(index) + 1, ACCUMULATE_SPARSE);
+	int rank;
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(index, accumulator, queries, num_queries);
+
+	rank = accumulatedRank(accumulator, doc_id);
+	cleanAccumulator(accumulator);
+
+	return rank;
+}
+
+// indexes the HTML text of pages as documents 1 to num_pages, with their positions and biwords
+// in extras (see ../index/indexer.h) if it isn't NULL, and returns the index
+INVERTED_INDEX* indexPages(char** pages, int num_pages, PhraseIndexes* extras)
+{
+	INVERTED_INDEX* built = initializeDict();
+	DOC_TERMS* doc_terms = initializeDocTerms();
+	char contents[200];
+
+	recordPositions(doc_terms, 1);
+
+	for(int doc_id = 1; doc_id <= num_pages; doc_id++)
+	{
+		sprintf(contents, "http://test/%d\n1\n<html><body>%s</body></html>\n", doc_id, pages[doc_id - 1]);
+		indexDocument(contents, strlen(contents), doc_id, doc_terms, 0, built, extras);
+	}
+
+	cleanDocTerms(doc_terms);
+
+	return built;
+}
+
+// writes built as the mapped index file_name, with the positions and biwords in extras if it
+// isn't NULL, frees them, and opens it for searching (NULL if it can't be written or opened)
+SEARCH_INDEX* openTestIndex(char* file_name, INVERTED_INDEX* built, PhraseIndexes* extras)
+{
+	int failed = writeMappedIndex(built, file_name);
+
+	if(extras != NULL && extras->positional != NULL)
+	{
+		failed |= writePositions(extras->positional, file_name);
+		cleanPositionalIndex(extras->positional);
+	}
+
+	if(extras != NULL && extras->biwords != NULL)
+	{
+		failed |= writeBiwords(extras->biwords, file_name);
+		cleanIndex(extras->biwords);
+		cleanDocTerms(extras->pairs);
+	}
+
+	cleanIndex(built);
+
+	return failed ? NULL : openSearchIndex(file_name);
+}
+
+// closes index (if it was opened) and removes file_name along with its positions and biwords
+void removeTestIndex(SEARCH_INDEX* index, char* file_name)
+{
+	if(index != NULL)
+		closeSearchIndex(index);
+
+	removePositions(file_name);
+	removeBiwords(file_name);
+	remove(file_name);
+}
+
+// Test case: buildResults:5
+// This test case calls buildResults() on a live index (see live.c) after pages are added
+// to its crawl directory, which should find them before and after they're written out as
+// segments, and merges the segments once there are LIVE_MERGE_FACTOR of them.
+
+int buildResults5()
+{
+	START_TEST_CASE;
+
+	INVERTED_INDEX* first;
+	LIVE_INDEX* live;
+	SEARCH_INDEX* reopened;
+	SEGMENT_LIST* segments;
+	char name[100];
+
+	mkdir("live_test_data", 0755);
+	writePage("live_test_data", 1, "apple banana");
+	writePage("live_test_data", 2, "banana cherry cherry");
+
+// the index starts out with just page 1
+	first = initializeDict();
+	updateIndex("apple", 1, 1, first);
+	updateIndex("banana", 1, 1, first);
+	SHOULD_BE(writeMappedIndex(first, "live_test_index.dat") == 0);
+	cleanIndex(first);
+
+	SHOULD_BE((live = openLiveIndex("live_test_index.dat", "live_test_data", 0)) != NULL);
+
+	if(live == NULL)
+		END_TEST_CASE;
+
+	SHOULD_BE(live->high_water_mark == 1);
+	SHOULD_BE(rankOf(live->search, "cherry\n", 2) == 0);
+
+// page 2 is searched from memory, then from a segment
+	SHOULD_BE(refreshLiveIndex(live) == 1);
+	SHOULD_BE(rankOf(live->search, "cherry\n", 2) == 2);
+	SHOULD_BE(rankOf(live->search, "banana\n", 1) == 1);
+
+	SHOULD_BE(flushLiveIndex(live) == 0);
+	SHOULD_BE(live->segments->num_segments == 1);
+	SHOULD_BE(rankOf(live->search, "cherry\n", 2) == 2);
+
+// pages 3 to LIVE_MERGE_FACTOR + 1 each get a segment, and then they're all merged
+	for(int doc_id = 3; doc_id <= LIVE_MERGE_FACTOR + 1; doc_id++)
+	{
+		writePage("live_test_data", doc_id, "durian banana");
+		SHOULD_BE(refreshLiveIndex(live) == 1);
+		SHOULD_BE(flushLiveIndex(live) == 0);
+	}
+
+	SHOULD_BE(live->segments->num_segments == 1);
+	SHOULD_BE(live->search->next->next == live->memory);
+
+	for(int doc_id = 2; doc_id <= LIVE_MERGE_FACTOR + 1; doc_id++)
+		SHOULD_BE(rankOf(live->search, "banana\n", doc_id) == 1);
+
+	writePage("live_test_data", LIVE_MERGE_FACTOR + 2, "elderberry");
+	SHOULD_BE(refreshLiveIndex(live) == 1);
+	closeLiveIndex(live);
+
+// a query engine opening the index later searches the segments too
+	SHOULD_BE((reopened = openSearchIndex("live_test_index.dat")) != NULL);
+
+	if(reopened != NULL)
+	{
+		SHOULD_BE(rankOf(reopened, "cherry\n", 2) == 2);
+		SHOULD_BE(rankOf(reopened, "elderberry\n", LIVE_MERGE_FACTOR + 2) == 1);
+		SHOULD_BE(rankOf(reopened, "apple OR durian\n", 3) == 1);
+		closeSearchIndex(reopened);
+	}
+
+	SHOULD_BE((segments = readSegmentList("live_test_index.dat")) != NULL);
+
+	if(segments != NULL)
+	{
+		SHOULD_BE(segments->num_segments == 2);
+		SHOULD_BE(segments->high_water_mark == LIVE_MERGE_FACTOR + 2);
+		cleanSegmentList(segments);
+	}
+
+	removeSegments("live_test_index.dat");
+	remove("live_test_index.dat");
+
+	for(int doc_id = 1; doc_id <= LIVE_MERGE_FACTOR + 2; doc_id++)
+	{
+		sprintf(name, "live_test_data/%d", doc_id);
+		remove(name);
+	}
+
+	rmdir("live_test_data");
+
+	END_TEST_CASE;
+}
+
+// Test case: buildResults:6
+// This test case calls buildResults() for phrase queries on an index built with positions,
+// which should only match pages with the words next to each other, and on the same index
+// without them, which should match every page holding all the words.  A common word is also
+// put in a phrase with a rare one on an index of several POSITIONS_SKIP_INTERVALs of pages,
+// so its positions are skipped through (see ../util/positions.h).
+
+int buildResults6()
+{
+	START_TEST_CASE;
+
+	char* pages[] = { "new york pizza", "york new pizza", "New York, new York!", "new pizza <b>york</b>" };
+	char* many_pages[POSITIONS_SKIP_INTERVAL * 5];
+	int num_pages = POSITIONS_SKIP_INTERVAL * 5;
+	PhraseIndexes extras;
+	SEARCH_INDEX* phrases;
+
+	BZERO(&extras, sizeof(extras));
+	extras.positional = initializePositionalIndex();
+
+	SHOULD_BE((phrases = openTestIndex("phrase_test_index.dat", indexPages(pages, 4, &extras), &extras)) != NULL);
+
+	if(phrases == NULL)
+		END_TEST_CASE;
+
+	SHOULD_BE(phrases->positions != NULL);
+
+	SHOULD_BE(rankOf(phrases, "\"new york\"\n", 1) == 1);
+	SHOULD_BE(rankOf(phrases, "\"new york\"\n", 2) == 0);
+	SHOULD_BE(rankOf(phrases, "\"new york\"\n", 3) == 2);
+	SHOULD_BE(rankOf(phrases, "\"new york\"\n", 4) == 0);
+	SHOULD_BE(rankOf(phrases, "\"york new\"\n", 3) == 1);
+	SHOULD_BE(rankOf(phrases, "\"new york pizza\"\n", 1) == 1);
+	SHOULD_BE(rankOf(phrases, "\"new york pizza\"\n", 3) == 0);
+	SHOULD_BE(rankOf(phrases, "\"new york\" pizza\n", 1) == 2);
+	SHOULD_BE(rankOf(phrases, "\"new york\" OR pizza\n", 4) == 1);
+	SHOULD_BE(rankOf(phrases, "\"new thisclearlydoesntexist\"\n", 1) == 0);
+
+	closeSearchIndex(phrases);
+
+// without positions, every page holding all the words matches
+	SHOULD_BE(removePositions("phrase_test_index.dat") == 1);
+	SHOULD_BE((phrases = openSearchIndex("phrase_test_index.dat")) != NULL);
+
+	if(phrases != NULL)
+	{
+		SHOULD_BE(phrases->positions == NULL);
+		SHOULD_BE(rankOf(phrases, "\"new york\"\n", 2) == 1);
+		SHOULD_BE(rankOf(phrases, "\"new york\"\n", 3) == 2);
+	}
+
+	removeTestIndex(phrases, "phrase_test_index.dat");
+
+// york is on every page, new only on every 50th (and next to york on every 100th)
+	for(int doc_id = 1; doc_id <= num_pages; doc_id++)
+		many_pages[doc_id - 1] = (doc_id % 100 == 0) ? "new york pizza" : (doc_id % 50 == 0) ? "york new pizza" : "york pizza";
+
+	BZERO(&extras, sizeof(extras));
+	extras.positional = initializePositionalIndex();
+
+	SHOULD_BE((phrases = openTestIndex("phrase_test_index.dat", indexPages(many_pages, num_pages, &extras), &extras)) != NULL);
+
+	if(phrases == NULL)
+		END_TEST_CASE;
+
+	for(int doc_id = 1; doc_id <= num_pages; doc_id++)
+		if(doc_id % 50 == 0)
+			SHOULD_BE(rankOf(phrases, "\"new york\"\n", doc_id) == (doc_id % 100 == 0));
+
+	SHOULD_BE(rankOf(phrases, "\"york pizza\"\n", num_pages) == 1);
+	SHOULD_BE(rankOf(phrases, "\"york new\"\n", 250) == 1);
+
+	removeTestIndex(phrases, "phrase_test_index.dat");
+
+	END_TEST_CASE;
+}
+
+// Test case: buildResults:7
+// This test case calls buildResults() for phrase queries on an index built with biwords of
+// pairs in at least 2 documents (and no positions), which should answer two-word phrases in
+// them exactly and narrow down longer phrases, and should give the same results as positions.
+
+int buildResults7()
+{
+	START_TEST_CASE;
+
+	char* pages[] = { "new york pizza", "york new pizza", "New York, new York!", "new pizza <b>york</b>", "new york pizza pie" };
+	char* queries[] = { "\"new york\"\n", "\"york new\"\n", "\"new york pizza\"\n", "\"new york\" OR \"york new york\"\n" };
+	INVERTED_INDEX* built;
+	PhraseIndexes extras;
+	SEARCH_INDEX* phrases;
+	SEARCH_INDEX* exact;
+	PostingList postings;
+
+// the same pages are indexed once with biwords and once with positions
+	BZERO(&extras, sizeof(extras));
+	extras.biwords = initializeDict();
+	extras.pairs = initializeDocTerms();
+	built = indexPages(pages, 5, &extras);
+	extras.biwords = commonBiwords(extras.biwords, 2);
+	SHOULD_BE((phrases = openTestIndex("biword_test_index.dat", built, &extras)) != NULL);
+
+	BZERO(&extras, sizeof(extras));
+	extras.positional = initializePositionalIndex();
+	SHOULD_BE((exact = openTestIndex("positions_test_index.dat", indexPages(pages, 5, &extras), &extras)) != NULL);
+
+	if(phrases == NULL || exact == NULL)
+		END_TEST_CASE;
+
+	SHOULD_BE(phrases->biwords != NULL && phrases->positions == NULL);
+
+// "pizza pie" is only in one document, so it's left out
+	SHOULD_BE(findPostings(phrases, "new york", &postings) == 0);
+	SHOULD_BE(lookupMappedIndex(phrases->biwords, "new york", &postings) == 1 && postings.num_docs == 3);
+	SHOULD_BE(lookupMappedIndex(phrases->biwords, "pizza pie", &postings) == 0);
+
+	for(int q = 0; q < 4; q++)
+		for(int doc_id = 1; doc_id <= 5; doc_id++)
+			SHOULD_BE(rankOf(phrases, queries[q], doc_id) == rankOf(exact, queries[q], doc_id));
+
+// longer phrases are narrowed down to the documents holding their pairs
+	SHOULD_BE(rankOf(phrases, "\"york new pizza\"\n", 2) == 1);
+	SHOULD_BE(rankOf(phrases, "\"york new pizza\"\n", 1) == 0);
+
+	removeTestIndex(phrases, "biword_test_index.dat");
+	removeTestIndex(exact, "positions_test_index.dat");
+
 	END_TEST_CASE;
 }
 
+// Test case: buildResults:8
+// This test case calls buildResults() with a sparse and a dense ACCUMULATOR, on an index with
+// page ids in the millions, for queries matching a few of its pages and most of them, which
+// should give the same results either way (and leave nothing behind for the next query).
+
+int buildResults8()
+{
+	START_TEST_CASE;
+
+	char* input_lines[] = { "rare\n", "common rare OR rare\n", "common OR thisclearlydoesntexist\n" };
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+
+	INVERTED_INDEX* built;
+	SEARCH_INDEX* large;
+	ACCUMULATOR* accumulators[3];
+	RESULT* sorted_results[3];
+	int num_results[3];
+	int max_id;
+
+// pages 1 to 2000 hold "common", every 100th "rare" too, and so does page 3,000,000
+	built = initializeDict();
+
+	for(int doc_id = 1; doc_id <= 2000; doc_id++)
+	{
+		updateIndex("common", doc_id, 1 + doc_id % 3, built);
+
+		if(doc_id % 100 == 0)
+			updateIndex("rare", doc_id, 2, built);
+	}
+
+	updateIndex("common", 3000000, 5, built);
+	updateIndex("rare", 3000000, 1, built);
+
+	SHOULD_BE((large = openTestIndex("accumulator_test_index.dat", built, NULL)) != NULL);
+
+	if(large == NULL)
+		END_TEST_CASE;
+
+	max_id = maxDocumentId(large);
+	SHOULD_BE(max_id == 3000000);
+
+// sized for the index, sparse and dense, and (afresh for each query) sized for 1 page, so
+// it has to grow
+	accumulators[0] = initializeAccumulator(max_id + 1, ACCUMULATE_SPARSE);
+	accumulators[1] = initializeAccumulator(max_id + 1, ACCUMULATE_DENSE);
+
+	for(int q = 0; q < 3; q++)
+	{
+		accumulators[2] = initializeAccumulator(1, ACCUMULATE_SPARSE);
+
+		for(int a = 0; a < 3; a++)
+		{
+			pullQueries(input_lines[q], queries, &num_queries);
+			buildResults(large, accumulators[a], queries, num_queries);
+		}
+
+		SHOULD_BE(accumulators[0]->num_touched == accumulators[1]->num_touched);
+		SHOULD_BE(accumulators[0]->num_touched == accumulators[2]->num_touched);
+
+		for(int doc_id = 0; doc_id <= 2001; doc_id++)
+		{
+			SHOULD_BE(accumulatedRank(accumulators[0], doc_id) == accumulatedRank(accumulators[1], doc_id));
+			SHOULD_BE(accumulatedRank(accumulators[0], doc_id) == accumulatedRank(accumulators[2], doc_id));
+		}
+
+		SHOULD_BE(accumulatedRank(accumulators[0], 3000000) == accumulatedRank(accumulators[1], 3000000));
+		SHOULD_BE(accumulatedRank(accumulators[0], 3000000) == accumulatedRank(accumulators[2], 3000000));
+
+		if(q == 0)
+		{
+// a few pages stay in the hash table
+			SHOULD_BE(accumulators[0]->mode == ACCUMULATE_SPARSE);
+			SHOULD_BE(accumulatedRank(accumulators[0], 100) == 2);
+			SHOULD_BE(accumulatedRank(accumulators[0], 101) == 0);
+			SHOULD_BE(accumulatedRank(accumulators[0], 3000000) == 1);
+		}
+		else if(q == 1)
+		{
+			SHOULD_BE(accumulatedRank(accumulators[1], 100) == 4);
+			SHOULD_BE(accumulatedRank(accumulators[1], 3000000) == 6);
+		}
+		else
+		{
+// most of the pages it has seen so far, so they move into the arrays
+			SHOULD_BE(accumulators[2]->mode == ACCUMULATE_DENSE);
+			SHOULD_BE(accumulators[2]->num_touched == 2001);
+			SHOULD_BE(accumulatedRank(accumulators[2], 1) == 2);
+		}
+
+		for(int a = 0; a < 3; a++)
+		{
+			sorted_results[a] = malloc((accumulators[a]->num_touched + 1) * sizeof(RESULT));
+			num_results[a] = sortResults(accumulators[a], sorted_results[a], 0);
+
+			SHOULD_BE(accumulators[a]->num_touched == 0);
+			SHOULD_BE(accumulatedRank(accumulators[a], 100) == 0);
+			SHOULD_BE(accumulatedRank(accumulators[a], 3000000) == 0);
+		}
+
+		for(int a = 1; a < 3; a++)
+		{
+			SHOULD_BE(num_results[a] == num_results[0]);
+
+			for(int i = 0; i < num_results[0] && i < num_results[a]; i++)
+			{
+				SHOULD_BE(sorted_results[a][i].document_id == sorted_results[0][i].document_id);
+				SHOULD_BE(sorted_results[a][i].page_word_frequency == sorted_results[0][i].page_word_frequency);
+			}
+		}
+
+		for(int a = 0; a < 3; a++)
+			free(sorted_results[a]);
+
+		cleanAccumulator(accumulators[2]);
+	}
+
+	cleanAccumulator(accumulators[0]);
+	cleanAccumulator(accumulators[1]);
+
+	removeTestIndex(large, "accumulator_test_index.dat");
+
+	END_TEST_CASE;
+}
+
+// Test case: buildResults:9
+// This test case calls buildResults() for words ANDed together, a rare one and common ones,
+// which should only match the pages holding all of them (ranked by the sum of their counts),
+// as worked out page by page.
+
+int buildResults9()
+{
+	START_TEST_CASE;
+
+	char* input_lines[] = { "common rare\n", "rare even common\n", "even third\n", "common even OR rare\n",
+		"common thisclearlydoesntexist\n", "rare rare\n" };
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+
+	INVERTED_INDEX* built;
+	SEARCH_INDEX* words;
+	ACCUMULATOR* accumulator;
+	int expected;
+	int common;
+	int rare;
+	int even;
+	int third;
+	int default_level = intersectLevel();
+
+// "common" is in every page, "even" and "third" in every second and third page, "rare"
+// in every 250th (and twice in those past 5000)
+	built = initializeDict();
+
+	for(int doc_id = 1; doc_id <= 10000; doc_id++)
+	{
+		updateIndex("common", doc_id, 1 + doc_id % 5, built);
+
+		if(doc_id % 2 == 0)
+			updateIndex("even", doc_id, 2, built);
+
+		if(doc_id % 3 == 0)
+			updateIndex("third", doc_id, 3, built);
+
+		if(doc_id % 250 == 0)
+			updateIndex("rare", doc_id, (doc_id > 5000) ? 2 : 1, built);
+	}
+
+	SHOULD_BE((words = openTestIndex("and_test_index.dat", built, NULL)) != NULL);
+
+	if(words == NULL)
+		END_TEST_CASE;
+
+	accumulator = initializeAccumulator(maxDocumentId(words) + 1, ACCUMULATE_SPARSE);
+
+// (levels the processor doesn't support fall back to the best one it does)
+	for(int level = INTERSECT_SCALAR; level <= INTERSECT_AVX2; level++)
+	{
+		setIntersectLevel(level);
+
+		for(int q = 0; q < 6; q++)
+		{
+			pullQueries(input_lines[q], queries, &num_queries);
+			buildResults(words, accumulator, queries, num_queries);
+
+			for(int doc_id = 1; doc_id <= 10000; doc_id++)
+			{
+				common = 1 + doc_id % 5;
+				even = (doc_id % 2 == 0) ? 2 : 0;
+				third = (doc_id % 3 == 0) ? 3 : 0;
+				rare = (doc_id % 250 != 0) ? 0 : ((doc_id > 5000) ? 2 : 1);
+
+				if(q == 0)
+					expected = rare ? common + rare : 0;
+				else if(q == 1)
+					expected = (rare && even) ? rare + even + common : 0;
+				else if(q == 2)
+					expected = (even && third) ? even + third : 0;
+				else if(q == 3)
+					expected = (even && common + even > rare) ? common + even : rare;
+				else if(q == 4)
+					expected = 0;
+				else
+					expected = 2 * rare;
+
+				SHOULD_BE(accumulatedRank(accumulator, doc_id) == expected);
+			}
+
+			resetAccumulator(accumulator);
+		}
+	}
+
+// the later tests run at the level that was picked
+	setIntersectLevel(default_level);
+
+	cleanAccumulator(accumulator);
+	removeTestIndex(words, "and_test_index.dat");
+
+	END_TEST_CASE;
+}
+
+// Test case: buildResults:10
+// This test case calls buildResults() for up to 7 QUERYs ORed together, overlapping and not,
+// one matching nothing and one repeated, and for 4 big, scattered ones (ORed through a loser
+// tree), which should rank each page by its best QUERY (as worked out page by page).
+
+int buildResults10()
+{
+	START_TEST_CASE;
+
+	char* input_lines[] = { "two OR three\n", "five OR seven OR two three\n", "three OR thisclearlydoesntexist OR seven\n",
+		"two five OR three seven OR two OR three OR five OR seven OR two\n" };
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+
+	INVERTED_INDEX* built;
+	SEARCH_INDEX* words;
+	ACCUMULATOR* accumulator;
+	int expected;
+	int counts[8];
+	int best;
+
+// "two", "three", "five" and "seven" are in every page with that factor, counted the
+// page id over the factor (mod 7, plus 1) times
+	built = initializeDict();
+
+	for(int doc_id = 1; doc_id <= 5000; doc_id++)
+		for(int factor = 2; factor <= 7; factor++)
+			if(factor != 4 && factor != 6 && doc_id % factor == 0)
+				updateIndex((factor == 2) ? "two" : (factor == 3) ? "three" : (factor == 5) ? "five" : "seven",
+					doc_id, 1 + (doc_id / factor) % 7, built);
+
+	SHOULD_BE((words = openTestIndex("or_test_index.dat", built, NULL)) != NULL);
+
+	if(words == NULL)
+		END_TEST_CASE;
+
+	accumulator = initializeAccumulator(maxDocumentId(words) + 1, ACCUMULATE_SPARSE);
+
+	for(int q = 0; q < 4; q++)
+	{
+		pullQueries(input_lines[q], queries, &num_queries);
+		buildResults(words, accumulator, queries, num_queries);
+
+		for(int doc_id = 1; doc_id <= 5000; doc_id++)
+		{
+			for(int factor = 2; factor <= 7; factor++)
+				counts[factor] = (doc_id % factor == 0) ? 1 + (doc_id / factor) % 7 : 0;
+
+			if(q == 0)
+				expected = (counts[2] > counts[3]) ? counts[2] : counts[3];
+			else if(q == 1)
+			{
+				expected = (counts[5] > counts[7]) ? counts[5] : counts[7];
+				best = (counts[2] && counts[3]) ? counts[2] + counts[3] : 0;
+				expected = (best > expected) ? best : expected;
+			}
+			else if(q == 2)
+				expected = (counts[3] > counts[7]) ? counts[3] : counts[7];
+			else
+			{
+				expected = (counts[2] && counts[5]) ? counts[2] + counts[5] : 0;
+				best = (counts[3] && counts[7]) ? counts[3] + counts[7] : 0;
+				expected = (best > expected) ? best : expected;
+
+				for(int factor = 2; factor <= 7; factor++)
+					if(counts[factor] > expected && factor != 4 && factor != 6)
+						expected = counts[factor];
+			}
+
+			SHOULD_BE(accumulatedRank(accumulator, doc_id) == expected);
+		}
+
+		resetAccumulator(accumulator);
+	}
+
+	cleanAccumulator(accumulator);
+	removeTestIndex(words, "or_test_index.dat");
+
+// the same words over 700000 pages 41 ids apart are big and scattered enough to be ORed through
+// a loser tree (see orClauses in queryfuncs.c)
+	built = initializeDict();
+
+	for(int page = 1; page <= 700000; page++)
+		for(int factor = 2; factor <= 7; factor++)
+			if(factor != 4 && factor != 6 && page % factor == 0)
+				updateIndex((factor == 2) ? "two" : (factor == 3) ? "three" : (factor == 5) ? "five" : "seven",
+					41 * page, 1 + (page / factor) % 7, built);
+
+	SHOULD_BE((words = openTestIndex("or_tree_test_index.dat", built, NULL)) != NULL);
+
+	if(words == NULL)
+		END_TEST_CASE;
+
+	accumulator = initializeAccumulator(maxDocumentId(words) + 1, ACCUMULATE_SPARSE);
+
+	pullQueries("two OR three OR five OR seven\n", queries, &num_queries);
+	buildResults(words, accumulator, queries, num_queries);
+
+	for(int page = 1; page <= 700000; page++)
+	{
+		expected = 0;
+
+		for(int factor = 2; factor <= 7; factor++)
+			if(factor != 4 && factor != 6 && page % factor == 0 && 1 + (page / factor) % 7 > expected)
+				expected = 1 + (page / factor) % 7;
+
+		SHOULD_BE(accumulatedRank(accumulator, 41 * page) == expected);
+	}
+
+	cleanAccumulator(accumulator);
+	removeTestIndex(words, "or_tree_test_index.dat");
+
+	END_TEST_CASE;
+}
 
 // Test case: sortResults:1
 // This test case calls sortResults() in the case where results is unordered.
@@ -401,29 +1246,83 @@ int sortResults1()
 	QUERY* queries[MAX_NUM_QUERIES];
 	int num_queries;
 
-	RESULT results[MAX_NUM_FILES];
-	int temp_counts[MAX_NUM_FILES];
+	ACCUMULATOR* accumulator = initializeAccumulator(maxDocumentId(index) + 1, ACCUMULATE_SPARSE);
 
-	RESULT sorted_results[MAX_NUM_FILES];
+	RESULT* sorted_results;
 	int num_results;
 
 	int flag = 1;
 
 	char* input_line = "cat\n";
 
-	BZERO(results, MAX_NUM_FILES);
-	BZERO(temp_counts, MAX_NUM_FILES);
-
 	pullQueries(input_line, queries, &num_queries);
 
-	buildResults(index, results, temp_counts, queries, num_queries);
-	num_results = sortResults(results, temp_counts, sorted_results);
+	buildResults(index, accumulator, queries, num_queries);
+	sorted_results = malloc((accumulator->num_touched + 1) * sizeof(RESULT));
+	num_results = sortResults(accumulator, sorted_results, 0);
 
 	for(int i=0; i < num_results-1; i++)
 		if(sorted_results[i].page_word_frequency < sorted_results[i+1].page_word_frequency)
 			flag = 0;
 
 	SHOULD_BE(flag == 1);
+	SHOULD_BE(accumulator->num_touched == 0);
+
+	free(sorted_results);
+	cleanAccumulator(accumulator);
+
+	END_TEST_CASE;
+}
+
+// Test case: sortResults:2
+// This test case calls sortResults() for only the best 3 results, which should be the first 3
+// of all of them sorted, with ties in rank sorted by page id.
+
+int sortResults2()
+{
+	START_TEST_CASE;
+	
+	QUERY* queries[MAX_NUM_QUERIES];
+	int num_queries;
+
+	ACCUMULATOR* accumulator = initializeAccumulator(maxDocumentId(index) + 1, ACCUMULATE_SPARSE);
+
+	RESULT* all_results;
+	int num_all;
+
+	RESULT sorted_results[3];
+	int num_results;
+
+	int flag = 1;
+
+	char* input_line = "computer OR science\n";
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(index, accumulator, queries, num_queries);
+	all_results = malloc((accumulator->num_touched + 1) * sizeof(RESULT));
+	num_all = sortResults(accumulator, all_results, 0);
+
+	pullQueries(input_line, queries, &num_queries);
+	buildResults(index, accumulator, queries, num_queries);
+	num_results = sortResults(accumulator, sorted_results, 3);
+
+	SHOULD_BE(num_all > 3);
+	SHOULD_BE(num_results == 3);
+
+	for(int i=0; i < num_all-1; i++)
+		if(all_results[i].page_word_frequency == all_results[i+1].page_word_frequency &&
+			all_results[i].document_id > all_results[i+1].document_id)
+			flag = 0;
+
+	for(int i=0; i < num_results; i++)
+		if(sorted_results[i].document_id != all_results[i].document_id ||
+			sorted_results[i].page_word_frequency != all_results[i].page_word_frequency)
+			flag = 0;
+
+	SHOULD_BE(flag == 1);
+
+	free(all_results);
+	cleanAccumulator(accumulator);
 
 	END_TEST_CASE;
 }
@@ -432,7 +1331,7 @@ int main(int argc, char** argv)
 {
   	int cnt = 0;
 
-	index = readIndex("../crawler/data/index.dat");
+	index = openSearchIndex("../crawler/data/index.dat");
 
   	RUN_TEST(pullQueries1, "Pull Queries case 1");
   	RUN_TEST(pullQueries2, "Pull Queries case 2");
@@ -442,13 +1341,23 @@ int main(int argc, char** argv)
 	RUN_TEST(pullQueries6, "Pull Queries case 6");
 	RUN_TEST(pullQueries7, "Pull Queries case 7");
 	RUN_TEST(pullQueries8, "Pull Queries case 8");
+	RUN_TEST(pullQueries9, "Pull Queries case 9");
 
 	RUN_TEST(buildResults1, "Build Results case 1");
 	RUN_TEST(buildResults2, "Build Results case 2");
+	RUN_TEST(buildResults3, "Build Results case 3");
+	RUN_TEST(buildResults4, "Build Results case 4");
+	RUN_TEST(buildResults5, "Build Results case 5");
+	RUN_TEST(buildResults6, "Build Results case 6");
+	RUN_TEST(buildResults7, "Build Results case 7");
+	RUN_TEST(buildResults8, "Build Results case 8");
+	RUN_TEST(buildResults9, "Build Results case 9");
+	RUN_TEST(buildResults10, "Build Results case 10");
 
 	RUN_TEST(sortResults1, "Sort Results case 1");
+	RUN_TEST(sortResults2, "Sort Results case 2");
 
-	cleanIndex(index);
+	closeSearchIndex(index);
 
   	if (!cnt) 
 	{
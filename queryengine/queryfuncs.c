@@ -3,22 +3,67 @@
 
 	Contains the functional code for query.c.
 
+	SEARCH_INDEX* openSegment
+						- opens one index file (or segment) as a SEARCH_INDEX
+
+	SEARCH_INDEX* openSearchIndex
+						- maps a mapped index file (see ../util/mapindex.h),
+						  or reads any other index file into an INVERTED_INDEX
+						- reads the documents deleted from it, if there are
+						  any (see ../util/tombstones.h)
+						- maps the positions of its words and its biwords, if
+						  it has them (see ../util/positions.h and
+						  ../util/biwords.h)
+						- opens its segments after it, if it has any
+						  (see ../util/segments.h)
+
+	int findPostings	- points a PostingList at the postings of a word in
+						  either kind of SEARCH_INDEX (one segment)
+
+	PostingList* findPhrase
+						- looks a two-word phrase up in the biwords of one
+						  segment, if it's there
+						- otherwise finds the documents holding every word
+						  (and common pair) of a phrase in one segment, and
+						  then counts the times the words occur next to each
+						  other, in order, by merging their positions
+
 	int pullQueries   	- parses the string input_line into QUERYs
+					  	- keeps a phrase in double quotes together as one
+						  keyword
 					  	- places those QUERYs into the list queries
 					  	- returns the number of QUERYs parsed
 	
+	PostingList* matchQuery
+						- pulls the PostingList of each word of a QUERY from
+						  one segment of index (or the matches of each phrase)
+						- intersects them rarest word first, galloping
+						  through much longer lists and comparing blocks
+						  of pages with SIMD otherwise (see
+						  ../util/intersect.h)
+					  	- skips deleted documents
+					  	- adds each page holding every word to the
+						  ACCUMULATOR (see ../util/accumulator.h), or
+						  returns them, ranked by the sum of its counts
+
 	void buildResults 	- goes through each QUERY in query
-					  	- goes through each word associted with each QUERY
-					  	- pulls WordNode from index for each word
-					  	- goes through each DocumentNode associated
-					  	- creates a RESULT for each DocumentNode and places
-					      it at its proper index (ie page_id) in results
-						- uses temp_counts for OR conditions
-
-	int sortResults   	- uses temp_counts to figure out where RESULTs are
-						  in results
-						- sorts the RESULTs in results by rank
-						- stores the sorted RESULTs in sorted_results
+					  	- matches it in each segment of index (matchQuery)
+						- ends the QUERY in the ACCUMULATOR, which handles
+						  OR conditions
+						- with OR_TREE_CLAUSES QUERYs or more (in an index
+						  with enough pages), gathers their matches first
+						  (orClauses), and merges big, scattered ones a
+						  page at a time in a LOSER_TREE (see
+						  ../util/losertree.h)
+
+	int maxDocumentId	- finds the highest page id in a SEARCH_INDEX, which
+						  the ACCUMULATOR is sized from
+
+	int sortResults   	- goes through the pages the ACCUMULATOR touched
+						- keeps the best k of them in a heap (or all of them
+						  if k is 0), ties going to the lower page id
+						- stores them sorted by rank in sorted_results
+						- empties the ACCUMULATOR for the next query
 						- returns the number of results sorted
 	
 	int printResults	- goes through sorted_results, pulls the page for
@@ -26,19 +71,16 @@
 
 	Important Variables Explained:
 	
-	RESULT results[MAX_NUM_FILES]
-		- each index corresponds to the page whose name bears that index value
+	ACCUMULATOR* accumulator
+		- holds the rank of each page a query has matched so far, its rank
+		  in the current QUERY, and a list of the pages it has touched, so
+		  nothing is ever done for a page the query didn't match (a hash
+		  table for a few pages, arrays indexed by page id for many)
 
-	int temp_counts[MAX_NUM_FILES]
-		- each index corresponds to a page whose name bears that index value
-		- once an index contains a RESULT in results (ie a page has come up once
-		  for any of the keywords in a query), temp_counts keeps track of its
-		  rank for the purpose of ORing (replaces the rank in the corresponding
-		  RESULT at the end if it's higher)
-
-	RESULT sorted_results[MAX_NUM_FILES]
+	RESULT* sorted_results
 		- completely filled with results up to the return vaue of sortResults
-		- sorted greatest to least by rank (page_word_frequency)
+		- sorted greatest to least by rank (page_word_frequency), then least
+		  to greatest by page id
 */
 
 #include <stdio.h>
@@ -56,11 +98,367 @@
 #include "../util/html.h"
 #include "../util/file.h"
 #include "../util/hash.h"
+#include "../util/postings.h"
 #include "../util/dictionary.h"
+#include "../util/mapindex.h"
+#include "../util/tombstones.h"
+#include "../util/segments.h"
+#include "../util/positions.h"
+#include "../util/biwords.h"
+#include "../util/topk.h"
+#include "../util/accumulator.h"
+#include "../util/intersect.h"
+#include "../util/losertree.h"
+
+// takes the name of an index file (or segment) and opens it as one segment
+// a mapped index file is searched in place, so opening it doesn't read it;
+// any other index file is read into an INVERTED_INDEX
+// returns NULL if the file can't be opened
+SEARCH_INDEX* openSegment(char* file_name, int segment)
+{
+	SEARCH_INDEX* index;
+
+	index = malloc(sizeof(SEARCH_INDEX));
+	MALLOC_CHECK(index);
+	BZERO(index, sizeof(SEARCH_INDEX));
+
+	if(isMappedIndex(file_name))
+		index->mapped = openMappedIndex(file_name);
+	else
+		index->index = readIndex(file_name);
+
+	if(index->mapped == NULL && index->index == NULL)
+	{
+		free(index);
+		return NULL;
+	}
+
+	index->segment = segment;
+	index->positions = openPositions(file_name);
+	index->biwords = openBiwords(file_name);
+
+	return index;
+}
+
+// takes the name of an index file and opens it for searching, along with
+// its segments (see ../util/segments.h) and the documents deleted from it
+// returns NULL if the file or any of its segments can't be opened
+SEARCH_INDEX* openSearchIndex(char* file_name)
+{
+	SEARCH_INDEX* index;
+	SEARCH_INDEX* last;
+	SEGMENT_LIST* segments;
+	char* name;
+
+	if((index = openSegment(file_name, 0)) == NULL)
+		return NULL;
+
+	index->deleted = readTombstones(file_name);
+
+	if((segments = readSegmentList(file_name)) == NULL)
+		return index;
+
+	last = index;
+
+	for(int i = 0; i < segments->num_segments && last != NULL; i++)
+	{
+		name = segmentName(file_name, segments->numbers[i]);
+		last->next = openSegment(name, segments->numbers[i]);
+		last = last->next;
+		free(name);
+	}
+
+	cleanSegmentList(segments);
+
+	if(last == NULL)
+	{
+		closeSearchIndex(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+// takes a SEARCH_INDEX* index and returns the highest document id in any of
+// its segments (-1 if they're all empty), which sizes its ACCUMULATOR
+int maxDocumentId(SEARCH_INDEX* index)
+{
+	int max_document = -1;
+	int segment_max;
+
+	for(; index != NULL; index = index->next)
+	{
+		if(index->mapped != NULL)
+			segment_max = maxMappedDocument(index->mapped);
+		else
+			segment_max = maxIndexDocument(index->index);
+
+		if(segment_max > max_document)
+			max_document = segment_max;
+	}
+
+	return max_document;
+}
+
+// takes a SEARCH_INDEX* index, a word and a PostingList* postings
+// if word is in the index, points postings at its postings (which mustn't be
+// changed) and returns 1, otherwise returns 0
+int findPostings(SEARCH_INDEX* index, char* word, PostingList* postings)
+{
+	DNODE* wordnode;
+
+	if(index->mapped != NULL)
+		return lookupMappedIndex(index->mapped, word, postings);
+
+	if((wordnode = getData(index->index, word)) == NULL)
+		return 0;
+
+	*postings = *(PostingList*)wordnode->data;
+
+	return 1;
+}
+
+// takes a SEARCH_INDEX* index (one segment) and a phrase (lower case words separated by
+// single spaces), and returns a new PostingList of the documents the phrase occurs in, with
+// the number of times it occurs in each, or NULL if it doesn't occur in any
+// a two-word phrase in the biwords (see ../util/biwords.h) is answered by its postings;
+// otherwise the documents holding every word (and every pair of words in the biwords) come
+// from the postings, rarest list first, and only their positions are read
+// a segment without positions (see ../util/positions.h) can't tell where the words are, so
+// each document holding all of them counts as holding the phrase as often as its rarest
+// word (or pair)
+PostingList* findPhrase(SEARCH_INDEX* index, char* phrase)
+{
+	char* words;
+	char** word_list;
+	char* pair;
+	int num_words = 1;
+	int num_lists;
+	PostingList* lists;
+	int* next;
+	PositionCursor* cursors;
+	int** positions;
+	int* num_positions;
+	int* capacities;
+	int* matched;
+	PostingList* matches;
+	int rarest = 0;
+	int w;
+	int document_id;
+	int rank;
+	int found = 1;
+
+	for(char* c = phrase; *c != '\0'; c++)
+		if(*c == ' ')
+			num_words++;
+
+	words = malloc(strlen(phrase) + 1);
+	MALLOC_CHECK(words);
+	strcpy(words, phrase);
+	pair = malloc(strlen(phrase) + 1);
+	MALLOC_CHECK(pair);
+
+// the postings of each word, and then of each pair of them in the biwords
+	word_list = malloc(num_words * sizeof(char*));
+	MALLOC_CHECK(word_list);
+	lists = malloc((2 * num_words - 1) * sizeof(PostingList));
+	MALLOC_CHECK(lists);
+	next = calloc(2 * num_words - 1, sizeof(int));
+	MALLOC_CHECK(next);
+	cursors = malloc(num_words * sizeof(PositionCursor));
+	MALLOC_CHECK(cursors);
+	positions = calloc(num_words, sizeof(int*));
+	MALLOC_CHECK(positions);
+	num_positions = calloc(num_words, sizeof(int));
+	MALLOC_CHECK(num_positions);
+	capacities = calloc(num_words, sizeof(int));
+	MALLOC_CHECK(capacities);
+	matched = calloc(num_words, sizeof(int));
+	MALLOC_CHECK(matched);
+
+// every word has to be in the index (and in the positions, if there are any)
+	for(w = 0; w < num_words && found; w++)
+	{
+		word_list[w] = (w == 0) ? strtok(words, " ") : strtok(NULL, " ");
+
+		found = (word_list[w] != NULL && findPostings(index, word_list[w], &lists[w]));
+
+		if(found && index->positions != NULL)
+			found = lookupPositions(index->positions, word_list[w], &cursors[w]);
+
+		if(found && lists[w].num_docs < lists[rarest].num_docs)
+			rarest = w;
+	}
+
+	num_lists = num_words;
+
+// a common pair only occurs in some of the documents holding both its words
+	for(w = 0; found && index->biwords != NULL && w < num_words - 1; w++)
+	{
+		sprintf(pair, "%s %s", word_list[w], word_list[w + 1]);
+
+		if(!lookupMappedIndex(index->biwords, pair, &lists[num_lists]))
+			continue;
+
+		if(lists[num_lists].num_docs < lists[rarest].num_docs)
+			rarest = num_lists;
+
+		num_lists++;
+	}
+
+// a two-word phrase's pair counts its occurences already
+	if(found && num_words == 2 && num_lists == 3)
+	{
+		matches = initializePostings(lists[2].num_docs > 0 ? lists[2].num_docs : 1);
+		memcpy(matches->doc_ids, lists[2].doc_ids, lists[2].num_docs * sizeof(int));
+		memcpy(matches->frequencies, lists[2].frequencies, lists[2].num_docs * sizeof(int));
+		matches->num_docs = lists[2].num_docs;
+
+// so nothing else is looked up
+		found = 0;
+	}
+	else
+		matches = NULL;
+
+	if(found)
+		matches = initializePostings(INITIAL_POSTINGS_CAPACITY);
+
+// each document of the rarest list is looked for in the others' postings, which are
+// sorted, so each one only gallops forward
+	for(int d = 0; found && d < lists[rarest].num_docs; d++)
+	{
+		document_id = lists[rarest].doc_ids[d];
+		rank = lists[rarest].frequencies[d];
+
+		for(w = 0; w < num_lists && rank > 0; w++)
+		{
+			next[w] = seekPosting(&lists[w], next[w], document_id);
+
+			if(next[w] == lists[w].num_docs || lists[w].doc_ids[next[w]] != document_id)
+				rank = 0;
+			else if(lists[w].frequencies[next[w]] < rank)
+				rank = lists[w].frequencies[next[w]];
+		}
+
+		if(rank == 0 || index->positions == NULL)
+		{
+			if(rank > 0)
+				appendPosting(matches, document_id, rank);
+
+			continue;
+		}
+
+// the positions of every word in the document
+		for(w = 0; w < num_words; w++)
+		{
+			if(!seekPositions(&cursors[w], document_id))
+				break;
+
+			if(cursors[w].num_positions > capacities[w])
+			{
+				capacities[w] = cursors[w].num_positions;
+				positions[w] = realloc(positions[w], capacities[w] * sizeof(int));
+				MALLOC_CHECK(positions[w]);
+			}
+
+			num_positions[w] = readPositions(&cursors[w], positions[w]);
+			matched[w] = 0;
+		}
+
+		if(w < num_words)
+			continue;
+
+// the phrase starts at each position p of its first word where word w is at p + w
+// (every list is sorted, so they're merged, each one only moving forward)
+		rank = 0;
+
+		for(int i = 0; i < num_positions[0]; i++)
+		{
+			for(w = 1; w < num_words; w++)
+			{
+				while(matched[w] < num_positions[w] && positions[w][matched[w]] < positions[0][i] + w)
+					matched[w]++;
+
+				if(matched[w] == num_positions[w] || positions[w][matched[w]] != positions[0][i] + w)
+					break;
+			}
+
+			if(w == num_words)
+				rank++;
+		}
+
+		if(rank > 0)
+			appendPosting(matches, document_id, rank);
+	}
+
+	for(int w = 0; w < num_words; w++)
+		free(positions[w]);
+
+	free(words);
+	free(pair);
+	free(word_list);
+	free(lists);
+	free(next);
+	free(cursors);
+	free(positions);
+	free(num_positions);
+	free(capacities);
+	free(matched);
+
+	if(matches != NULL && matches->num_docs == 0)
+	{
+		cleanPostings(matches);
+		matches = NULL;
+	}
+
+	return matches;
+}
+
+// frees one segment of a SEARCH_INDEX and whatever it holds
+void closeSegment(SEARCH_INDEX* index)
+{
+	if(index->mapped != NULL)
+		closeMappedIndex(index->mapped);
+	else
+		cleanIndex(index->index);
+
+	if(index->deleted != NULL)
+		cleanTombstones(index->deleted);
+
+	closePositions(index->positions);
+	closeMappedIndex(index->biwords);
+
+	free(index);
+}
+
+// frees a SEARCH_INDEX and all of its segments
+void closeSearchIndex(SEARCH_INDEX* index)
+{
+	SEARCH_INDEX* next;
+
+	for(; index != NULL; index = next)
+	{
+		next = index->next;
+		closeSegment(index);
+	}
+}
+
+// takes a keyword (a word or a phrase) and returns a malloced copy of it
+static char* copyKeyword(char* keyword)
+{
+	char* copy = malloc(strlen(keyword) + 1);
+
+	MALLOC_CHECK(copy);
+	strcpy(copy, keyword);
+
+	return copy;
+}
 
 // takes a char* input_line, a QUERY** queries, and a pointer to an int num_queries
 // parses input_line for QUERYs, placing them into queries, and incrementing 
 // num_queries as it does so
+// words in double quotes are kept together as one keyword, a phrase (with the
+// words separated by single spaces), and a quote left open ends at the end of the line
 // returns -1 if input_line is bad (empty, ends in "OR")
 // returns 1 if input_line == "q" (quit command)
 // returns 0 if successful
@@ -71,13 +469,23 @@ int pullQueries(char* input_line, QUERY** queries, int* num_queries)
 	int current_index;
 	QUERY* query;
 	int position;
+	int previous;
+	char *phrase;
+	int in_phrase;
 
 	word = malloc(MAX_KEYWORD_LENGTH*sizeof(char)); 
 	BZERO(word, MAX_KEYWORD_LENGTH*sizeof(char));
+
+// the words of a phrase in double quotes are gathered here (it can't be longer than the line)
+	phrase = malloc(strlen(input_line) + 1);
+	MALLOC_CHECK(phrase);
+	phrase[0] = '\0';
+	in_phrase = 0;
 	
 	*num_queries = 0;
 	current_index = 0;		// corresponds to index of current_keywords
 	position = 0;			// matches index in input_line
+	previous = 0;			// where the last word ended
 
 // getNextWord parses the input_line for a word, storing it into word
 // works just like getNextURL
@@ -85,10 +493,40 @@ int pullQueries(char* input_line, QUERY** queries, int* num_queries)
 	{	
 		word[strlen(word)] = '\0';		
 
+// each double quote between the last word and this one opens or closes a phrase,
+// and a closed phrase becomes a keyword
+		for(int c = previous; c < position - (int)strlen(word); c++)
+		{
+			if(input_line[c] != '"')
+				continue;
+
+			if(in_phrase && phrase[0] != '\0')
+				current_keywords[current_index++] = copyKeyword(phrase);
+
+			in_phrase = !in_phrase;
+			phrase[0] = '\0';
+		}
+
+		previous = position;
+
+// inside a phrase, every word (even "OR") is part of it
+		if(in_phrase)
+		{
+			NormalizeWord(word);
+
+			if(phrase[0] != '\0')
+				strcat(phrase, " ");
+
+			strcat(phrase, word);
+			BZERO(word, MAX_KEYWORD_LENGTH*sizeof(char));
+			continue;
+		}
+
 // if quit command
 		if(current_index == 0 && strcmp(word, "q") == 0)
 		{
 			free(word);			
+			free(phrase);
 			return 1;
 		}
 
@@ -100,13 +538,9 @@ int pullQueries(char* input_line, QUERY** queries, int* num_queries)
 
 // for each keyword in current_keywords, put it into the search_words
 // parameter of query
+// (a phrase can be longer than MAX_KEYWORD_LENGTH, so the keywords are handed over as they are)
 			for(int i = 0; i < current_index; i++)
-			{
-				query->search_words[i] = malloc(MAX_KEYWORD_LENGTH*sizeof(char));	 	
-				BZERO((query->search_words)[i], MAX_KEYWORD_LENGTH*sizeof(char));
-				strncpy((query->search_words)[i], current_keywords[i], MAX_KEYWORD_LENGTH*sizeof(char));
-				free(current_keywords[i]);
-			}
+				query->search_words[i] = current_keywords[i];
 
 // include a null-terminator just in case
 			query->search_words[current_index] = NULL;
@@ -138,6 +572,12 @@ int pullQueries(char* input_line, QUERY** queries, int* num_queries)
 
 	free(word); 
 
+// a phrase that's still open at the end of the line ends there
+	if(in_phrase && phrase[0] != '\0')
+		current_keywords[current_index++] = copyKeyword(phrase);
+
+	free(phrase);
+
 // if current_index = 0, that means the last word in input_line was "OR"
 // and therefore the input is bad
 	if(current_index == 0)
@@ -163,12 +603,7 @@ int pullQueries(char* input_line, QUERY** queries, int* num_queries)
 	MALLOC_CHECK(query);
 
 	for(int i = 0; i < current_index; i++)
-	{
-		query->search_words[i] = malloc(MAX_KEYWORD_LENGTH*sizeof(char));				
-		BZERO((query->search_words)[i], MAX_KEYWORD_LENGTH);
-		strncpy((query->search_words)[i], current_keywords[i], MAX_KEYWORD_LENGTH);
-		free(current_keywords[i]);
-	}
+		query->search_words[i] = current_keywords[i];
 
 	query->search_words[current_index] = NULL;
 
@@ -177,135 +612,268 @@ int pullQueries(char* input_line, QUERY** queries, int* num_queries)
 	return 0;	
 }
 
-// takes a INVERTED_INDEX* index, a list of results RESULT* results, a list of 
-// ints int* temp_counts, a list of QUERYs QUERY** queries, and an int
-// num_queries corresponding to that list
-void buildResults(INVERTED_INDEX* index, RESULT* results, int* temp_counts, QUERY** queries, int num_queries)
+// takes one segment of a SEARCH_INDEX, the documents deleted from the index,
+// the keywords of a QUERY and an ACCUMULATOR* accumulator, and adds each page
+// of the segment holding every keyword to accumulator, ranked by the sum of
+// their counts
+// if accumulator is NULL, the pages are returned as a PostingList instead (NULL
+// if a keyword isn't in the segment)
+// the shortest list is intersected with each longer one in turn (see
+// ../util/intersect.h, which gallops through a much longer list and compares
+// blocks of pages of lists about as long), so a common word costs about as
+// much as the rarest
+static PostingList* matchQuery(SEARCH_INDEX* segment, TOMBSTONES* deleted, char** keywords, int num_keywords, ACCUMULATOR* accumulator)
 {
-	QUERY* current_query;
-
-	char* current_keyword;	// corresponds to a word in search_words in each QUERY
-	int keyword_index;		// corresponds to index of search_words in each QUERY
+	PostingList lists[MAX_NUM_KEYWORDS];
+	PostingList* phrase_postings[MAX_NUM_KEYWORDS];
+	PostingList shorter;
+	PostingList* matches = NULL;
+	int* in_matches;
+	int* in_list;
+	int num_matches;
+	int found = 1;
+	int m;
+	int p;
+	int w;
+
+// each keyword's PostingList (a phrase's matches are worked out into one of their own, see findPhrase)
+	for(w = 0; w < num_keywords; w++)
+	{
+		phrase_postings[w] = NULL;
 
-	DNODE* wordnode;
-	DocumentNode* docnode;
-	RESULT result;
+		if(!found)
+			continue;
 
-	int page_id;
-	int rank;
+		if(strchr(keywords[w], ' ') != NULL)
+		{
+			if((phrase_postings[w] = findPhrase(segment, keywords[w])) != NULL)
+				lists[w] = *phrase_postings[w];
+			else
+				found = 0;
+		}
+		else
+			found = findPostings(segment, keywords[w], &lists[w]);
+	}
 
-// for each query
-	for(int i = 0; i < num_queries; i++)
+// shortest list first (there are only a few)
+	for(w = 1; found && w < num_keywords; w++)
 	{
-		current_query = queries[i];
+		shorter = lists[w];
+
+		for(p = w; p > 0 && lists[p - 1].num_docs > shorter.num_docs; p--)
+			lists[p] = lists[p - 1];
 
-		keyword_index = 0;
+		lists[p] = shorter;
+	}
 
-// for each keyword contained in the query (search_words)
-		while((current_keyword = (current_query->search_words)[keyword_index++]) != NULL)
+// a single word's postings are all added at once
+	if(found && num_keywords == 1 && deleted == NULL && accumulator != NULL)
+		addPostings(accumulator, &lists[0]);
+	else if(found)
+	{
+// the matches start out as the shortest list
+		matches = initializePostings(lists[0].num_docs > 0 ? lists[0].num_docs : 1);
+		memcpy(matches->doc_ids, lists[0].doc_ids, lists[0].num_docs * sizeof(int));
+		memcpy(matches->frequencies, lists[0].frequencies, lists[0].num_docs * sizeof(int));
+		matches->num_docs = lists[0].num_docs;
+
+		in_matches = malloc(matches->capacity * sizeof(int));
+		in_list = malloc(matches->capacity * sizeof(int));
+		MALLOC_CHECK(in_matches);
+		MALLOC_CHECK(in_list);
+
+// and each longer list narrows them down, adding its counts to the pages left
+// (in_matches[m] is never below m, so they're narrowed down in place)
+		for(w = 1; w < num_keywords && matches->num_docs > 0; w++)
 		{
+			num_matches = intersectSorted(matches->doc_ids, matches->num_docs, lists[w].doc_ids, lists[w].num_docs, in_matches, in_list);
 
-// if the word has a corresponding WordNode in the index
-			if((wordnode = getData(index, current_keyword)) != NULL)
+			for(m = 0; m < num_matches; m++)
 			{
-				docnode = wordnode->data;
+				matches->doc_ids[m] = matches->doc_ids[in_matches[m]];
+				matches->frequencies[m] = matches->frequencies[in_matches[m]] + lists[w].frequencies[in_list[m]];
+			}
+
+			matches->num_docs = num_matches;
+		}
+
+// deleted documents are left out (their postings stay until the index is compacted)
+		if(deleted != NULL)
+		{
+			num_matches = 0;
 
-// for each DocumentNode associated with that WordNode
-				while(docnode != NULL)
+			for(m = 0; m < matches->num_docs; m++)
+			{
+				if(!isTombstoned(deleted, matches->doc_ids[m]))
 				{
-					page_id = docnode->document_id;
-					rank = docnode->page_word_frequency;
-
-// if this doc is new (ie we haven't come across it yet)
-					if(!temp_counts[page_id])
-					{
-// creates a RESULT for the document						
-						result.document_id = page_id;
-						result.page_word_frequency = rank;
-
-// places this RESULT into the list of RESULTs result
-						results[page_id] = result;
-
-// includes its rank at its page_id index in temp_counts
-						temp_counts[page_id] = rank;
-					}
-// if we have come across this doc already
-					else
-					{
-// if its index in temp_counts == -1 (explained in the next for loop)
-						if(temp_counts[page_id] == -1)
-							temp_counts[page_id] += rank+1;
-						else
-							temp_counts[page_id] += rank;
-					}
-	
-					docnode = docnode->next;
+					matches->doc_ids[num_matches] = matches->doc_ids[m];
+					matches->frequencies[num_matches++] = matches->frequencies[m];
 				}
-			}	
+			}
 
-			free(current_keyword);
+			matches->num_docs = num_matches;
 		}
 
-// for each page index
-		for(int page_index = 0; page_index < MAX_NUM_FILES; page_index++)
+// the matches are added all at once
+		if(accumulator != NULL)
 		{
-// if there's a count for it
-			if(temp_counts[page_index])	// handles OR
-			{	
-// if the count is greater than what's currently there
-				if(temp_counts[page_index] > (results[page_index].page_word_frequency))
-					results[page_index].page_word_frequency = temp_counts[page_index];
-
-// set to -1 so we know the page has been visited on later iterations (0 = NULL so that doesn't work)
-				temp_counts[page_index] = -1;
-			}
+			addPostings(accumulator, matches);
+			cleanPostings(matches);
+			matches = NULL;
 		}
 
-		free(queries[i]);	
-	}	
+		free(in_matches);
+		free(in_list);
+	}
+
+	for(w = 0; w < num_keywords; w++)
+		if(phrase_postings[w] != NULL)
+			cleanPostings(phrase_postings[w]);
+
+	return matches;
 }
 
-// takes a list of RESULT results, a list of ints temp_counts, and
-// an empty list of RESULT called sorted_results
-// returns the number of results placed into sorted_results
-int sortResults(RESULT* results, int* temp_counts, RESULT* sorted_results)
+// takes an ACCUMULATOR* accumulator and the matches of num_clauses QUERYs,
+// and ORs them into it, each page keeping its rank in whichever QUERY it ranks
+// highest
+// big, scattered matches go through a LOSER_TREE (see ../util/losertree.h) a
+// page at a time, so each page is added once; any others are added a QUERY at
+// a time, which is faster for them (see ../bench/union_bench.c)
+static void orClauses(ACCUMULATOR* accumulator, PostingList** clauses, int num_clauses)
 {
-	RESULT temp;
-	int s;
-	int num_results = 0;
+	LOSER_TREE* tree;
+	long num_matches = 0;
+	int page_id;
+	int rank;
+
+	for(int c = 0; c < num_clauses; c++)
+		num_matches += clauses[c]->num_docs;
 
-// for each page in page_index
-	for(int page_index = 0; page_index < MAX_NUM_FILES; page_index++)
+	if(useOrTree(num_clauses, num_matches, accumulator->max_documents))
 	{
-// if the page has been visited
-		if(temp_counts[page_index])	// handles OR
-		{
-// set it to 0 for later queries (ie unvisited)	
-			temp_counts[page_index] = 0;		
-// store it in the smallest available index in sorted_results
-			sorted_results[num_results] = results[page_index];
-			num_results += 1;		
-		}
+		tree = initializeLoserTree(clauses, num_clauses);
+
+		while(nextDocument(tree, &page_id, &rank))
+			addRank(accumulator, page_id, rank);
+
+		cleanLoserTree(tree);
+		endClause(accumulator);
+
+		return;
 	}
 
-	s = 1;				// to break out of bubble sort
+	for(int c = 0; c < num_clauses; c++)
+	{
+		addPostings(accumulator, clauses[c]);
+		endClause(accumulator);
+	}
+}
+
+// takes a SEARCH_INDEX* index, an ACCUMULATOR* accumulator (see
+// ../util/accumulator.h), a list of QUERYs QUERY** queries, and an int
+// num_queries corresponding to that list
+// each QUERY's matches are added straight to accumulator, unless there are
+// enough QUERYs, and pages, for them to be big and scattered enough to OR
+// through a LOSER_TREE: then they're gathered first (see orClauses)
+void buildResults(SEARCH_INDEX* index, ACCUMULATOR* accumulator, QUERY** queries, int num_queries)
+{
+	QUERY* current_query;
+	int num_keywords;		// the number of search_words in each QUERY
+
+	SEARCH_INDEX* segment;
+	PostingList* clauses[MAX_NUM_QUERIES];
+	int num_clauses = 0;
+// (gathered only if the fewest matches the tree takes could be scattered enough for it)
+	int gather = useOrTree(num_queries, (long)OR_TREE_MATCHES, accumulator->max_documents);
+	PostingList* clause;
+	PostingList* segment_matches;
+	PostingList* merged;
 
-// bubble sorts the results by rank
-	for(int i = 0; i < num_results && s != 0; i++)
+// for each query
+	for(int i = 0; i < num_queries; i++)
 	{
-		s = 0;		
-		
-		for(int j = 0; j < num_results-1; j++)
+		current_query = queries[i];
+		clause = NULL;
+
+		for(num_keywords = 0; current_query->search_words[num_keywords] != NULL; num_keywords++)
+			;
+
+// the pages holding every keyword in each segment of the index (each document is in
+// one segment, so they're found the same way as if there were just one, and merging
+// gathered ones gives the same pages)
+		for(segment = index; num_keywords > 0 && segment != NULL; segment = segment->next)
 		{
-			if(sorted_results[j].page_word_frequency < sorted_results[j+1].page_word_frequency)
+			if(!gather)
 			{
-				temp = sorted_results[j];
-				sorted_results[j] = sorted_results[j+1];
-				sorted_results[j+1] = temp;
-				s++;
+				matchQuery(segment, index->deleted, current_query->search_words, num_keywords, accumulator);
+				continue;
+			}
+
+			if((segment_matches = matchQuery(segment, index->deleted, current_query->search_words, num_keywords, NULL)) == NULL)
+				continue;
+
+			if(clause == NULL)
+				clause = segment_matches;
+			else
+			{
+				merged = mergePostings(clause, segment_matches);
+				cleanPostings(clause);
+				cleanPostings(segment_matches);
+				clause = merged;
 			}
 		}
+
+		if(clause != NULL && clause->num_docs > 0)
+			clauses[num_clauses++] = clause;
+		else if(clause != NULL)
+			cleanPostings(clause);
+
+		for(int keyword_index = 0; keyword_index < num_keywords; keyword_index++)
+			free(current_query->search_words[keyword_index]);
+
+// handles OR: each page keeps its rank in whichever query it ranks highest
+		if(!gather)
+			endClause(accumulator);
+
+		free(queries[i]);	
+	}
+
+	if(gather)
+		orClauses(accumulator, clauses, num_clauses);
+
+	for(int c = 0; c < num_clauses; c++)
+		cleanPostings(clauses[c]);
+}
+
+// takes an ACCUMULATOR* accumulator filled in by buildResults, an empty
+// list of RESULT called sorted_results (with room for k RESULTs, or for
+// accumulator->num_touched if k is 0) and the number of results wanted k
+// (0 for all of them)
+// returns the number of results placed into sorted_results, and empties
+// accumulator for the next query
+int sortResults(ACCUMULATOR* accumulator, RESULT* sorted_results, int k)
+{
+	TOP_K* top = NULL;
+	int num_results;
+
+// only the best k are kept as they're found (see ../util/topk.h)
+	if(k > 0)
+		top = initializeTopK(k);
+
+// offers each page the query matched to the best k, or stores them all in sorted_results
+	num_results = collectAccumulated(accumulator, top, sorted_results);
+
+// clears it for later queries (only the pages it touched)
+	resetAccumulator(accumulator);
+
+// sorts them by rank (ties by page id)
+	if(top != NULL)
+	{
+		num_results = finishTopK(top, sorted_results);
+		cleanTopK(top);
 	}
+	else
+		sortDocuments(sorted_results, num_results);
 
 	return num_results;
 }
@@ -4,10 +4,24 @@
 	Functions fully defined and explained in queryfuncs.c
 */
 
+SEARCH_INDEX* openSegment(char* file_name, int segment);
+
+SEARCH_INDEX* openSearchIndex(char* file_name);
+
+int findPostings(SEARCH_INDEX* index, char* word, PostingList* postings);
+
+void closeSegment(SEARCH_INDEX* index);
+
+void closeSearchIndex(SEARCH_INDEX* index);
+
+PostingList* findPhrase(SEARCH_INDEX* index, char* phrase);
+
 int pullQueries(char* input_line, QUERY** queries, int* num_queries);
 
-void buildResults(INVERTED_INDEX* index, RESULT* results, int* temp_counts, QUERY** queries, int num_queries);
+int maxDocumentId(SEARCH_INDEX* index);
+
+void buildResults(SEARCH_INDEX* index, ACCUMULATOR* accumulator, QUERY** queries, int num_queries);
 
-int sortResults(RESULT* results, int* temp_counts, RESULT* sorted_results);
+int sortResults(ACCUMULATOR* accumulator, RESULT* sorted_results, int k);
 
 void printResults(RESULT* sorted_results, int num_results);
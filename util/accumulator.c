@@ -0,0 +1,396 @@
+// Contains the ACCUMULATOR functions, which add up the ranks of the documents
+// a query matches (see accumulator.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "header.h"
+#include "postings.h"
+#include "dictionary.h"
+#include "topk.h"
+#include "accumulator.h"
+
+// Returns an empty ACCUMULATOR.
+ACCUMULATOR* initializeAccumulator(int max_documents, int mode)
+{
+	ACCUMULATOR* accumulator = malloc(sizeof(ACCUMULATOR));
+
+	MALLOC_CHECK(accumulator);
+	BZERO(accumulator, sizeof(ACCUMULATOR));
+
+	accumulator->mode = mode;
+	accumulator->start_mode = mode;
+	accumulator->max_documents = (max_documents > 0) ? max_documents : 1;
+
+	if(mode == ACCUMULATE_DENSE)
+	{
+		accumulator->ranks = calloc(accumulator->max_documents, sizeof(int));
+		accumulator->clause_ranks = calloc(accumulator->max_documents, sizeof(int));
+		MALLOC_CHECK(accumulator->ranks);
+		MALLOC_CHECK(accumulator->clause_ranks);
+	}
+	else
+	{
+		accumulator->num_slots = INITIAL_ACCUMULATOR_SLOTS;
+		accumulator->slots = malloc(accumulator->num_slots * sizeof(AccumulatorSlot));
+		MALLOC_CHECK(accumulator->slots);
+
+		for(int s = 0; s < accumulator->num_slots; s++)
+			accumulator->slots[s].document_id = -1;
+	}
+
+	accumulator->touched_capacity = INITIAL_ACCUMULATOR_SLOTS;
+	accumulator->touched = malloc(accumulator->touched_capacity * sizeof(int));
+	accumulator->clause_touched = malloc(accumulator->touched_capacity * sizeof(int));
+	MALLOC_CHECK(accumulator->touched);
+	MALLOC_CHECK(accumulator->clause_touched);
+
+	return accumulator;
+}
+
+// Makes room for document ids up to document_id, growing the dense arrays (if there are any)
+// and zeroing their new part.
+static void growDocuments(ACCUMULATOR* accumulator, int document_id)
+{
+	int old_size = accumulator->max_documents;
+	int new_size = 2 * old_size;
+
+	if(new_size <= document_id)
+		new_size = document_id + 1;
+
+	accumulator->max_documents = new_size;
+
+	if(accumulator->ranks == NULL)
+		return;
+
+	accumulator->ranks = realloc(accumulator->ranks, new_size * sizeof(int));
+	accumulator->clause_ranks = realloc(accumulator->clause_ranks, new_size * sizeof(int));
+	MALLOC_CHECK(accumulator->ranks);
+	MALLOC_CHECK(accumulator->clause_ranks);
+
+	BZERO(accumulator->ranks + old_size, (new_size - old_size) * sizeof(int));
+	BZERO(accumulator->clause_ranks + old_size, (new_size - old_size) * sizeof(int));
+}
+
+// Makes room in touched (and clause_touched) for num_entries more entries.
+static void reserveTouched(ACCUMULATOR* accumulator, int num_entries)
+{
+	if(accumulator->num_touched + num_entries <= accumulator->touched_capacity)
+		return;
+
+	while(accumulator->num_touched + num_entries > accumulator->touched_capacity)
+		accumulator->touched_capacity *= 2;
+
+	accumulator->touched = realloc(accumulator->touched, accumulator->touched_capacity * sizeof(int));
+	accumulator->clause_touched = realloc(accumulator->clause_touched, accumulator->touched_capacity * sizeof(int));
+	MALLOC_CHECK(accumulator->touched);
+	MALLOC_CHECK(accumulator->clause_touched);
+}
+
+// Adds entry (a document id or a slot) to touched, and to clause_touched too if clause is 1.
+static void addTouched(ACCUMULATOR* accumulator, int entry, int clause)
+{
+	reserveTouched(accumulator, 1);
+
+	if(clause)
+		accumulator->clause_touched[accumulator->num_clause_touched++] = entry;
+	else
+		accumulator->touched[accumulator->num_touched++] = entry;
+}
+
+// Returns the slot holding document_id, or the empty slot where it would go.
+static int findSlot(ACCUMULATOR* accumulator, int document_id)
+{
+	int mask = accumulator->num_slots - 1;
+	int s = (int)(((unsigned int)document_id * 2654435761u) & mask);
+
+	while(accumulator->slots[s].document_id != -1 && accumulator->slots[s].document_id != document_id)
+		s = (s + 1) & mask;
+
+	return s;
+}
+
+// Moves the documents in the sparse hash table into the dense arrays, which are allocated the
+// first time.  touched and clause_touched then hold document ids.
+static void switchToDense(ACCUMULATOR* accumulator)
+{
+	AccumulatorSlot* slot;
+	int document_id;
+
+	if(accumulator->ranks == NULL)
+	{
+		accumulator->ranks = calloc(accumulator->max_documents, sizeof(int));
+		accumulator->clause_ranks = calloc(accumulator->max_documents, sizeof(int));
+		MALLOC_CHECK(accumulator->ranks);
+		MALLOC_CHECK(accumulator->clause_ranks);
+	}
+
+	accumulator->num_clause_touched = 0;
+
+	for(int i = 0; i < accumulator->num_touched; i++)
+	{
+		slot = &accumulator->slots[accumulator->touched[i]];
+		document_id = slot->document_id;
+
+		accumulator->ranks[document_id] = slot->rank;
+		accumulator->clause_ranks[document_id] = slot->clause_rank;
+		accumulator->touched[i] = document_id;
+
+		if(slot->clause_rank > 0)
+			addTouched(accumulator, document_id, 1);
+
+		slot->document_id = -1;
+	}
+
+	accumulator->mode = ACCUMULATE_DENSE;
+}
+
+// Doubles the sparse hash table, moving every document into the new one.
+static void growSlots(ACCUMULATOR* accumulator)
+{
+	AccumulatorSlot* old_slots = accumulator->slots;
+	int s;
+
+	accumulator->num_slots *= 2;
+	accumulator->slots = malloc(accumulator->num_slots * sizeof(AccumulatorSlot));
+	MALLOC_CHECK(accumulator->slots);
+
+	for(s = 0; s < accumulator->num_slots; s++)
+		accumulator->slots[s].document_id = -1;
+
+	accumulator->num_clause_touched = 0;
+
+	for(int i = 0; i < accumulator->num_touched; i++)
+	{
+		s = findSlot(accumulator, old_slots[accumulator->touched[i]].document_id);
+		accumulator->slots[s] = old_slots[accumulator->touched[i]];
+		accumulator->touched[i] = s;
+
+		if(accumulator->slots[s].clause_rank > 0)
+			addTouched(accumulator, s, 1);
+	}
+
+	free(old_slots);
+}
+
+// Adds rank to document_id's rank in the current clause, noting it the first time it's
+// touched in the query and in the clause.
+void addRank(ACCUMULATOR* accumulator, int document_id, int rank)
+{
+	AccumulatorSlot* slot;
+	int s;
+
+	if(rank <= 0 || document_id < 0)
+		return;
+
+	if(document_id >= accumulator->max_documents)
+		growDocuments(accumulator, document_id);
+
+	if(accumulator->mode == ACCUMULATE_SPARSE)
+	{
+		s = findSlot(accumulator, document_id);
+
+		if(accumulator->slots[s].document_id == -1)
+		{
+// too many documents for the table: it's either grown or given up for the dense arrays
+			if(2 * (accumulator->num_touched + 1) > accumulator->num_slots)
+			{
+				if((accumulator->num_touched + 1) > accumulator->max_documents / SPARSE_FRACTION)
+				{
+					switchToDense(accumulator);
+					addRank(accumulator, document_id, rank);
+					return;
+				}
+
+				growSlots(accumulator);
+				s = findSlot(accumulator, document_id);
+			}
+
+			accumulator->slots[s].document_id = document_id;
+			accumulator->slots[s].rank = 0;
+			accumulator->slots[s].clause_rank = 0;
+			addTouched(accumulator, s, 0);
+		}
+
+		slot = &accumulator->slots[s];
+
+		if(slot->clause_rank == 0)
+			addTouched(accumulator, s, 1);
+
+		slot->clause_rank += rank;
+		return;
+	}
+
+// a document that hasn't been touched has no rank in the query or in the clause
+	if(accumulator->clause_ranks[document_id] == 0)
+	{
+		if(accumulator->ranks[document_id] == 0)
+			addTouched(accumulator, document_id, 0);
+
+		addTouched(accumulator, document_id, 1);
+	}
+
+	accumulator->clause_ranks[document_id] += rank;
+}
+
+// Adds each posting in turn, the dense way (with room made for every document beforehand, so
+// the loop does nothing but add).
+void addPostings(ACCUMULATOR* accumulator, PostingList* postings)
+{
+	int* ranks;
+	int* clause_ranks;
+	int document_id;
+	int p = 0;
+
+	if(postings->num_docs == 0)
+		return;
+
+// a list that would fill up most of the hash table goes straight into the arrays
+	if(accumulator->mode == ACCUMULATE_SPARSE
+		&& accumulator->num_touched + postings->num_docs > accumulator->max_documents / SPARSE_FRACTION)
+		switchToDense(accumulator);
+
+// the hash table has to look each one up anyway (and may give up partway for the arrays)
+	for(; p < postings->num_docs && accumulator->mode == ACCUMULATE_SPARSE; p++)
+		addRank(accumulator, postings->doc_ids[p], postings->frequencies[p]);
+
+	if(p == postings->num_docs)
+		return;
+
+// the doc ids are sorted, so the last one is the highest
+	if(postings->doc_ids[postings->num_docs - 1] >= accumulator->max_documents)
+		growDocuments(accumulator, postings->doc_ids[postings->num_docs - 1]);
+
+	reserveTouched(accumulator, postings->num_docs - p);
+	ranks = accumulator->ranks;
+	clause_ranks = accumulator->clause_ranks;
+
+	for(; p < postings->num_docs; p++)
+	{
+		document_id = postings->doc_ids[p];
+
+		if(postings->frequencies[p] <= 0 || document_id < 0)
+			continue;
+
+		if(clause_ranks[document_id] == 0)
+		{
+			if(ranks[document_id] == 0)
+				accumulator->touched[accumulator->num_touched++] = document_id;
+
+			accumulator->clause_touched[accumulator->num_clause_touched++] = document_id;
+		}
+
+		clause_ranks[document_id] += postings->frequencies[p];
+	}
+}
+
+// Raises each document touched by the clause to its rank in the clause (ORing them).
+void endClause(ACCUMULATOR* accumulator)
+{
+	AccumulatorSlot* slot;
+	int document_id;
+
+	for(int i = 0; i < accumulator->num_clause_touched; i++)
+	{
+		if(accumulator->mode == ACCUMULATE_SPARSE)
+		{
+			slot = &accumulator->slots[accumulator->clause_touched[i]];
+
+			if(slot->clause_rank > slot->rank)
+				slot->rank = slot->clause_rank;
+
+			slot->clause_rank = 0;
+		}
+		else
+		{
+			document_id = accumulator->clause_touched[i];
+
+			if(accumulator->clause_ranks[document_id] > accumulator->ranks[document_id])
+				accumulator->ranks[document_id] = accumulator->clause_ranks[document_id];
+
+			accumulator->clause_ranks[document_id] = 0;
+		}
+	}
+
+	accumulator->num_clause_touched = 0;
+}
+
+// Returns document_id's rank so far, 0 if it hasn't been touched.
+int accumulatedRank(ACCUMULATOR* accumulator, int document_id)
+{
+	int s;
+
+	if(document_id < 0 || document_id >= accumulator->max_documents)
+		return 0;
+
+	if(accumulator->mode == ACCUMULATE_DENSE)
+		return accumulator->ranks[document_id];
+
+	s = findSlot(accumulator, document_id);
+
+	return (accumulator->slots[s].document_id == -1) ? 0 : accumulator->slots[s].rank;
+}
+
+// Offers each document touched to top, skipping the ones no better than the worst it keeps
+// without a call, or writes them all into results.
+int collectAccumulated(ACCUMULATOR* accumulator, TOP_K* top, DocumentNode* results)
+{
+	DocumentNode result;
+	int num_results = 0;
+
+	for(int i = 0; i < accumulator->num_touched; i++)
+	{
+		if(accumulator->mode == ACCUMULATE_SPARSE)
+		{
+			result.document_id = accumulator->slots[accumulator->touched[i]].document_id;
+			result.page_word_frequency = accumulator->slots[accumulator->touched[i]].rank;
+		}
+		else
+		{
+			result.document_id = accumulator->touched[i];
+			result.page_word_frequency = accumulator->ranks[result.document_id];
+		}
+
+		if(top == NULL)
+			results[num_results++] = result;
+		else if(top->size < top->k || betterResult(&result, &top->heap[0]))
+			offerTopK(top, result.document_id, result.page_word_frequency);
+	}
+
+	return num_results;
+}
+
+// Clears only the documents touched, so the next query starts from an empty accumulator.
+void resetAccumulator(ACCUMULATOR* accumulator)
+{
+// (a clause that wasn't ended leaves ranks in clause_ranks too)
+	if(accumulator->mode == ACCUMULATE_DENSE)
+	{
+		for(int i = 0; i < accumulator->num_clause_touched; i++)
+			accumulator->clause_ranks[accumulator->clause_touched[i]] = 0;
+
+		for(int i = 0; i < accumulator->num_touched; i++)
+			accumulator->ranks[accumulator->touched[i]] = 0;
+	}
+	else
+	{
+		for(int i = 0; i < accumulator->num_touched; i++)
+			accumulator->slots[accumulator->touched[i]].document_id = -1;
+	}
+
+	accumulator->num_touched = 0;
+	accumulator->num_clause_touched = 0;
+	accumulator->mode = accumulator->start_mode;
+}
+
+// Frees accumulator.
+void cleanAccumulator(ACCUMULATOR* accumulator)
+{
+	free(accumulator->ranks);
+	free(accumulator->clause_ranks);
+	free(accumulator->slots);
+	free(accumulator->touched);
+	free(accumulator->clause_touched);
+	free(accumulator);
+}
@@ -0,0 +1,94 @@
+#ifndef _ACCUMULATOR_H_
+#define _ACCUMULATOR_H_
+
+// An ACCUMULATOR adds up the ranks of the documents a query matches.  A query
+// is a list of clauses ORed together: a document's rank in a clause is the sum
+// of its frequencies for the clause's words, and its rank in the query is its
+// best rank in any clause.
+//
+// It keeps a list of the documents it has touched, so going through the
+// results and resetting it for the next query take time proportional to the
+// number of documents the query matched, not the number in the index.  It
+// holds their ranks in one of two ways:
+//
+//	ACCUMULATE_SPARSE	a hash table of the documents touched, for selective
+//				queries; once a query touches more than 1 in
+//				SPARSE_FRACTION of the documents, it moves them into
+//				the dense arrays for the rest of the query
+//	ACCUMULATE_DENSE	arrays indexed by document id, as big as the highest
+//				document id (and grown if a higher one comes along)
+
+#include "postings.h"
+#include "dictionary.h"
+#include "topk.h"
+
+#define ACCUMULATE_SPARSE 0
+#define ACCUMULATE_DENSE 1
+
+#define SPARSE_FRACTION 16
+#define INITIAL_ACCUMULATOR_SLOTS 64
+
+// a document in the sparse hash table (document_id is -1 if the slot is empty)
+typedef struct _AccumulatorSlot
+{
+	int document_id;
+	int rank;
+	int clause_rank;
+} __AccumulatorSlot;
+
+typedef struct _AccumulatorSlot AccumulatorSlot;
+
+// mode is the way the current query is held, start_mode the way each query starts out
+// ranks and clause_ranks are the dense arrays (NULL until they're needed), holding
+// max_documents documents, 0 for the ones not touched
+// slots is the sparse hash table (num_slots is a power of 2)
+// touched lists the documents touched by the query (their ids when dense, their slots
+// when sparse) and clause_touched the ones touched by the current clause (as places in
+// touched)
+typedef struct _ACCUMULATOR
+{
+	int mode;
+	int start_mode;
+	int max_documents;
+	int* ranks;
+	int* clause_ranks;
+	AccumulatorSlot* slots;
+	int num_slots;
+	int* touched;
+	int num_touched;
+	int* clause_touched;
+	int num_clause_touched;
+	int touched_capacity;
+} __ACCUMULATOR;
+
+typedef struct _ACCUMULATOR ACCUMULATOR;
+
+// initializeAccumulator returns an empty ACCUMULATOR for documents with ids below max_documents
+// (a hint, higher ones are still taken), starting each query in mode.
+ACCUMULATOR* initializeAccumulator(int max_documents, int mode);
+
+// addRank adds rank (if it's positive) to document_id's rank in the current clause.
+void addRank(ACCUMULATOR* accumulator, int document_id, int rank);
+
+// addPostings adds each posting's frequency to its document's rank in the current clause, like
+// calling addRank for each one, only faster.
+void addPostings(ACCUMULATOR* accumulator, PostingList* postings);
+
+// endClause ends the current clause, raising each document's rank to its rank in the clause.
+void endClause(ACCUMULATOR* accumulator);
+
+// accumulatedRank returns document_id's rank in the clauses ended so far, 0 if it wasn't touched.
+int accumulatedRank(ACCUMULATOR* accumulator, int document_id);
+
+// collectAccumulated offers every document touched (with its rank) to top (see topk.h), or if top
+// is NULL, writes them all into results, which must have room for num_touched of them.  Returns
+// the number written into results.
+int collectAccumulated(ACCUMULATOR* accumulator, TOP_K* top, DocumentNode* results);
+
+// resetAccumulator empties accumulator for the next query.
+void resetAccumulator(ACCUMULATOR* accumulator);
+
+// cleanAccumulator frees accumulator.
+void cleanAccumulator(ACCUMULATOR* accumulator);
+
+#endif
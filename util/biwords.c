@@ -0,0 +1,143 @@
+// Contains the functions that count, write and read the biwords of an index
+// file (see biwords.h).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "header.h"
+#include "postings.h"
+#include "dictionary.h"
+#include "docterms.h"
+#include "mapindex.h"
+#include "biwords.h"
+
+// Returns the name of the biwords file of index_file_name (malloced).
+static char* biwordsName(char* index_file_name)
+{
+	char* name = malloc(strlen(index_file_name) + strlen(BIWORDS_SUFFIX) + 1);
+
+	MALLOC_CHECK(name);
+	sprintf(name, "%s%s", index_file_name, BIWORDS_SUFFIX);
+
+	return name;
+}
+
+// Counts the pair made by each word of the document and the word after it.
+void countBiwords(DOC_TERMS* doc_terms, DOC_TERMS* pairs)
+{
+	char* pair;
+	char* first;
+	char* second;
+	int first_length;
+	int second_length;
+
+// no pair is longer than two of the document's words (and a space)
+	pair = malloc(2 * doc_terms->keys_length + 2);
+	MALLOC_CHECK(pair);
+
+	for(int position = 1; position < doc_terms->num_tokens; position++)
+	{
+		first = docTermKey(doc_terms, doc_terms->token_terms[position - 1]);
+		second = docTermKey(doc_terms, doc_terms->token_terms[position]);
+		first_length = doc_terms->terms[doc_terms->token_terms[position - 1]].key_length;
+		second_length = doc_terms->terms[doc_terms->token_terms[position]].key_length;
+
+		memcpy(pair, first, first_length);
+		pair[first_length] = ' ';
+		memcpy(pair + first_length + 1, second, second_length);
+
+		countTerm(pairs, pair, first_length + 1 + second_length);
+	}
+
+	free(pair);
+}
+
+// Moves the pairs in at least threshold documents into a new index, and frees the rest.
+INVERTED_INDEX* commonBiwords(INVERTED_INDEX* biwords, int threshold)
+{
+	INVERTED_INDEX* common = initializeDict();
+	PostingList* postings;
+
+	for(DNODE* current = biwords->start; current != NULL; current = current->next)
+	{
+		postings = current->data;
+
+		if(postings->num_docs >= threshold)
+			addData(common, postings, current->key);
+		else
+			cleanPostings(postings);
+
+		current->data = NULL;
+	}
+
+// every PostingList has been moved or freed, so this only frees the nodes
+	cleanDict(biwords);
+
+	return common;
+}
+
+// Saves biwords in the mapped format next to index_file_name.  Returns 0 if it succeeds and 1 if it fails.
+int writeBiwords(INVERTED_INDEX* biwords, char* index_file_name)
+{
+	char* name = biwordsName(index_file_name);
+	char* temporary_name = malloc(strlen(name) + 5);
+	int failed;
+
+	MALLOC_CHECK(temporary_name);
+	sprintf(temporary_name, "%s.new", name);
+
+	failed = writeMappedIndex(biwords, temporary_name);
+	failed = failed || (rename(temporary_name, name) != 0);
+
+	if(failed)
+		unlink(temporary_name);
+
+	free(temporary_name);
+	free(name);
+
+	return failed;
+}
+
+// Maps the biwords of index_file_name.  Returns NULL if there aren't any.
+MAPPED_INDEX* openBiwords(char* index_file_name)
+{
+	char* name = biwordsName(index_file_name);
+	MAPPED_INDEX* biwords = NULL;
+
+	if(access(name, F_OK) == 0)
+		biwords = openMappedIndex(name);
+
+	free(name);
+
+	return biwords;
+}
+
+// Reads the biwords of index_file_name into a new index.  Returns NULL if there aren't any.
+INVERTED_INDEX* readBiwords(char* index_file_name)
+{
+	char* name = biwordsName(index_file_name);
+	INVERTED_INDEX* biwords = NULL;
+
+	if(access(name, F_OK) == 0)
+		biwords = readMappedIndex(name);
+
+	free(name);
+
+	return biwords;
+}
+
+// Deletes the biwords of index_file_name.  Returns 1 if there were any.
+int removeBiwords(char* index_file_name)
+{
+	char* name = biwordsName(index_file_name);
+	int removed = (unlink(name) == 0);
+
+	free(name);
+
+	return removed;
+}
@@ -0,0 +1,45 @@
+#ifndef _BIWORDS_H_
+#define _BIWORDS_H_
+
+// The BIWORDS of an index file are the pairs of adjacent words that occur in
+// many of its documents ("of the", "computer science"), indexed like words.
+// They're written next to it in [INDEX FILE].biwords, a mapped index file (see
+// mapindex.h) whose keys are the two words with a space between them, when
+// it's built with the indexer's -w option.  A pair's frequency in a document
+// is the number of times the phrase occurs in it, so the query engine answers
+// a two-word phrase with one lookup, and narrows down the documents of a
+// longer phrase with its pairs before reading any positions (see positions.h).
+//
+// Only pairs in at least a threshold number of documents are kept, which
+// bounds the size of the file (and rare pairs are cheap to find through
+// positions anyway).  A pair missing from the biwords may still occur.
+
+#define BIWORDS_SUFFIX ".biwords"
+
+#include "dictionary.h"
+#include "docterms.h"
+#include "mapindex.h"
+
+// countBiwords counts every pair of adjacent words of the document counted in doc_terms (which
+// must be recording positions) in pairs, each pair's key being "first second".
+void countBiwords(DOC_TERMS* doc_terms, DOC_TERMS* pairs);
+
+// commonBiwords returns an index of the pairs in biwords that occur in at least threshold
+// documents, and frees biwords.
+INVERTED_INDEX* commonBiwords(INVERTED_INDEX* biwords, int threshold);
+
+// writeBiwords saves biwords as the biwords of index_file_name (through a temporary file that's
+// renamed over the old one).  Returns 0 if it succeeds and 1 if it fails.
+int writeBiwords(INVERTED_INDEX* biwords, char* index_file_name);
+
+// openBiwords maps the biwords of index_file_name.  Returns NULL if it has none.
+MAPPED_INDEX* openBiwords(char* index_file_name);
+
+// readBiwords reads the biwords of index_file_name into a new index.  Returns NULL if it has none.
+INVERTED_INDEX* readBiwords(char* index_file_name);
+
+// removeBiwords deletes the biwords of index_file_name (once they're out of date).  Returns 1 if
+// it had any, 0 if not.
+int removeBiwords(char* index_file_name);
+
+#endif
@@ -1,4 +1,8 @@
 // Contains the various dictionary related functions.
+//
+// The dictionary is an open-addressed (linear probing) hash table of DNODEs
+// that doubles in size with an incremental rehash, plus a doubly linked list
+// of the same DNODEs in insertion order for iterating.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,12 +11,118 @@
 
 #include "header.h"
 #include "hash.h"
+#include "postings.h"
 #include "dictionary.h"
+#include "indexfile.h"
+#include "mapindex.h"
 
-// Takes a string and returns the integer hash value for it (modified by the MAX_HASH_SLOT for the dictionary).
-int hash(char* string) 
+// Takes a string and returns its hash value.  hash1's low bits are mixed
+// into the high ones so that masking with a power of 2 table size is safe.
+unsigned long hash(char* string)
 {
-	return (hash1(string) % MAX_HASH_SLOT);
+	unsigned long h = hash1(string);
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdUL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+// Returns the index of the slot holding key in slots, or the index of the
+// empty slot where key would be placed (linear probing).
+static int probeSlots(DSLOT* slots, int num_slots, unsigned long hash_value, char* key)
+{
+	int mask = num_slots - 1;
+	int i = (int)(hash_value & mask);
+
+	while(slots[i].node != NULL)
+	{
+		if(slots[i].hash_value == hash_value && strcmp(slots[i].node->key, key) == 0)
+			break;
+
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+// Returns a zeroed table of num_slots slots.
+static DSLOT* allocateSlots(int num_slots)
+{
+	DSLOT* slots = malloc(num_slots * sizeof(DSLOT));
+	MALLOC_CHECK(slots);
+	BZERO(slots, num_slots * sizeof(DSLOT));
+
+	return slots;
+}
+
+// Moves up to max_slots slots of the old table into the current one, and
+// frees the old table once it has been fully drained.
+static void rehashStep(DICTIONARY* dict, int max_slots)
+{
+	DNODE* node;
+	int i;
+
+	while(max_slots-- > 0 && dict->rehash_position < dict->num_old_slots)
+	{
+		node = dict->old_slots[dict->rehash_position++].node;
+
+		if(node != NULL)
+		{
+			i = probeSlots(dict->slots, dict->num_slots, node->hash_value, node->key);
+			dict->slots[i].hash_value = node->hash_value;
+			dict->slots[i].node = node;
+		}
+	}
+
+	if(dict->rehash_position >= dict->num_old_slots)
+	{
+		free(dict->old_slots);
+		dict->old_slots = NULL;
+		dict->num_old_slots = 0;
+		dict->rehash_position = 0;
+	}
+}
+
+// Makes sure there's room for one more entry.  When the table gets too full
+// it's replaced by one twice the size, and the old one is drained a few
+// slots per insertion instead of all at once.
+static void growDict(DICTIONARY* dict)
+{
+	if((long)(dict->num_entries + 1) * MAX_LOAD_DENOMINATOR <= (long)dict->num_slots * MAX_LOAD_NUMERATOR)
+		return;
+
+// a previous rehash hasn't finished yet (only possible with tiny steps), so finish it first
+	if(dict->old_slots != NULL)
+		rehashStep(dict, dict->num_old_slots);
+
+	dict->old_slots = dict->slots;
+	dict->num_old_slots = dict->num_slots;
+	dict->rehash_position = 0;
+
+	dict->num_slots *= 2;
+	dict->slots = allocateSlots(dict->num_slots);
+}
+
+// Returns the DNODE whose key is key (with hash value hash_value), or NULL.
+static DNODE* findNode(DICTIONARY* dict, unsigned long hash_value, char* key)
+{
+	int i;
+
+	i = probeSlots(dict->slots, dict->num_slots, hash_value, key);
+
+	if(dict->slots[i].node != NULL)
+		return dict->slots[i].node;
+
+// keys that haven't been moved over yet are still in the old table
+	if(dict->old_slots != NULL)
+	{
+		i = probeSlots(dict->old_slots, dict->num_old_slots, hash_value, key);
+		return dict->old_slots[i].node;
+	}
+
+	return NULL;
 }
 
 // Cycles through all the values in dict, freeing them.
@@ -33,6 +143,8 @@ void cleanDict(DICTIONARY *dict)
 		current = next;
 	}
 
+	free(dict->slots);
+	free(dict->old_slots);
 	free(dict);
 }
 
@@ -42,42 +154,62 @@ void cleanIndex(INVERTED_INDEX* to_be_cleaned)
 {
 	WordNode* currentword;
 	WordNode* tempword;
-	DocumentNode* currentpage;
-	DocumentNode* temppage;
 
 	currentword = to_be_cleaned->start;
 	
 	while(currentword != NULL)
 	{
-		currentpage = currentword->data;
-		
-		while(currentpage != NULL)
-		{
-			temppage = currentpage->next;
-			free(currentpage);
-			currentpage = temppage;
-		}
+		cleanPostings(currentword->data);
 		
 		tempword = currentword->next;
 		free(currentword);
 		currentword = tempword;
 	}
 		
+	free(to_be_cleaned->slots);
+	free(to_be_cleaned->old_slots);
 	free(to_be_cleaned);
 }
 
+// Returns the highest document id in index (the last posting of each word, as they're sorted).
+int maxIndexDocument(INVERTED_INDEX* index)
+{
+	PostingList* postings;
+	int max_document = -1;
+
+	for(WordNode* current = index->start; current != NULL; current = current->next)
+	{
+		postings = current->data;
+
+		if(postings->num_docs > 0 && postings->doc_ids[postings->num_docs - 1] > max_document)
+			max_document = postings->doc_ids[postings->num_docs - 1];
+	}
+
+	return max_document;
+}
+
 // Returns an empty dictionary.
 DICTIONARY* initializeDict()
+{
+	return initializeSizedDict(0);
+}
+
+// Returns an empty dictionary with a table big enough for num_entries entries,
+// so adding that many never grows it.
+DICTIONARY* initializeSizedDict(int num_entries)
 {
 	DICTIONARY* dict = (DICTIONARY*)malloc(sizeof(DICTIONARY));
   	MALLOC_CHECK(dict);
   	BZERO(dict, sizeof(DICTIONARY));
   	dict->start = dict->end = NULL;
 
-	for(int i=0; i<MAX_HASH_SLOT; i++)
-	{
-		dict->hash[i] = NULL;
-	}
+	dict->num_slots = INITIAL_HASH_SLOTS;
+
+	while(dict->num_slots < (1 << 30) && (long)num_entries * MAX_LOAD_DENOMINATOR > (long)dict->num_slots * MAX_LOAD_NUMERATOR)
+		dict->num_slots *= 2;
+
+	dict->slots = allocateSlots(dict->num_slots);
+	dict->old_slots = NULL;
 
   	return dict;
 }
@@ -85,72 +217,48 @@ DICTIONARY* initializeDict()
 // Adds the void* data to the dictionary at the given key.
 // Returns 0 if it succeeds and 1 if data is already contained
 // in dict at key.
-// For this lab, modified so that void* data must be a DNODE.
+// New DNODEs are appended to the end of the list, so iterating from
+// dict->start visits the keys in the order they were added.
 int addData(DICTIONARY* dict, void* data, char* key)
 {
-	int hash_index;
+	unsigned long hash_value;
+	int key_length;
+	int i;
 
-	DNODE* currentdnode;
 	DNODE* newdnode;
 
-	char* current_key;
+	hash_value = hash(key);
+
+	if(findNode(dict, hash_value, key) != NULL)
+		return 1;
 
-	hash_index = hash(key);
-	newdnode = malloc(sizeof(DNODE));
+	growDict(dict);
+
+	if(dict->old_slots != NULL)
+		rehashStep(dict, REHASH_STEP);
+
+	key_length = strlen(key);
+	newdnode = malloc(sizeof(DNODE) + key_length + 1);
 	MALLOC_CHECK(newdnode);
 	newdnode->data = data;
-	BZERO(newdnode->key, KEY_LENGTH);
-	strncpy(newdnode->key, key, KEY_LENGTH);
+	newdnode->hash_value = hash_value;
+	newdnode->key_length = key_length;
+	memcpy(newdnode->key, key, key_length + 1);
 
-	if((dict->hash[hash_index]) != NULL)
-	{
-		currentdnode=dict->hash[hash_index];
+	i = probeSlots(dict->slots, dict->num_slots, hash_value, key);
+	dict->slots[i].hash_value = hash_value;
+	dict->slots[i].node = newdnode;
 
-		while( 1 )
-		{
-			current_key = currentdnode->key;
-			
-			if(strcmp(current_key, key) == 0)	// the difference in data structures occurs here (increment instead of throwing it out)
-			{
-				free(newdnode);	
-				
-				return 1;
-			}
-			
-			if(currentdnode->next == NULL || hash(currentdnode->next->key) != hash_index)
-				break;
-			else
-				currentdnode = currentdnode->next;
-		}
+	newdnode->next = NULL;
+	newdnode->prev = dict->end;
 
-		newdnode->next = currentdnode->next;
-		newdnode->prev = currentdnode;
-			
-		if((currentdnode->next) != NULL)
-			currentdnode->next->prev = newdnode;
-
-		currentdnode->next=newdnode;
-		//dict->end = newdnode;
-	}
+	if(dict->end != NULL)
+		dict->end->next = newdnode;
 	else
-	{
-		currentdnode=dict->start;
-		
-		if(currentdnode != NULL)
-		{
-			while(currentdnode->next != NULL)
-				currentdnode = currentdnode->next;	
-		
-			currentdnode->next = newdnode;	
-		}
-		else
-			dict->start = newdnode;	
+		dict->start = newdnode;
 
-		newdnode->next = NULL;
-		newdnode->prev = currentdnode;
-		dict->end = newdnode;
-		dict->hash[hash_index] = newdnode;
-	}	
+	dict->end = newdnode;
+	dict->num_entries++;
 
 	return 0;
 }
@@ -158,85 +266,20 @@ int addData(DICTIONARY* dict, void* data, char* key)
 // Returns the DNODE associated with the char* key in dict.
 DNODE* getData(DICTIONARY* dict, char* key)
 {
-	int hash_index;
-	DNODE* dnode;
-
-	hash_index = hash(key);
-	dnode = dict->hash[hash_index];
-
-	while(dnode != NULL)
-	{
-		if(strcmp((dnode->key), key) == 0)
-			break;
-		else
-			dnode = dnode->next;
-	}
-
-	return dnode;
+	return findNode(dict, hash(key), key);
 }
 
-// readIndex takes a file_name (which points to an index file), a reads the data into
-// an index structure and returns that structure.
+// readIndex takes a file_name (which points to an index file, text, binary or mapped), a reads the data into
+// an index structure and returns that structure (or NULL if the file can't be read).
 INVERTED_INDEX* readIndex(char* file_name)
 {
-	FILE* fp;
-	INVERTED_INDEX* new_index;
-
-	char *word;	
-	int page_count;
-	int page;
-	int count;
-
-	WordNode* wordnode;
-	DocumentNode* docnode;
-	DocumentNode* currentdocnode;
-
-	new_index = initializeDict();
+// binary index files are read by readBinaryIndex (see indexfile.h)
+	if(isBinaryIndex(file_name))
+		return readBinaryIndex(file_name);
 
-	fp = fopen(file_name, "r");
+// and mapped ones by readMappedIndex (see mapindex.h)
+	if(isMappedIndex(file_name))
+		return readMappedIndex(file_name);
 
-	word = malloc(500*sizeof(char));
-	MALLOC_CHECK(word);
-	BZERO(word, 500*sizeof(char));
-
-// goes through each line and pulls the first two strings from it (ie the word and the page count)
-	while(fscanf(fp, "%s %d", word, &page_count) == 2)
-	{
-		wordnode = NULL;
-
-// goes through the rest of the line, pulling two integers from it a time up to the page_count
-		for(int i = 0; i < page_count; i++)
-		{
-			fscanf(fp, "%d %d", &page, &count);
-			currentdocnode = NULL;
-			docnode = NULL;
-
-// creates a DocumentNode from the given page and count information
-			docnode = malloc(sizeof(DocumentNode));
-			MALLOC_CHECK(docnode);
-			docnode->document_id = page;
-			docnode->page_word_frequency = count;
-			docnode->next = NULL;
-
-// if there's already a WordNode for the word, it adds it to its data
-			if((wordnode = getData(new_index, word)) != NULL)
-			{
-				currentdocnode = wordnode->data;
-
-				while((currentdocnode->next) != NULL)
-					currentdocnode = currentdocnode->next;
-
-				currentdocnode->next = docnode;
-			}
-			else
-// otherwise it adds the WordNode and the DocumentNode
-				addData(new_index, docnode, word);
-		}	
-	}	
-
-	free(word);
-	fclose(fp);
-
-	return new_index;
+	return readTextIndex(file_name, 1);
 }
-
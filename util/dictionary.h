@@ -1,23 +1,54 @@
 #ifndef _DICTIONARY_H_
 #define _DICTIONARY_H_
 
-#define KEY_LENGTH 2049
-#define MAX_HASH_SLOT 10000
+#include "postings.h"
+
+// the table starts with this many slots and doubles whenever it gets more
+// than MAX_LOAD_NUMERATOR/MAX_LOAD_DENOMINATOR full (must be a power of 2)
+#define INITIAL_HASH_SLOTS 64
+#define MAX_LOAD_NUMERATOR 1
+#define MAX_LOAD_DENOMINATOR 2
+
+// number of old slots moved into the new table on every insertion while
+// the dictionary is growing (incremental rehash)
+#define REHASH_STEP 4
 
 // DNODE functions the same as WordNode, and will therefore be implemented as such
+// next and prev link every DNODE in insertion order (start to end)
+// key is variable-length and allocated together with the node
 typedef struct _DNODE
 {
 	struct _DNODE *next;
 	struct _DNODE *prev;
 	void* data;
-	char key[KEY_LENGTH];
+	unsigned long hash_value;
+	int key_length;
+	char key[];
 } __DNODE;
 
 typedef struct _DNODE DNODE;
 
+// a slot in the open-addressed table.  The hash value is kept beside the
+// node so probing only touches a DNODE whose hash actually matches.
+typedef struct _DSLOT
+{
+	unsigned long hash_value;
+	DNODE* node;
+} __DSLOT;
+
+typedef struct _DSLOT DSLOT;
+
+// slots is the current (linear probing) table.  While the dictionary is
+// growing, old_slots still holds the previous table; its entries are moved
+// over REHASH_STEP at a time, starting at rehash_position.
 typedef struct _DICTIONARY
 {
-	DNODE* hash[MAX_HASH_SLOT];
+	DSLOT* slots;
+	int num_slots;
+	DSLOT* old_slots;
+	int num_old_slots;
+	int rehash_position;
+	int num_entries;
 	DNODE* start;
 	DNODE* end;
 } __DICTIONARY;
@@ -25,12 +56,12 @@ typedef struct _DICTIONARY
 typedef struct _DICTIONARY DICTIONARY;
 
 // contains the DocumentNode structure
-// next points to the next DocNode
+// a single (document, frequency) pair, e.g. one match of a query
 // doc_id is the id for the document
 // page_word_frequency is the number of times it occurs
+// (an index stores these as PostingLists, see postings.h)
 typedef struct _DocumentNode
 {
-	struct _DocumentNode *next;
 	int document_id;
 	int page_word_frequency;
 } __DocumentNode;
@@ -39,18 +70,26 @@ typedef struct _DocumentNode DocumentNode;
 
 // the following typedefs are included to use the existing data structures and
 // functions from crawler.  they're defined in dictionary.h and dictionary.c
+// in an INVERTED_INDEX the data of every WordNode is a PostingList
 typedef struct _DNODE WordNode;
 
 typedef struct _DICTIONARY INVERTED_INDEX;
 
-int hash(char* string);
+// Returns the (well mixed) hash value of string.
+unsigned long hash(char* string);
 
 DICTIONARY* initializeDict();
 
+// initializeSizedDict returns an empty dictionary whose table already has room for
+// num_entries entries, for when the number of keys is known up front (like reading an index).
+DICTIONARY* initializeSizedDict(int num_entries);
+
 void cleanDict(DICTIONARY* dict);
 
 int addData(DICTIONARY* dict, void* data, char* key);
 
+// readIndex reads an index file (text or binary, see indexfile.h, or mapped, see mapindex.h) into a new index.
+// Returns NULL if the file can't be read.
 INVERTED_INDEX* readIndex(char* filename);
 
 DNODE* getData(DICTIONARY* dict, char* key);
@@ -59,4 +98,7 @@ DNODE* getData(DICTIONARY* dict, char* key);
 // contains.  After looping through them all, it finally frees the index.
 void cleanIndex(INVERTED_INDEX* to_be_cleaned);
 
+// maxIndexDocument returns the highest document id in index, or -1 if it's empty.
+int maxIndexDocument(INVERTED_INDEX* index);
+
 #endif
@@ -0,0 +1,215 @@
+// Contains the DOC_TERMS functions, a small per-document table that counts
+// each distinct word of a page (see docterms.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "header.h"
+#include "hash.h"
+#include "dictionary.h"
+#include "docterms.h"
+#include "textscan.h"
+
+// Returns an empty DOC_TERMS.
+DOC_TERMS* initializeDocTerms()
+{
+	DOC_TERMS* doc_terms = malloc(sizeof(DOC_TERMS));
+	MALLOC_CHECK(doc_terms);
+	BZERO(doc_terms, sizeof(DOC_TERMS));
+
+	doc_terms->num_slots = INITIAL_DOC_TERM_SLOTS;
+	doc_terms->slots = malloc(doc_terms->num_slots * sizeof(int));
+	MALLOC_CHECK(doc_terms->slots);
+	BZERO(doc_terms->slots, doc_terms->num_slots * sizeof(int));
+
+	doc_terms->terms_capacity = INITIAL_DOC_TERM_SLOTS / 2;
+	doc_terms->terms = malloc(doc_terms->terms_capacity * sizeof(DocTerm));
+	MALLOC_CHECK(doc_terms->terms);
+
+	doc_terms->keys_capacity = INITIAL_DOC_KEYS_LENGTH;
+	doc_terms->keys = malloc(doc_terms->keys_capacity);
+	MALLOC_CHECK(doc_terms->keys);
+
+	return doc_terms;
+}
+
+// Returns the slot in doc_terms where the term with hash_value and key belongs.
+static int probeDocTerms(DOC_TERMS* doc_terms, unsigned long hash_value, char* key)
+{
+	int mask = doc_terms->num_slots - 1;
+	int i = (int)(hash_value & mask);
+	DocTerm* term;
+
+	while(doc_terms->slots[i] != 0)
+	{
+		term = &(doc_terms->terms[doc_terms->slots[i] - 1]);
+
+		if(term->hash_value == hash_value && strcmp(doc_terms->keys + term->key_offset, key) == 0)
+			break;
+
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+// Doubles the hash table of doc_terms and puts every term back into it.
+static void growDocTerms(DOC_TERMS* doc_terms)
+{
+	DocTerm* term;
+
+	free(doc_terms->slots);
+	doc_terms->num_slots *= 2;
+	doc_terms->slots = malloc(doc_terms->num_slots * sizeof(int));
+	MALLOC_CHECK(doc_terms->slots);
+	BZERO(doc_terms->slots, doc_terms->num_slots * sizeof(int));
+
+	for(int t = 0; t < doc_terms->num_terms; t++)
+	{
+		term = &(doc_terms->terms[t]);
+		term->slot = probeDocTerms(doc_terms, term->hash_value, doc_terms->keys + term->key_offset);
+		doc_terms->slots[term->slot] = t + 1;
+	}
+}
+
+// Records that the next word counted is term number t, if positions are being recorded.
+static void recordToken(DOC_TERMS* doc_terms, int t)
+{
+	if(!doc_terms->record_positions)
+		return;
+
+	if(doc_terms->num_tokens == doc_terms->tokens_capacity)
+	{
+		doc_terms->tokens_capacity = doc_terms->tokens_capacity * 2 + INITIAL_DOC_TERM_SLOTS;
+		doc_terms->token_terms = realloc(doc_terms->token_terms, doc_terms->tokens_capacity * sizeof(int));
+		MALLOC_CHECK(doc_terms->token_terms);
+		doc_terms->positions = realloc(doc_terms->positions, doc_terms->tokens_capacity * sizeof(int));
+		MALLOC_CHECK(doc_terms->positions);
+	}
+
+	doc_terms->token_terms[doc_terms->num_tokens] = t;
+}
+
+// Copies the word to the end of keys (lower casing it like NormalizeWord), then
+// either counts another occurence of an existing term, or keeps the copy as a new term.
+void countTerm(DOC_TERMS* doc_terms, char* word, int length)
+{
+	char* key;
+	unsigned long hash_value;
+	int slot;
+	DocTerm* term;
+
+	if(doc_terms->keys_length + length + 1 > doc_terms->keys_capacity)
+	{
+		while(doc_terms->keys_length + length + 1 > doc_terms->keys_capacity)
+			doc_terms->keys_capacity *= 2;
+
+		doc_terms->keys = realloc(doc_terms->keys, doc_terms->keys_capacity);
+		MALLOC_CHECK(doc_terms->keys);
+	}
+
+	key = doc_terms->keys + doc_terms->keys_length;
+
+	lowercaseCopy(key, word, length);
+	key[length] = 0;
+
+	hash_value = hash(key);
+	slot = probeDocTerms(doc_terms, hash_value, key);
+
+// it's been seen before, so the copy is simply dropped
+	if(doc_terms->slots[slot] != 0)
+	{
+		recordToken(doc_terms, doc_terms->slots[slot] - 1);
+		doc_terms->terms[doc_terms->slots[slot] - 1].frequency++;
+		doc_terms->num_tokens++;
+		return;
+	}
+
+	if(doc_terms->num_terms == doc_terms->terms_capacity)
+	{
+		doc_terms->terms_capacity *= 2;
+		doc_terms->terms = realloc(doc_terms->terms, doc_terms->terms_capacity * sizeof(DocTerm));
+		MALLOC_CHECK(doc_terms->terms);
+	}
+
+	term = &(doc_terms->terms[doc_terms->num_terms]);
+	term->hash_value = hash_value;
+	term->key_offset = doc_terms->keys_length;
+	term->key_length = length;
+	term->frequency = 1;
+	term->slot = slot;
+
+	recordToken(doc_terms, doc_terms->num_terms);
+	doc_terms->slots[slot] = ++(doc_terms->num_terms);
+	doc_terms->keys_length += length + 1;
+	doc_terms->num_tokens++;
+
+// keeps the table at most half full
+	if(2 * doc_terms->num_terms > doc_terms->num_slots)
+		growDocTerms(doc_terms);
+}
+
+// Returns the lower cased text of the i'th distinct term.
+char* docTermKey(DOC_TERMS* doc_terms, int i)
+{
+	return doc_terms->keys + doc_terms->terms[i].key_offset;
+}
+
+// Turns recording the position of every word counted on (record is 1) or off.
+void recordPositions(DOC_TERMS* doc_terms, int record)
+{
+	doc_terms->record_positions = record;
+}
+
+// Sorts the recorded positions by term (a counting sort, as each term's frequency
+// is its number of positions), so each term's positions are together and in order.
+void groupPositions(DOC_TERMS* doc_terms)
+{
+	int first_position = 0;
+	DocTerm* term;
+
+	for(int t = 0; t < doc_terms->num_terms; t++)
+	{
+		doc_terms->terms[t].first_position = first_position;
+		first_position += doc_terms->terms[t].frequency;
+	}
+
+// first_position is moved along as each position is placed, and then moved back
+	for(int position = 0; position < doc_terms->num_tokens; position++)
+	{
+		term = &(doc_terms->terms[doc_terms->token_terms[position]]);
+		doc_terms->positions[term->first_position++] = position;
+	}
+
+	for(int t = 0; t < doc_terms->num_terms; t++)
+		doc_terms->terms[t].first_position -= doc_terms->terms[t].frequency;
+}
+
+// Returns the positions of the i'th distinct term (frequency of them, lowest first).
+int* termPositions(DOC_TERMS* doc_terms, int i)
+{
+	return doc_terms->positions + doc_terms->terms[i].first_position;
+}
+
+// Empties doc_terms, only clearing the slots that were used.
+void resetDocTerms(DOC_TERMS* doc_terms)
+{
+	for(int t = 0; t < doc_terms->num_terms; t++)
+		doc_terms->slots[doc_terms->terms[t].slot] = 0;
+
+	doc_terms->num_terms = 0;
+	doc_terms->keys_length = 0;
+	doc_terms->num_tokens = 0;
+}
+
+// Frees doc_terms.
+void cleanDocTerms(DOC_TERMS* doc_terms)
+{
+	free(doc_terms->slots);
+	free(doc_terms->terms);
+	free(doc_terms->keys);
+	free(doc_terms->token_terms);
+	free(doc_terms->positions);
+	free(doc_terms);
+}
@@ -0,0 +1,80 @@
+#ifndef _DOCTERMS_H_
+#define _DOCTERMS_H_
+
+// DOC_TERMS counts the words of a single document before they're merged into
+// an index, so the index is only touched once per distinct word per document.
+// It's meant to be reused: resetDocTerms empties it but keeps its memory.
+// It can also record where each word occured (its positions, the number of
+// words counted before it), for the positional index (see positions.h).
+
+#define INITIAL_DOC_TERM_SLOTS 1024
+#define INITIAL_DOC_KEYS_LENGTH 16384
+
+// a distinct (lower case) word of the document
+// key_offset is where the word starts in the DOC_TERMS keys buffer
+// frequency is the number of times it occured
+// slot is where it sits in the hash table (so resetDocTerms can clear it)
+// first_position is where its positions start in positions (after groupPositions)
+typedef struct _DocTerm
+{
+	unsigned long hash_value;
+	int key_offset;
+	int key_length;
+	int frequency;
+	int slot;
+	int first_position;
+} __DocTerm;
+
+typedef struct _DocTerm DocTerm;
+
+// slots is an open-addressed table of (index into terms) + 1, 0 being empty
+// terms are kept in the order they first occured in the document
+// keys holds every term's NUL-terminated, lower cased text
+// num_tokens counts every word counted (including repeats)
+// if record_positions is 1, token_terms holds the term of every word counted, in order,
+// and groupPositions sorts them into positions, each term's positions together
+typedef struct _DOC_TERMS
+{
+	int* slots;
+	int num_slots;
+	DocTerm* terms;
+	int num_terms;
+	int terms_capacity;
+	char* keys;
+	int keys_length;
+	int keys_capacity;
+	int num_tokens;
+	int record_positions;
+	int* token_terms;
+	int* positions;
+	int tokens_capacity;
+} __DOC_TERMS;
+
+typedef struct _DOC_TERMS DOC_TERMS;
+
+// initializeDocTerms returns an empty DOC_TERMS.
+DOC_TERMS* initializeDocTerms();
+
+// countTerm lower cases the length characters at word and counts one occurence of them.
+void countTerm(DOC_TERMS* doc_terms, char* word, int length);
+
+// docTermKey returns the lower cased text of the i'th distinct term.
+char* docTermKey(DOC_TERMS* doc_terms, int i);
+
+// recordPositions makes countTerm record the position of every word if record is 1.
+void recordPositions(DOC_TERMS* doc_terms, int record);
+
+// groupPositions sorts the recorded positions by term, after a document is counted.
+void groupPositions(DOC_TERMS* doc_terms);
+
+// termPositions returns the positions of the i'th distinct term (its frequency of them,
+// in increasing order), after groupPositions.
+int* termPositions(DOC_TERMS* doc_terms, int i);
+
+// resetDocTerms empties doc_terms in time proportional to the terms it held.
+void resetDocTerms(DOC_TERMS* doc_terms);
+
+// cleanDocTerms frees doc_terms.
+void cleanDocTerms(DOC_TERMS* doc_terms);
+
+#endif
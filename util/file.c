@@ -3,10 +3,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <dirent.h>
 
@@ -23,11 +25,12 @@ int fileLength(char* filename)
 }
 
 // Reads the contents into a malloced string from the file filename and
-// returns that string.
+// returns that string, or NULL if the file can't be read completely.
 char* readFile(char* filename)
 {
 	FILE *fp;
 	char* file_contents;
+	struct stat s;
 	
 	fp = fopen(filename, "r");
 
@@ -37,19 +40,138 @@ char* readFile(char* filename)
 		exit(-1);
 	}
 
-	int file_length = fileLength(filename);
+	if(fstat(fileno(fp), &s) != 0)
+	{
+		fclose(fp);
+		return NULL;
+	}
 
-	file_contents = malloc(sizeof(char) * file_length + 1);
-	BZERO(file_contents, (file_length + 1));
+	file_contents = malloc(sizeof(char) * s.st_size + 1);
+	MALLOC_CHECK(file_contents);
 
-	if(fread(file_contents, sizeof(char), file_length, fp) < file_length)
+	if(fread(file_contents, sizeof(char), s.st_size, fp) < s.st_size)
+	{
+		free(file_contents);
+		fclose(fp);
 		return NULL;
+	}
 
+	file_contents[s.st_size] = 0;
 	fclose(fp);
 
 	return file_contents;
 }
 
+// Sets up an empty document (with no buffer yet).
+void initializeDocument(DOCUMENT* document)
+{
+	document->contents = NULL;
+	document->length = 0;
+	document->mapped = 0;
+	document->buffer = NULL;
+	document->buffer_capacity = 0;
+}
+
+// The contents are NUL-terminated like readFile's.
+char* fillDocument(DOCUMENT* document, long length)
+{
+	if(length + 1 > document->buffer_capacity)
+	{
+		free(document->buffer);
+		document->buffer_capacity = (length + 1) * 2;
+		document->buffer = malloc(document->buffer_capacity);
+		MALLOC_CHECK(document->buffer);
+	}
+
+	document->buffer[length] = 0;
+	document->contents = document->buffer;
+	document->length = length;
+	document->mapped = 0;
+
+	return document->buffer;
+}
+
+// Reads length bytes of the open file fd into document's buffer.  Returns 0 if it succeeds, 1 if not.
+static int readDocument(DOCUMENT* document, int fd, long length)
+{
+	char* buffer = fillDocument(document, length);
+	long total = 0;
+	ssize_t bytes;
+
+	while(total < length)
+	{
+		if((bytes = read(fd, buffer + total, length - total)) <= 0)
+			return 1;
+
+		total += bytes;
+	}
+
+	return 0;
+}
+
+// Maps big files and reads small ones (see DOCUMENT_MAP_THRESHOLD).  If a mapping fails, the
+// file is read instead.
+int openDocument(DOCUMENT* document, char* file_name)
+{
+	struct stat s;
+	void* mapping;
+	int fd;
+	int failed;
+
+	if((fd = open(file_name, O_RDONLY)) == -1)
+		return 1;
+
+	if(fstat(fd, &s) != 0 || !S_ISREG(s.st_mode))
+	{
+		close(fd);
+		return 1;
+	}
+
+	if(s.st_size >= DOCUMENT_MAP_THRESHOLD)
+	{
+		mapping = mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(mapping != MAP_FAILED)
+		{
+			posix_madvise(mapping, s.st_size, POSIX_MADV_SEQUENTIAL);
+			close(fd);
+
+			document->contents = mapping;
+			document->length = s.st_size;
+			document->mapped = 1;
+
+			return 0;
+		}
+	}
+	else
+	{
+		posix_fadvise(fd, 0, s.st_size, POSIX_FADV_SEQUENTIAL);
+	}
+
+	failed = readDocument(document, fd, s.st_size);
+	close(fd);
+
+	return failed;
+}
+
+void closeDocument(DOCUMENT* document)
+{
+	if(document->mapped)
+		munmap(document->contents, document->length);
+
+	document->contents = NULL;
+	document->length = 0;
+	document->mapped = 0;
+}
+
+void cleanDocument(DOCUMENT* document)
+{
+	closeDocument(document);
+	free(document->buffer);
+	document->buffer = NULL;
+	document->buffer_capacity = 0;
+}
+
 // Takes a file_name returns 0 if it's a regular file.  1 if not.
 int regularFile(char* file_name)
 {
@@ -75,10 +197,156 @@ int numFiles(char* directory_name)
 	return s.st_nlink;
 }
 
-// Uses scandir to store all the file names of the files in directory_name into files.
+// Compares two file names.  Names that are all digits (the crawler's
+// document ids) come first, in numeric order, followed by everything else in
+// alphabetical order.
+static int numericsort(const struct dirent **a, const struct dirent **b)
+{
+	const char* first = (*a)->d_name;
+	const char* second = (*b)->d_name;
+	int first_numeric = (first[strspn(first, "0123456789")] == 0 && first[0] != 0);
+	int second_numeric = (second[strspn(second, "0123456789")] == 0 && second[0] != 0);
+	long first_id, second_id;
+
+	if(first_numeric != second_numeric)
+		return second_numeric - first_numeric;
+
+	if(first_numeric)
+	{
+		first_id = atol(first);
+		second_id = atol(second);
+
+		if(first_id != second_id)
+			return (first_id > second_id) - (first_id < second_id);
+	}
+
+	return strcmp(first, second);
+}
+
+// numericsort for qsort.
+static int compareFileNames(const void* a, const void* b)
+{
+	return numericsort((const struct dirent**)a, (const struct dirent**)b);
+}
+
+// Returns the document id file_name stands for, or -1 if it isn't all digits (or is too long to be an id).
+static long documentId(char* file_name)
+{
+	long id = 0;
+	int i;
+
+	for(i = 0; file_name[i] >= '0' && file_name[i] <= '9'; i++)
+	{
+		if(i == 9)
+			return -1;
+
+		id = id * 10 + (file_name[i] - '0');
+	}
+
+	return (i > 0 && file_name[i] == 0) ? id : -1;
+}
+
+// Puts the num_files names in list in numericsort order.  The crawler names its files 1, 2, 3 ..., so
+// the numeric names are put straight into place by id instead of being sorted.  Only the others (like
+// . and ..) are sorted, unless ids repeat ("7" and "007") or are too spread out to place directly.
+static void orderFileList(struct dirent** list, int num_files)
+{
+	struct dirent** by_id;
+	long* ids;
+	long max_id = -1;
+	int num_numeric = 0;
+	int position;
+
+	ids = malloc((num_files + 1) * sizeof(long));
+	MALLOC_CHECK(ids);
+
+	for(int i = 0; i < num_files; i++)
+	{
+		if((ids[i] = documentId(list[i]->d_name)) > max_id)
+			max_id = ids[i];
+
+		num_numeric += (ids[i] >= 0);
+	}
+
+	if(num_numeric == 0 || max_id >= 2L * num_files + 64)
+	{
+		free(ids);
+		qsort(list, num_files, sizeof(struct dirent*), compareFileNames);
+		return;
+	}
+
+	by_id = calloc(max_id + 1, sizeof(struct dirent*));
+	MALLOC_CHECK(by_id);
+
+	for(int i = 0; i < num_files; i++)
+	{
+		if(ids[i] >= 0 && by_id[ids[i]] != NULL)
+		{
+			free(by_id);
+			free(ids);
+			qsort(list, num_files, sizeof(struct dirent*), compareFileNames);
+			return;
+		}
+
+		if(ids[i] >= 0)
+			by_id[ids[i]] = list[i];
+	}
+
+// the other names keep their relative order at the end of list, then get sorted there
+	position = num_files;
+	for(int i = num_files - 1; i >= 0; i--)
+	{
+		if(ids[i] < 0)
+			list[--position] = list[i];
+	}
+
+	position = 0;
+	for(long id = 0; id <= max_id; id++)
+	{
+		if(by_id[id] != NULL)
+			list[position++] = by_id[id];
+	}
+
+	qsort(list + num_numeric, num_files - num_numeric, sizeof(struct dirent*), compareFileNames);
+
+	free(by_id);
+	free(ids);
+}
+
+// Stores all the file names of the files in directory_name into files (each one malloced, like
+// scandir does), sorted by document id (see numericsort and orderFileList).  Returns the number
+// of names, or -1 if the directory can't be read.
 int getFileList(char* directory_name, struct dirent ***files)
 {
-	int num_files = scandir(directory_name, files, 0, alphasort);
+	DIR* directory;
+	struct dirent* entry;
+	struct dirent** list = NULL;
+	int num_files = 0;
+	int capacity = 0;
+
+	if((directory = opendir(directory_name)) == NULL)
+		return -1;
+
+	while((entry = readdir(directory)) != NULL)
+	{
+		if(num_files == capacity)
+		{
+			capacity = capacity * 2 + 64;
+			list = realloc(list, capacity * sizeof(struct dirent*));
+			MALLOC_CHECK(list);
+		}
+
+// readdir's entries can be shorter than a struct dirent, so only the name's part is copied
+		list[num_files] = malloc(sizeof(struct dirent));
+		MALLOC_CHECK(list[num_files]);
+		memcpy(list[num_files], entry, offsetof(struct dirent, d_name) + strlen(entry->d_name) + 1);
+		num_files++;
+	}
+
+	closedir(directory);
+
+	orderFileList(list, num_files);
+	*files = list;
 
 	return num_files;
 }
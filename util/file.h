@@ -1,6 +1,54 @@
 #ifndef _FILE_H_
 #define _FILE_H_
 
+// pages at least this many bytes long are memory mapped by openDocument, smaller ones are read
+// into the DOCUMENT's buffer (mapping costs more than copying for a few pages' worth)
+#define DOCUMENT_MAP_THRESHOLD (64 * 1024)
+
+// A DOCUMENT gives the contents of one file at a time without copying it into a new string.
+// Big files are memory mapped (read only, with a sequential access hint), small ones are read
+// into a buffer that's reused (and grown) from one file to the next.
+//
+// contents:         the file's contents, length characters (not NUL-terminated when mapped)
+// mapped:           1 if contents is a mapping to unmap
+// buffer:           the reused buffer, buffer_capacity bytes
+typedef struct _DOCUMENT
+{
+	char* contents;
+	long length;
+	int mapped;
+	char* buffer;
+	long buffer_capacity;
+} __DOCUMENT;
+
+typedef struct _DOCUMENT DOCUMENT;
+
+// Usage Example  (count the words of every file)
+// DOCUMENT document;
+// initializeDocument(&document);
+// for each file_name {
+//     if (openDocument(&document, file_name) == 0) {
+//         /* DO SOMETHING WITH document.contents AND document.length */
+//         closeDocument(&document);
+//     }
+// }
+// cleanDocument(&document);
+void initializeDocument(DOCUMENT* document);
+
+// openDocument makes document hold the contents of the regular file file_name.  Returns 0 if it
+// succeeds, 1 if the file can't be opened, isn't a regular file or can't be read.
+int openDocument(DOCUMENT* document, char* file_name);
+
+// fillDocument makes document's contents its buffer, length characters long (and NUL-terminated),
+// growing the buffer if it's too small, and returns the buffer for the caller to fill in.
+char* fillDocument(DOCUMENT* document, long length);
+
+// closeDocument lets go of the file openDocument opened (the buffer is kept for the next one).
+void closeDocument(DOCUMENT* document);
+
+// cleanDocument frees document's buffer.
+void cleanDocument(DOCUMENT* document);
+
 int fileLength(char* filename);
 
 char* readFile(char* filename);
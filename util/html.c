@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "html.h"
+#include "textscan.h"
 
 /*
 
@@ -169,12 +170,13 @@ int GetNextURL(char *html, char *urlofthispage, char *result, int pos) {
 }
 
 // Takes a string html_doc, an output string resulting_word, and a starting
-// position current position and stores the next non-tag word into resulting_word.
+// position current position and stores the next non-tag word into resulting_word
+// (NUL-terminated, so resulting_word can be reused without clearing it).
 // Returns the position where it finished parsing, or -1 if it's done.
 int parseHTML(char *html_doc, char *resulting_word, int current_position) 
 {
   	char c;
-  	char *p1;  //!< pointer pointed to the start of a new word
+  	char *p1 = NULL;  //!< pointer pointed to the start of a new word
   	char *p2;  //!< pointer pointed to the end of a new word
 
 	int tag_flag = 0;
@@ -224,6 +226,7 @@ int parseHTML(char *html_doc, char *resulting_word, int current_position)
 				{
 					p2 = &(html_doc[current_position]);
 					strncpy(resulting_word, p1, (p2-p1));
+					resulting_word[p2-p1] = 0;
 					return current_position;
 				}
 			}
@@ -243,6 +246,212 @@ int parseHTML(char *html_doc, char *resulting_word, int current_position)
 	return -1;
 }
 
+// Sets up tokenizer to walk the page html (length characters long).  The first two lines
+// of a crawled page aren't HTML, so the words start at the second newline.
+void initializeTokenizer(TOKENIZER* tokenizer, char* html, long length)
+{
+	long position = 0;
+	int newline_count = 0;
+
+	while(position < length && html[position] != 0)
+	{
+		if(html[position] == '\n' && ++newline_count == 2)
+			break;
+
+		position++;
+	}
+
+	tokenizer->html = html;
+	tokenizer->length = length;
+	tokenizer->position = position;
+	tokenizer->in_tag = 0;
+	tokenizer->skip_code = 0;
+	tokenizer->scratch = NULL;
+	tokenizer->scratch_capacity = 0;
+}
+
+void skipCode(TOKENIZER* tokenizer, int skip_code)
+{
+	tokenizer->skip_code = skip_code;
+}
+
+// returns 1 if the characters at position (before end) are name, in any case, and
+// aren't followed by another letter or digit (so "<scripts" isn't "<script")
+static int matchTagName(char* position, char* end, char* name)
+{
+	for(; *name != 0; position++, name++)
+	{
+		if(position >= end || (*position | 32) != *name)
+			return 0;
+	}
+
+	return (position < end && !isalnum((unsigned char)*position));
+}
+
+// Called with position at a '<' outside a word when tokenizer skips code.  If it starts
+// a comment, returns the character after the comment's "-->".  If it starts a <script> or
+// <style> element, returns the '<' of its closing tag (which is then read like any other
+// tag).  Otherwise returns position.  Returns end (or a NUL) if the page runs out first.
+static char* skipCodeRegion(char* position, char* end)
+{
+	char* name;
+	char* body;
+
+	if(end - position >= 4 && strncmp(position, "<!--", 4) == 0)
+	{
+		body = position + 4;
+
+		for(position = body; (position = findTagEnd(position, end)) != end && *position != 0; position++)
+		{
+			if(position - body >= 2 && position[-1] == '-' && position[-2] == '-')
+				return position + 1;
+		}
+
+		return position;
+	}
+
+	if(matchTagName(position + 1, end, "script"))
+		name = "script";
+	else if(matchTagName(position + 1, end, "style"))
+		name = "style";
+	else
+		return position;
+
+// past the opening tag, then to the first "</script" or "</style"
+	if((position = findTagEnd(position, end)) == end || *position == 0)
+		return position;
+
+	while((position = findTagStart(position + 1, end)) != end && *position != 0)
+	{
+		if(position + 1 < end && position[1] == '/' && matchTagName(position + 2, end, name))
+			return position;
+	}
+
+	return position;
+}
+
+// Finds the next word after tokenizer's position, the same way parseHTML does: a '<'
+// outside a word starts a tag, a '>' ends one, and a '>' inside a word is skipped
+// (but stays part of the span).  A word still going at the end of the page is dropped.
+// The scans look at many characters at a time (see textscan.h).  If lower isn't NULL,
+// the word is also copied there lower cased (see findWordEnd).
+static int findToken(TOKENIZER* tokenizer, char** word, int* length, char* lower)
+{
+	char* end = tokenizer->html + tokenizer->length;
+	char* position = tokenizer->html + tokenizer->position;
+	char* start;
+
+	while(1)
+	{
+		if(tokenizer->in_tag)
+		{
+			if((position = findTagEnd(position, end)) == end || *position == 0)
+				break;
+
+			tokenizer->in_tag = 0;
+			position++;
+		}
+
+		if((position = findTextStart(position, end)) == end || *position == 0)
+			break;
+
+		if(*position == '<' && tokenizer->skip_code)
+		{
+			start = position;
+
+			if((position = skipCodeRegion(position, end)) == end || *position == 0)
+				break;
+
+// if a region was skipped, look again from after it (a closing tag isn't skipped again)
+			if(position != start)
+				continue;
+		}
+
+		if(*position == '<')
+		{
+			tokenizer->in_tag = 1;
+			position++;
+			continue;
+		}
+
+		start = position;
+
+		if((position = findWordEnd(position, end, lower)) == end || *position == 0)
+			break;
+
+		*word = start;
+		*length = position - start;
+		tokenizer->position = position - tokenizer->html;
+
+		return 1;
+	}
+
+	tokenizer->position = position - tokenizer->html;
+
+	return 0;
+}
+
+int nextToken(TOKENIZER* tokenizer, char** word, int* length)
+{
+	return findToken(tokenizer, word, length, NULL);
+}
+
+// Like nextToken, but *word is a NUL-terminated lower case copy in the scratch area, made
+// while the word is scanned.  The scratch area gets room for the rest of the page.
+int nextLowercaseToken(TOKENIZER* tokenizer, char** word, int* length)
+{
+	long needed = tokenizer->length - tokenizer->position + 33;
+
+	if(needed > tokenizer->scratch_capacity)
+	{
+		tokenizer->scratch_capacity = needed;
+		tokenizer->scratch = realloc(tokenizer->scratch, tokenizer->scratch_capacity);
+
+		if(tokenizer->scratch == NULL)
+		{
+			perror("nextLowercaseToken");
+			exit(-1);
+		}
+	}
+
+	if(!findToken(tokenizer, word, length, tokenizer->scratch))
+		return 0;
+
+	*word = tokenizer->scratch;
+	(*word)[*length] = 0;
+
+	return 1;
+}
+
+// Copies length characters of word into tokenizer's scratch area, lower casing them.
+char* lowercaseToken(TOKENIZER* tokenizer, char* word, int length)
+{
+	if(length + 1 > tokenizer->scratch_capacity)
+	{
+		tokenizer->scratch_capacity = (length + 1) * 2;
+		tokenizer->scratch = realloc(tokenizer->scratch, tokenizer->scratch_capacity);
+
+		if(tokenizer->scratch == NULL)
+		{
+			perror("lowercaseToken");
+			exit(-1);
+		}
+	}
+
+	lowercaseCopy(tokenizer->scratch, word, length);
+	tokenizer->scratch[length] = 0;
+
+	return tokenizer->scratch;
+}
+
+// Frees tokenizer's scratch area.
+void cleanTokenizer(TOKENIZER* tokenizer)
+{
+	free(tokenizer->scratch);
+	tokenizer->scratch = NULL;
+	tokenizer->scratch_capacity = 0;
+}
+
 /*
 
 *NormalizeWord*
@@ -53,6 +53,60 @@ void removeWhiteSpace(char* html);
 
 int parseHTML(char *html_doc, char *resulting_word, int current_position);
 
+// A TOKENIZER walks the words of one crawled page once, giving back each word as a
+// (pointer, length) span into the page instead of copying it.  It finds exactly the
+// words repeated parseHTML calls would (skipping the first two lines and the tags).
+//
+// html:      the page (it isn't changed), which ends at length or its first NUL
+// position:  where the next word is looked for
+// in_tag:    1 if position is inside a tag
+// skip_code: 1 if the bodies of <script> and <style> elements and whole <!-- --> comments
+//            are skipped as well (0 after initializeTokenizer, see skipCode)
+// scratch:   reused by lowercaseToken for words that need lower casing
+typedef struct _TOKENIZER
+{
+	char* html;
+	long length;
+	long position;
+	int in_tag;
+	int skip_code;
+	char* scratch;
+	int scratch_capacity;
+} __TOKENIZER;
+
+typedef struct _TOKENIZER TOKENIZER;
+
+// Usage Example  (count the words of a page)
+// TOKENIZER tokenizer;
+// char* word;
+// int length;
+// initializeTokenizer(&tokenizer, page, page_length);
+// while (nextToken(&tokenizer, &word, &length)) {
+//     /* DO SOMETHING WITH THE length CHARACTERS AT word */
+// }
+// cleanTokenizer(&tokenizer);
+void initializeTokenizer(TOKENIZER* tokenizer, char* html, long length);
+
+// skipCode turns skipping script, style and comment bodies on (1) or off (0).  With it on,
+// the tokenizer no longer finds exactly parseHTML's words: it leaves out the JavaScript,
+// CSS and commented out text parseHTML would have found.
+void skipCode(TOKENIZER* tokenizer, int skip_code);
+
+// nextToken points *word at the next word in the page and sets *length to its length.
+// Returns 1 if it found a word, 0 once the page is done.
+int nextToken(TOKENIZER* tokenizer, char** word, int* length);
+
+// nextLowercaseToken is nextToken, except *word is a NUL-terminated lower case copy of the
+// word, made in the tokenizer's scratch area in the same pass.  It stays valid until the next call.
+int nextLowercaseToken(TOKENIZER* tokenizer, char** word, int* length);
+
+// lowercaseToken returns a NUL-terminated lower case copy of a word (like NormalizeWord),
+// made in the tokenizer's scratch area.  It stays valid until the next call.
+char* lowercaseToken(TOKENIZER* tokenizer, char* word, int length);
+
+// cleanTokenizer frees the tokenizer's scratch area (not the page).
+void cleanTokenizer(TOKENIZER* tokenizer);
+
 int getNextWord(char *string, char *word, int current_position);
 
 #if 0  // CCP - This should be isalpha() from the standard <ctype.h> library!
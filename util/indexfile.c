@@ -0,0 +1,812 @@
+// Contains the functions that read and write index files (see indexfile.h
+// for the formats).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "header.h"
+#include "postings.h"
+#include "dictionary.h"
+#include "indexfile.h"
+
+// a growable output buffer for encoding varints (and formatting text)
+typedef struct _ByteBuffer
+{
+	unsigned char* bytes;
+	long length;
+	long capacity;
+} __ByteBuffer;
+
+typedef struct _ByteBuffer ByteBuffer;
+
+// Makes sure buffer has room for extra more bytes.
+static void reserveBytes(ByteBuffer* buffer, long extra)
+{
+	if(buffer->length + extra <= buffer->capacity)
+		return;
+
+	if(buffer->capacity == 0)
+		buffer->capacity = 4096;
+
+	while(buffer->length + extra > buffer->capacity)
+		buffer->capacity *= 2;
+
+	buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+	MALLOC_CHECK(buffer->bytes);
+}
+
+// Appends value to buffer as a varint.
+static void putVarint(ByteBuffer* buffer, unsigned long value)
+{
+	reserveBytes(buffer, 10);
+
+	while(value >= 0x80)
+	{
+		buffer->bytes[buffer->length++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+
+	buffer->bytes[buffer->length++] = (unsigned char)value;
+}
+
+// Reads a varint at *position (not going past end) into *value and moves *position past it.
+// Returns 0 if it succeeds and 1 if the varint is cut off or too long.
+static inline int getVarint(unsigned char* bytes, long* position, long end, unsigned long* value)
+{
+	unsigned long result = 0;
+	int shift = 0;
+	unsigned char byte;
+
+	do
+	{
+		if(*position >= end || shift > 63)
+			return 1;
+
+		byte = bytes[(*position)++];
+		result |= (unsigned long)(byte & 0x7f) << shift;
+		shift += 7;
+	}
+	while(byte & 0x80);
+
+	*value = result;
+
+	return 0;
+}
+
+// Writes value into text in decimal.  Returns the number of characters written.
+static inline int formatNumber(char* text, int value)
+{
+	char digits[12];
+	unsigned int number = value;
+	int length = 0;
+	int n = 0;
+
+	if(value < 0)
+	{
+		text[length++] = '-';
+		number = -(unsigned int)value;
+	}
+
+	do
+	{
+		digits[n++] = '0' + number % 10;
+		number /= 10;
+	} while(number != 0);
+
+	while(n > 0)
+		text[length++] = digits[--n];
+
+	return length;
+}
+
+// Appends the lines of num_words words (starting at first) to output in the text format.
+static void formatTextLines(WordNode* first, long num_words, ByteBuffer* output)
+{
+	PostingList* postings;
+	char* text;
+
+	for(WordNode* current = first; num_words-- > 0; current = current->next)
+	{
+		postings = current->data;
+
+// room for the key, every number and a space after each, and the newline
+		reserveBytes(output, current->key_length + 13 + postings->num_docs * 24L + 1);
+		text = (char*)output->bytes + output->length;
+
+		memcpy(text, current->key, current->key_length);
+		text += current->key_length;
+		*text++ = ' ';
+		text += formatNumber(text, postings->num_docs);
+		*text++ = ' ';
+
+		for(int i = 0; i < postings->num_docs; i++)
+		{
+			text += formatNumber(text, postings->doc_ids[i]);
+			*text++ = ' ';
+			text += formatNumber(text, postings->frequencies[i]);
+			*text++ = ' ';
+		}
+
+		*text++ = '\n';
+		output->length = text - (char*)output->bytes;
+	}
+}
+
+// a run of consecutive words formatted by one thread of writeTextIndex
+typedef struct _TextShard
+{
+	pthread_t thread;
+	WordNode* first;
+	long num_words;
+	ByteBuffer output;
+} __TextShard;
+
+typedef struct _TextShard TextShard;
+
+// Formats a shard's words (run in its own thread).
+static void* formatTextShard(void* argument)
+{
+	TextShard* shard = argument;
+
+	formatTextLines(shard->first, shard->num_words, &shard->output);
+
+	return NULL;
+}
+
+// Saves index to file_name in the text format, formatting up to num_threads shards of
+// TEXT_SHARD_POSTINGS postings at a time and writing them out in order.
+// Returns 0 if it succeeds and 1 if it fails.
+int writeTextIndex(INVERTED_INDEX* index, char* file_name, int num_threads)
+{
+	FILE* fp;
+	TextShard* shards;
+	WordNode* current;
+	long shard_postings;
+	int num_shards;
+	int failed = 0;
+
+	if((fp = fopen(file_name, "w")) == NULL)
+		return 1;
+
+	if(num_threads < 1)
+		num_threads = 1;
+
+	shards = calloc(num_threads, sizeof(TextShard));
+	MALLOC_CHECK(shards);
+
+	current = index->start;
+
+	while(current != NULL && !failed)
+	{
+// cuts the next words into shards of about TEXT_SHARD_POSTINGS postings
+		for(num_shards = 0; num_shards < num_threads && current != NULL; num_shards++)
+		{
+			shards[num_shards].first = current;
+			shards[num_shards].num_words = 0;
+			shards[num_shards].output.length = 0;
+			shard_postings = 0;
+
+			while(current != NULL && shard_postings < TEXT_SHARD_POSTINGS)
+			{
+				shard_postings += ((PostingList*)current->data)->num_docs + 1;
+				shards[num_shards].num_words++;
+				current = current->next;
+			}
+		}
+
+		if(num_shards == 1)
+			formatTextShard(&shards[0]);
+		else
+		{
+			for(int t = 0; t < num_shards; t++)
+			{
+				if(pthread_create(&shards[t].thread, NULL, formatTextShard, &shards[t]) != 0)
+				{
+					fprintf(stderr, "Could not create thread\n");
+					exit(-1);
+				}
+			}
+
+			for(int t = 0; t < num_shards; t++)
+				pthread_join(shards[t].thread, NULL);
+		}
+
+		for(int t = 0; t < num_shards && !failed; t++)
+			failed = (fwrite(shards[t].output.bytes, 1, shards[t].output.length, fp) != shards[t].output.length);
+	}
+
+	for(int t = 0; t < num_threads; t++)
+		free(shards[t].output.bytes);
+
+	free(shards);
+
+	failed |= ferror(fp);
+
+	return (fclose(fp) != 0 || failed);
+}
+
+// Orders WordNode pointers by key, for qsort.
+static int compareWordKeys(const void* a, const void* b)
+{
+	return strcmp((*(WordNode* const*)a)->key, (*(WordNode* const*)b)->key);
+}
+
+// Saves index to file_name in the binary format.  Returns 0 if it succeeds and 1 if it fails.
+int writeBinaryIndex(INVERTED_INDEX* index, char* file_name)
+{
+	FILE* fp;
+	ByteBuffer header = { NULL, 0, 0 };
+	ByteBuffer lexicon = { NULL, 0, 0 };
+	ByteBuffer postings_bytes = { NULL, 0, 0 };
+	WordNode** words;
+	WordNode* current;
+	WordNode* before = NULL;
+	PostingList* postings;
+	unsigned int previous;
+	long start;
+	int shared;
+	int num_words = 0;
+	int failed;
+
+// the words are written sorted, so each key only stores what it doesn't share with the one before
+	words = malloc((index->num_entries + 1) * sizeof(WordNode*));
+	MALLOC_CHECK(words);
+
+	for(current = index->start; current != NULL; current = current->next)
+		words[num_words++] = current;
+
+	qsort(words, num_words, sizeof(WordNode*), compareWordKeys);
+
+	for(int w = 0; w < num_words; w++)
+	{
+		current = words[w];
+		postings = current->data;
+		start = postings_bytes.length;
+		previous = 0;
+
+		for(int i = 0; i < postings->num_docs; i++)
+		{
+			unsigned long delta = (unsigned int)postings->doc_ids[i] - previous;
+
+			if(postings->frequencies[i] == 1)
+				putVarint(&postings_bytes, delta * 2 + 1);
+			else
+			{
+				putVarint(&postings_bytes, delta * 2);
+				putVarint(&postings_bytes, (unsigned long)(postings->frequencies[i] - 2));
+			}
+
+			previous = (unsigned int)postings->doc_ids[i];
+		}
+
+		shared = 0;
+
+		if(before != NULL)
+			while(shared < before->key_length && current->key[shared] == before->key[shared])
+				shared++;
+
+		putVarint(&lexicon, shared);
+		putVarint(&lexicon, current->key_length - shared);
+		reserveBytes(&lexicon, current->key_length - shared);
+		memcpy(lexicon.bytes + lexicon.length, current->key + shared, current->key_length - shared);
+		lexicon.length += current->key_length - shared;
+		putVarint(&lexicon, postings->num_docs);
+		putVarint(&lexicon, postings_bytes.length - start);
+		before = current;
+	}
+
+	free(words);
+
+	reserveBytes(&header, 4);
+	memcpy(header.bytes, BINARY_INDEX_MAGIC, 4);
+	header.length = 4;
+	putVarint(&header, BINARY_INDEX_VERSION);
+	putVarint(&header, index->num_entries);
+	putVarint(&header, lexicon.length);
+	putVarint(&header, postings_bytes.length);
+
+	if((fp = fopen(file_name, "wb")) == NULL)
+		failed = 1;
+	else
+	{
+		failed = (fwrite(header.bytes, 1, header.length, fp) != header.length);
+		failed |= (fwrite(lexicon.bytes, 1, lexicon.length, fp) != lexicon.length);
+		failed |= (fwrite(postings_bytes.bytes, 1, postings_bytes.length, fp) != postings_bytes.length);
+		failed |= (fclose(fp) != 0);
+	}
+
+	free(header.bytes);
+	free(lexicon.bytes);
+	free(postings_bytes.bytes);
+
+	return failed;
+}
+
+// Returns 1 if file_name starts with the binary index magic number, 0 if not.
+int isBinaryIndex(char* file_name)
+{
+	FILE* fp;
+	char magic[4];
+	int binary;
+
+	if((fp = fopen(file_name, "rb")) == NULL)
+		return 0;
+
+	binary = (fread(magic, 1, 4, fp) == 4 && memcmp(magic, BINARY_INDEX_MAGIC, 4) == 0);
+	fclose(fp);
+
+	return binary;
+}
+
+// Reads all of file_name into a malloced buffer, storing its size in *length.
+// Returns NULL if it can't be read.
+static unsigned char* readWholeFile(char* file_name, long* length)
+{
+	FILE* fp;
+	unsigned char* bytes;
+
+	if((fp = fopen(file_name, "rb")) == NULL)
+		return NULL;
+
+	if(fseek(fp, 0, SEEK_END) != 0 || (*length = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	bytes = malloc(*length + 1);
+	MALLOC_CHECK(bytes);
+
+	if(fread(bytes, 1, *length, fp) != *length)
+	{
+		free(bytes);
+		bytes = NULL;
+	}
+
+	fclose(fp);
+
+	return bytes;
+}
+
+// Reads a binary index file into a new index.  Returns NULL if the file can't be
+// read or isn't a valid binary index.
+INVERTED_INDEX* readBinaryIndex(char* file_name)
+{
+	INVERTED_INDEX* index;
+	PostingList* postings;
+	unsigned char* bytes;
+	long length;
+	long position = 4;
+	long lexicon_end;
+	long postings_position;
+	long term_start;
+	unsigned long version, num_words, lexicon_length, postings_length;
+	unsigned long shared, suffix_length, num_docs, term_postings_length, value, frequency;
+	unsigned long key_length = 0;
+	unsigned int doc_id;
+	char* key = NULL;
+	int bad = 0;
+
+	if((bytes = readWholeFile(file_name, &length)) == NULL)
+		return NULL;
+
+	if(length < 4 || memcmp(bytes, BINARY_INDEX_MAGIC, 4) != 0
+		|| getVarint(bytes, &position, length, &version) || version != BINARY_INDEX_VERSION
+		|| getVarint(bytes, &position, length, &num_words)
+		|| getVarint(bytes, &position, length, &lexicon_length)
+		|| getVarint(bytes, &position, length, &postings_length)
+		|| lexicon_length > (unsigned long)(length - position)
+		|| postings_length != (unsigned long)(length - position) - lexicon_length
+		|| num_words > lexicon_length)
+	{
+		free(bytes);
+		return NULL;
+	}
+
+	lexicon_end = position + lexicon_length;
+	postings_position = lexicon_end;
+// num_words is known, so the dictionary is made big enough for all of them and never rehashes
+	index = initializeSizedDict((int)num_words);
+
+	for(unsigned long w = 0; w < num_words && !bad; w++)
+	{
+// the key is the first shared bytes of the one before, followed by suffix_length bytes of its own
+		if(getVarint(bytes, &position, lexicon_end, &shared) || shared > key_length
+			|| getVarint(bytes, &position, lexicon_end, &suffix_length) || suffix_length > (unsigned long)(lexicon_end - position))
+		{
+			bad = 1;
+			break;
+		}
+
+		key_length = shared + suffix_length;
+		key = realloc(key, key_length + 1);
+		MALLOC_CHECK(key);
+		memcpy(key + shared, bytes + position, suffix_length);
+		key[key_length] = 0;
+		position += suffix_length;
+
+		if(getVarint(bytes, &position, lexicon_end, &num_docs) || getVarint(bytes, &position, lexicon_end, &term_postings_length)
+			|| term_postings_length > (unsigned long)(length - postings_position) || num_docs > term_postings_length)
+		{
+			bad = 1;
+			break;
+		}
+
+// the arrays are allocated with room for every posting, so they're filled in directly
+		postings = initializePostings((int)num_docs);
+		term_start = postings_position;
+		doc_id = 0;
+
+		for(unsigned long i = 0; i < num_docs; i++)
+		{
+			if(getVarint(bytes, &postings_position, length, &value))
+			{
+				bad = 1;
+				break;
+			}
+
+			frequency = 1;
+
+			if(!(value & 1))
+			{
+				if(getVarint(bytes, &postings_position, length, &frequency))
+				{
+					bad = 1;
+					break;
+				}
+
+				frequency += 2;
+			}
+
+			doc_id += (unsigned int)(value >> 1);
+			postings->doc_ids[i] = (int)doc_id;
+			postings->frequencies[i] = (int)frequency;
+			postings->num_docs++;
+		}
+
+		if(bad || postings_position - term_start != term_postings_length || addData(index, postings, key) != 0)
+		{
+			cleanPostings(postings);
+			bad = 1;
+		}
+	}
+
+	free(key);
+	free(bytes);
+
+	if(bad)
+	{
+		fprintf(stderr, "Bad binary index file %s\n", file_name);
+		cleanIndex(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+// one line of a text index, parsed by a TextChunk's thread
+// key_offset is where the line's key starts in the chunk's keys
+typedef struct _TextLine
+{
+	long key_offset;
+	PostingList* postings;
+} __TextLine;
+
+typedef struct _TextLine TextLine;
+
+// the whole lines between start and end, which one thread parses into lines (holding
+// num_lines lines) and keys (every key, NUL-terminated).  bad is set if a line is broken.
+typedef struct _TextChunk
+{
+	pthread_t thread;
+	char* start;
+	char* end;
+	TextLine* lines;
+	int num_lines;
+	int lines_capacity;
+	char* keys;
+	long keys_length;
+	long keys_capacity;
+	int bad;
+} __TextChunk;
+
+typedef struct _TextChunk TextChunk;
+
+// Returns 1 if c separates the words and numbers of a text index.
+static inline int isIndexSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// Reads the number after *position (skipping spaces, not going past end) into *value.
+// Returns a pointer just past it, or NULL if there isn't a number there.
+static inline char* parseNumber(char* position, char* end, int* value)
+{
+	unsigned long number;
+	unsigned int digit;
+
+	while(position < end && isIndexSpace(*position))
+		position++;
+
+	if(position == end || (digit = (unsigned char)*position - '0') > 9)
+		return NULL;
+
+	number = digit;
+
+	while(++position < end && (digit = (unsigned char)*position - '0') <= 9)
+	{
+		number = number * 10 + digit;
+
+		if(number > INT_MAX)
+			return NULL;
+	}
+
+	if(position < end && !isIndexSpace(*position))
+		return NULL;
+
+	*value = (int)number;
+
+	return position;
+}
+
+// Parses the line at position (not going past end): its key is stored in *key and *key_length
+// (pointing into the line), and its postings in a new PostingList *postings.  Returns a pointer
+// just past the line, or NULL if the line is broken.  *postings is NULL if there were no more lines.
+static char* parseTextLine(char* position, char* end, char** key, int* key_length, PostingList** postings)
+{
+	int num_docs;
+	int* doc_ids;
+	int* frequencies;
+
+	*postings = NULL;
+
+	while(position < end && isIndexSpace(*position))
+		position++;
+
+	if(position == end)
+		return position;
+
+	*key = position;
+
+	while(position < end && !isIndexSpace(*position))
+		position++;
+
+	*key_length = position - *key;
+
+// every posting takes at least 4 characters ("1 1 "), which stops a broken count from
+// allocating too much
+	if((position = parseNumber(position, end, &num_docs)) == NULL || num_docs > (end - position) / 4 + 1)
+		return NULL;
+
+	*postings = initializePostings(num_docs);
+	doc_ids = (*postings)->doc_ids;
+	frequencies = (*postings)->frequencies;
+
+	for(int i = 0; i < num_docs; i++)
+	{
+		if((position = parseNumber(position, end, &doc_ids[i])) == NULL
+			|| (position = parseNumber(position, end, &frequencies[i])) == NULL)
+		{
+			cleanPostings(*postings);
+			*postings = NULL;
+			return NULL;
+		}
+	}
+
+	(*postings)->num_docs = num_docs;
+
+// older index files list documents in file name (not numeric) order
+	sortPostings(*postings);
+
+	return position;
+}
+
+// Adds a word and its parsed postings to index.  If the word is already there (which
+// only happens in hand-edited files), the postings are added to its PostingList.
+static void addTextLine(INVERTED_INDEX* index, char* key, PostingList* postings)
+{
+	PostingList* existing;
+
+	if(addData(index, postings, key) == 0)
+		return;
+
+	existing = getData(index, key)->data;
+
+	for(int i = 0; i < postings->num_docs; i++)
+		appendPosting(existing, postings->doc_ids[i], postings->frequencies[i]);
+
+	sortPostings(existing);
+	cleanPostings(postings);
+}
+
+// Parses the lines of a chunk (run in its own thread).
+static void* parseTextChunk(void* argument)
+{
+	TextChunk* chunk = argument;
+	char* position = chunk->start;
+	char* key;
+	int key_length;
+	PostingList* postings;
+
+	while((position = parseTextLine(position, chunk->end, &key, &key_length, &postings)) != NULL && postings != NULL)
+	{
+		if(chunk->num_lines == chunk->lines_capacity)
+		{
+			chunk->lines_capacity = chunk->lines_capacity ? chunk->lines_capacity * 2 : 1024;
+			chunk->lines = realloc(chunk->lines, chunk->lines_capacity * sizeof(TextLine));
+			MALLOC_CHECK(chunk->lines);
+		}
+
+		while(chunk->keys_length + key_length + 1 > chunk->keys_capacity)
+		{
+			chunk->keys_capacity = chunk->keys_capacity ? chunk->keys_capacity * 2 : 16384;
+			chunk->keys = realloc(chunk->keys, chunk->keys_capacity);
+			MALLOC_CHECK(chunk->keys);
+		}
+
+		chunk->lines[chunk->num_lines].key_offset = chunk->keys_length;
+		chunk->lines[chunk->num_lines++].postings = postings;
+		memcpy(chunk->keys + chunk->keys_length, key, key_length);
+		chunk->keys_length += key_length;
+		chunk->keys[chunk->keys_length++] = 0;
+	}
+
+	chunk->bad = (position == NULL);
+
+	return NULL;
+}
+
+// Parses the text index in contents (length bytes) into index, splitting it into up to
+// num_threads chunks at line boundaries that are parsed at the same time.  The lines are
+// added to index in file order once every chunk is parsed.  Returns 0 if it succeeds
+// and 1 if a line is broken.
+static int parseTextChunks(char* contents, long length, int num_threads, INVERTED_INDEX* index)
+{
+	TextChunk* chunks;
+	char* start = contents;
+	char* end;
+	int bad = 0;
+
+	chunks = calloc(num_threads, sizeof(TextChunk));
+	MALLOC_CHECK(chunks);
+
+	for(int t = 0; t < num_threads; t++)
+	{
+// each chunk ends at the first line boundary past its share of the file
+		end = (t == num_threads - 1) ? contents + length : contents + length / num_threads * (t + 1);
+
+		if(end < start)
+			end = start;
+
+		while(end < contents + length && end > contents && end[-1] != '\n')
+			end++;
+
+		chunks[t].start = start;
+		chunks[t].end = end;
+		start = end;
+
+		if(pthread_create(&chunks[t].thread, NULL, parseTextChunk, &chunks[t]) != 0)
+		{
+			fprintf(stderr, "Could not create thread\n");
+			exit(-1);
+		}
+	}
+
+	for(int t = 0; t < num_threads; t++)
+	{
+		pthread_join(chunks[t].thread, NULL);
+		bad |= chunks[t].bad;
+	}
+
+	for(int t = 0; t < num_threads; t++)
+	{
+		for(int l = 0; l < chunks[t].num_lines; l++)
+		{
+			if(bad)
+				cleanPostings(chunks[t].lines[l].postings);
+			else
+				addTextLine(index, chunks[t].keys + chunks[t].lines[l].key_offset, chunks[t].lines[l].postings);
+		}
+
+		free(chunks[t].lines);
+		free(chunks[t].keys);
+	}
+
+	free(chunks);
+
+	return bad;
+}
+
+// Reads a text index file into a new index, parsing it with num_threads threads.  Returns
+// NULL if the file can't be read or has a broken line.
+INVERTED_INDEX* readTextIndex(char* file_name, int num_threads)
+{
+	INVERTED_INDEX* index;
+	struct stat file_stat;
+	char* contents;
+	char* position;
+	char* line_key;
+	char* key = NULL;
+	int key_length;
+	int key_capacity = 0;
+	PostingList* postings;
+	long length;
+	int mapped;
+	int fd;
+	int bad = 0;
+
+	if((fd = open(file_name, O_RDONLY)) == -1)
+		return NULL;
+
+// the file is mapped if it can be, and read in one go if it can't
+	if(fstat(fd, &file_stat) == 0 && (length = file_stat.st_size) > 0
+		&& (contents = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+	{
+		mapped = 1;
+		posix_madvise(contents, length, POSIX_MADV_SEQUENTIAL);
+	}
+	else if((contents = (char*)readWholeFile(file_name, &length)) != NULL)
+		mapped = 0;
+	else
+	{
+		close(fd);
+		return NULL;
+	}
+
+	close(fd);
+	index = initializeDict();
+
+	if(num_threads > MAX_READ_THREADS)
+		num_threads = MAX_READ_THREADS;
+
+	if(num_threads > 1)
+		bad = parseTextChunks(contents, length, num_threads, index);
+	else
+	{
+		position = contents;
+
+// one line at a time straight into the index, copying each key to add a NUL
+		while((position = parseTextLine(position, contents + length, &line_key, &key_length, &postings)) != NULL && postings != NULL)
+		{
+			if(key_length + 1 > key_capacity)
+			{
+				key_capacity = (key_length + 1) * 2;
+				key = realloc(key, key_capacity);
+				MALLOC_CHECK(key);
+			}
+
+			memcpy(key, line_key, key_length);
+			key[key_length] = 0;
+			addTextLine(index, key, postings);
+		}
+
+		bad = (position == NULL);
+	}
+
+	free(key);
+
+	if(mapped)
+		munmap(contents, length);
+	else
+		free(contents);
+
+	if(bad)
+	{
+		fprintf(stderr, "Bad text index file %s\n", file_name);
+		cleanIndex(index);
+		return NULL;
+	}
+
+	return index;
+}
@@ -0,0 +1,58 @@
+#ifndef _INDEXFILE_H_
+#define _INDEXFILE_H_
+
+// Reading and writing index files.
+//
+// TEXT FORMAT: one line per word, "computer 2 1 6 7 10 \n" meaning "computer"
+// occured in 2 documents, 6 times in document 1 and 10 times in document 7.
+//
+// BINARY FORMAT (version 2): all numbers are varints (7 bits per byte, low bits
+// first, high bit set on every byte but the last).
+//
+//	"TSEB"					magic number (4 bytes)
+//	version, num_words, lexicon_length, postings_length
+//	lexicon (lexicon_length bytes), for each word in key (strcmp) order:
+//		shared, suffix_length, suffix (suffix_length bytes), num_docs, length of its postings in bytes
+//		(the key is the first shared bytes of the word before's key, then the suffix)
+//	postings (postings_length bytes), for each word in the same order, for each document:
+//		(doc_id - previous doc_id) * 2 + 1		if the frequency is 1
+//		(doc_id - previous doc_id) * 2, frequency - 2	otherwise
+//	(previous doc_id starts at 0 for every word)
+//
+// A binary index is read back with its words in key order, not the order they were added in.
+
+#define BINARY_INDEX_MAGIC "TSEB"
+#define BINARY_INDEX_VERSION 2
+
+// readTextIndex won't use more threads than this
+#define MAX_READ_THREADS 64
+
+// writeTextIndex formats runs of about this many postings at a time
+#define TEXT_SHARD_POSTINGS 65536
+
+#include "dictionary.h"
+
+// writeTextIndex saves index to file_name in the text format.  The lines are formatted
+// by hand in large buffers; with num_threads > 1, runs of words are formatted in that many
+// threads at once and written out in order, so the file is the same either way.
+// Returns 0 if it succeeds and 1 if it fails.
+int writeTextIndex(INVERTED_INDEX* index, char* file_name, int num_threads);
+
+// writeBinaryIndex saves index to file_name in the binary format.
+// Returns 0 if it succeeds and 1 if it fails.
+int writeBinaryIndex(INVERTED_INDEX* index, char* file_name);
+
+// readTextIndex reads a text index file into a new index.  The file is mapped (or read in
+// one go) and parsed by hand; with num_threads > 1 it's split into that many chunks at line
+// boundaries which are parsed at the same time.
+// Returns NULL if the file can't be read or has a broken line.
+INVERTED_INDEX* readTextIndex(char* file_name, int num_threads);
+
+// readBinaryIndex reads a binary index file into a new index.
+// Returns NULL if the file can't be read or isn't a valid binary index.
+INVERTED_INDEX* readBinaryIndex(char* file_name);
+
+// isBinaryIndex returns 1 if file_name starts with the binary index magic number, 0 if not.
+int isBinaryIndex(char* file_name);
+
+#endif
@@ -0,0 +1,442 @@
+// Reads a list of files ahead of the indexer, with io_uring or a pool of reader
+// threads (see ingest.h).
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "header.h"
+#include "file.h"
+#include "ingest.h"
+
+// the most bytes asked for in one read (a read's length is 32 bits)
+#define INGEST_MAX_READ (1L << 30)
+
+// -----------------
+// ---- IO_URING ----
+// -----------------
+
+// Sets up an io_uring with room for every slot's request, and checks the kernel can open and
+// read files through it.  Returns 0 if it succeeds, 1 if the thread pool has to be used.
+static int setupRing(INGEST* ingest)
+{
+	struct io_uring_params params;
+	struct io_uring_probe* probe;
+	int probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+	int supported;
+
+	BZERO(&params, sizeof(params));
+
+	if((ingest->ring_fd = syscall(__NR_io_uring_setup, ingest->queue_depth, &params)) < 0)
+	{
+		ingest->ring_fd = -1;
+		return 1;
+	}
+
+// IORING_OP_OPENAT and IORING_OP_READ are newer than io_uring itself
+	probe = malloc(probe_size);
+	MALLOC_CHECK(probe);
+	BZERO(probe, probe_size);
+
+	supported = (syscall(__NR_io_uring_register, ingest->ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+		probe->last_op >= IORING_OP_READ && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+		(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED));
+	free(probe);
+
+	ingest->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	ingest->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ingest->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(ingest->cq_ring_size > ingest->sq_ring_size)
+			ingest->sq_ring_size = ingest->cq_ring_size;
+
+		ingest->cq_ring_size = 0;
+	}
+
+	ingest->sq_ring = mmap(NULL, ingest->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ingest->ring_fd, IORING_OFF_SQ_RING);
+	ingest->cq_ring = (ingest->cq_ring_size == 0) ? ingest->sq_ring :
+		mmap(NULL, ingest->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ingest->ring_fd, IORING_OFF_CQ_RING);
+	ingest->sqes = mmap(NULL, ingest->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ingest->ring_fd, IORING_OFF_SQES);
+
+	if(!supported || ingest->sq_ring == MAP_FAILED || ingest->cq_ring == MAP_FAILED || ingest->sqes == MAP_FAILED)
+	{
+		if(ingest->sq_ring != MAP_FAILED)
+			munmap(ingest->sq_ring, ingest->sq_ring_size);
+
+		if(ingest->cq_ring_size != 0 && ingest->cq_ring != MAP_FAILED)
+			munmap(ingest->cq_ring, ingest->cq_ring_size);
+
+		if(ingest->sqes != MAP_FAILED)
+			munmap(ingest->sqes, ingest->sqes_size);
+
+		close(ingest->ring_fd);
+		ingest->ring_fd = -1;
+
+		return 1;
+	}
+
+	ingest->sq_head = (unsigned int*)((char*)ingest->sq_ring + params.sq_off.head);
+	ingest->sq_tail = (unsigned int*)((char*)ingest->sq_ring + params.sq_off.tail);
+	ingest->sq_mask = (unsigned int*)((char*)ingest->sq_ring + params.sq_off.ring_mask);
+	ingest->sq_array = (unsigned int*)((char*)ingest->sq_ring + params.sq_off.array);
+	ingest->cq_head = (unsigned int*)((char*)ingest->cq_ring + params.cq_off.head);
+	ingest->cq_tail = (unsigned int*)((char*)ingest->cq_ring + params.cq_off.tail);
+	ingest->cq_mask = (unsigned int*)((char*)ingest->cq_ring + params.cq_off.ring_mask);
+	ingest->cqes = (char*)ingest->cq_ring + params.cq_off.cqes;
+
+	return 0;
+}
+
+static void cleanRing(INGEST* ingest)
+{
+	munmap(ingest->sqes, ingest->sqes_size);
+
+	if(ingest->cq_ring_size != 0)
+		munmap(ingest->cq_ring, ingest->cq_ring_size);
+
+	munmap(ingest->sq_ring, ingest->sq_ring_size);
+	close(ingest->ring_fd);
+}
+
+// Adds a request for slot to the submission queue (it's sent with the next submitRequests).
+// There's never more than one request per slot, so the queue can't fill up.
+static void queueRequest(INGEST* ingest, int opcode, int slot, int fd, void* address, unsigned int length, long offset)
+{
+	unsigned int tail = *(ingest->sq_tail);
+	unsigned int index = tail & *(ingest->sq_mask);
+	struct io_uring_sqe* sqe = (struct io_uring_sqe*)ingest->sqes + index;
+
+	BZERO(sqe, sizeof(struct io_uring_sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long)address;
+	sqe->len = length;
+	sqe->off = offset;
+	sqe->user_data = slot;
+
+	if(opcode == IORING_OP_OPENAT)
+		sqe->open_flags = O_RDONLY;
+
+	ingest->sq_array[index] = index;
+	__atomic_store_n(ingest->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	ingest->queued++;
+	ingest->in_flight++;
+}
+
+// Asks for the rest of slot's file (or the first INGEST_MAX_READ bytes of it).
+static void queueRead(INGEST* ingest, INGEST_SLOT* slot)
+{
+	long length = slot->size - slot->done;
+
+	if(length > INGEST_MAX_READ)
+		length = INGEST_MAX_READ;
+
+	queueRequest(ingest, IORING_OP_READ, slot - ingest->slots, slot->fd, slot->document.buffer + slot->done, length, slot->done);
+}
+
+// Moves slot along once its open (slot->fd is -1) or read returns result: an opened regular
+// file gets its first read, a read that didn't get the whole file gets another one, and a
+// file that's been read completely, or can't be, is done.  When ingest is stopping, the slot
+// is just closed.
+static void completeRequest(INGEST* ingest, INGEST_SLOT* slot, int result)
+{
+	struct stat s;
+
+	if(slot->fd == -1)
+	{
+		if(result < 0)
+		{
+			slot->state = SLOT_SKIPPED;
+			return;
+		}
+
+		slot->fd = result;
+
+		if(ingest->stop || fstat(slot->fd, &s) != 0 || !S_ISREG(s.st_mode))
+		{
+			close(slot->fd);
+			slot->state = SLOT_SKIPPED;
+			return;
+		}
+
+		slot->size = s.st_size;
+		slot->done = 0;
+		fillDocument(&(slot->document), slot->size);
+	}
+	else
+	{
+// a file that came up short is skipped, like readFile does
+		if(result <= 0 || ingest->stop)
+		{
+			close(slot->fd);
+			slot->state = SLOT_SKIPPED;
+			return;
+		}
+
+		slot->done += result;
+	}
+
+	if(slot->done < slot->size)
+	{
+		queueRead(ingest, slot);
+		return;
+	}
+
+	close(slot->fd);
+	slot->state = SLOT_READY;
+}
+
+// Submits the queued requests and waits for at least min_complete of them to finish,
+// then moves along the slot of every request that finished.
+static void submitRequests(INGEST* ingest, int min_complete)
+{
+	struct io_uring_cqe* cqe;
+	unsigned int head;
+
+	while(syscall(__NR_io_uring_enter, ingest->ring_fd, ingest->queued, min_complete, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+	{
+		if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			perror("io_uring_enter");
+			exit(-1);
+		}
+	}
+
+	ingest->queued = 0;
+
+	for(head = *(ingest->cq_head); head != __atomic_load_n(ingest->cq_tail, __ATOMIC_ACQUIRE); head++)
+	{
+		cqe = (struct io_uring_cqe*)ingest->cqes + (head & *(ingest->cq_mask));
+		ingest->in_flight--;
+		completeRequest(ingest, ingest->slots + cqe->user_data, cqe->res);
+	}
+
+	__atomic_store_n(ingest->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Starts opening every file that fits in the queue.
+static void queueOpens(INGEST* ingest)
+{
+	INGEST_SLOT* slot;
+
+	while(ingest->next_submit < ingest->num_files && ingest->next_submit < ingest->next_file + ingest->queue_depth)
+	{
+		slot = ingest->slots + ingest->next_submit % ingest->queue_depth;
+		slot->file = ingest->next_submit++;
+		slot->state = SLOT_READING;
+		slot->fd = -1;
+
+		queueRequest(ingest, IORING_OP_OPENAT, slot - ingest->slots, AT_FDCWD, ingest->files[slot->file]->d_name, 0, 0);
+	}
+}
+
+// Waits until next_file's slot is done.
+static void waitRing(INGEST* ingest, INGEST_SLOT* slot)
+{
+	queueOpens(ingest);
+
+	while(slot->state == SLOT_READING)
+		submitRequests(ingest, 1);
+
+// submits what the completions queued without waiting, so it's read while the caller works
+	if(ingest->queued > 0)
+		submitRequests(ingest, 0);
+}
+
+// --------------------
+// ---- THREAD POOL ----
+// --------------------
+
+// Reads files (with openDocument) until there are none left or ingest is stopping.  A reader only
+// takes a file whose slot has been given back.
+static void* readFiles(void* arg)
+{
+	INGEST* ingest = arg;
+	INGEST_SLOT* slot;
+	int failed;
+
+	pthread_mutex_lock(&(ingest->lock));
+
+	while(1)
+	{
+		while(!ingest->stop && ingest->next_submit < ingest->num_files && ingest->next_submit >= ingest->next_file + ingest->queue_depth)
+			pthread_cond_wait(&(ingest->changed), &(ingest->lock));
+
+		if(ingest->stop || ingest->next_submit >= ingest->num_files)
+			break;
+
+		slot = ingest->slots + ingest->next_submit % ingest->queue_depth;
+		slot->file = ingest->next_submit++;
+		slot->state = SLOT_READING;
+
+		pthread_mutex_unlock(&(ingest->lock));
+		failed = openDocument(&(slot->document), ingest->files[slot->file]->d_name);
+		pthread_mutex_lock(&(ingest->lock));
+
+		slot->state = failed ? SLOT_SKIPPED : SLOT_READY;
+		pthread_cond_broadcast(&(ingest->changed));
+	}
+
+	pthread_mutex_unlock(&(ingest->lock));
+
+	return NULL;
+}
+
+// Waits until next_file's slot is done (called with the lock held).
+static void waitThreads(INGEST* ingest, INGEST_SLOT* slot)
+{
+	while(slot->file != ingest->next_file || slot->state == SLOT_FREE || slot->state == SLOT_READING)
+		pthread_cond_wait(&(ingest->changed), &(ingest->lock));
+}
+
+// ----------------
+// ---- INGEST ----
+// ----------------
+
+INGEST* startIngest(struct dirent** files, int num_files, int queue_depth, int method)
+{
+	INGEST* ingest = malloc(sizeof(INGEST));
+
+	MALLOC_CHECK(ingest);
+	BZERO(ingest, sizeof(INGEST));
+
+	ingest->files = files;
+	ingest->num_files = num_files;
+	ingest->queue_depth = (queue_depth > 0) ? queue_depth : 1;
+	ingest->ring_fd = -1;
+
+	ingest->slots = malloc(ingest->queue_depth * sizeof(INGEST_SLOT));
+	MALLOC_CHECK(ingest->slots);
+
+	for(int i = 0; i < ingest->queue_depth; i++)
+	{
+		ingest->slots[i].file = -1;
+		ingest->slots[i].state = SLOT_FREE;
+		ingest->slots[i].fd = -1;
+		initializeDocument(&(ingest->slots[i].document));
+	}
+
+	if(method == INGEST_IO_URING && setupRing(ingest) == 0)
+	{
+		ingest->method = INGEST_IO_URING;
+		return ingest;
+	}
+
+	ingest->method = INGEST_THREAD_POOL;
+	pthread_mutex_init(&(ingest->lock), NULL);
+	pthread_cond_init(&(ingest->changed), NULL);
+
+	ingest->num_threads = (ingest->queue_depth < INGEST_THREADS) ? ingest->queue_depth : INGEST_THREADS;
+	ingest->threads = malloc(ingest->num_threads * sizeof(pthread_t));
+	MALLOC_CHECK(ingest->threads);
+
+	for(int t = 0; t < ingest->num_threads; t++)
+	{
+		if(pthread_create(ingest->threads + t, NULL, readFiles, ingest) != 0)
+		{
+			perror("startIngest");
+			exit(-1);
+		}
+	}
+
+	return ingest;
+}
+
+// The DOCUMENT handed out last is given back first, which lets its slot take the next file.
+DOCUMENT* nextIngested(INGEST* ingest, int* file)
+{
+	INGEST_SLOT* slot;
+
+	if(ingest->method == INGEST_THREAD_POOL)
+		pthread_mutex_lock(&(ingest->lock));
+
+	if(ingest->handed_out)
+	{
+		slot = ingest->slots + ingest->next_file % ingest->queue_depth;
+		closeDocument(&(slot->document));
+		slot->state = SLOT_FREE;
+		ingest->handed_out = 0;
+		ingest->next_file++;
+	}
+
+	while(ingest->next_file < ingest->num_files)
+	{
+		slot = ingest->slots + ingest->next_file % ingest->queue_depth;
+
+		if(ingest->method == INGEST_IO_URING)
+			waitRing(ingest, slot);
+		else
+		{
+			pthread_cond_broadcast(&(ingest->changed));
+			waitThreads(ingest, slot);
+		}
+
+		if(slot->state == SLOT_READY)
+		{
+			ingest->handed_out = 1;
+			*file = ingest->next_file;
+
+			if(ingest->method == INGEST_THREAD_POOL)
+				pthread_mutex_unlock(&(ingest->lock));
+
+			return &(slot->document);
+		}
+
+		slot->state = SLOT_FREE;
+		ingest->next_file++;
+	}
+
+	if(ingest->method == INGEST_THREAD_POOL)
+		pthread_mutex_unlock(&(ingest->lock));
+
+	return NULL;
+}
+
+void finishIngest(INGEST* ingest)
+{
+	if(ingest->method == INGEST_IO_URING)
+	{
+// the buffers can't be freed while the kernel might still be reading into them
+		ingest->stop = 1;
+
+		while(ingest->in_flight > 0)
+			submitRequests(ingest, 1);
+
+		cleanRing(ingest);
+	}
+	else
+	{
+		pthread_mutex_lock(&(ingest->lock));
+		ingest->stop = 1;
+		pthread_cond_broadcast(&(ingest->changed));
+		pthread_mutex_unlock(&(ingest->lock));
+
+		for(int t = 0; t < ingest->num_threads; t++)
+			pthread_join(ingest->threads[t], NULL);
+
+		free(ingest->threads);
+		pthread_mutex_destroy(&(ingest->lock));
+		pthread_cond_destroy(&(ingest->changed));
+	}
+
+	for(int i = 0; i < ingest->queue_depth; i++)
+		cleanDocument(&(ingest->slots[i].document));
+
+	free(ingest->slots);
+	free(ingest);
+}
@@ -0,0 +1,115 @@
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+// An INGEST reads a list of files ahead of whoever is using them, keeping up to
+// queue_depth of them being opened and read at once, so a crawl on a cold disk
+// is read as fast as the disk can go rather than one file's latency at a time.
+// The files are still handed out one at a time, in the order they're listed.
+//
+// The reads go through io_uring when the kernel has it (set up with the raw
+// system calls, see io_uring_setup(2)), and through a pool of reader threads
+// doing ordinary blocking reads when it doesn't.
+
+#include <pthread.h>
+#include <dirent.h>
+
+#include "file.h"
+
+// files kept in flight by the indexer
+#define INGEST_QUEUE_DEPTH 64
+
+// the most reader threads the fallback uses (fewer if the queue is shorter)
+#define INGEST_THREADS 16
+
+// how the files are read
+#define INGEST_IO_URING 0
+#define INGEST_THREAD_POOL 1
+
+// the states of a slot
+#define SLOT_FREE 0
+#define SLOT_READING 1
+#define SLOT_READY 2
+#define SLOT_SKIPPED 3
+
+// one file in flight: file is its position in the list, document holds its contents once
+// it's SLOT_READY (read into the document's buffer with io_uring, see openDocument otherwise)
+// fd, size and done are the io_uring read's open file, the file's size and the bytes read so far
+typedef struct _INGEST_SLOT
+{
+	int file;
+	int state;
+	DOCUMENT document;
+	int fd;
+	long size;
+	long done;
+} __INGEST_SLOT;
+
+typedef struct _INGEST_SLOT INGEST_SLOT;
+
+// files and num_files are the list, file i goes in slot i % queue_depth
+// next_file is the next file to be handed out, next_submit the next one to start reading
+// handed_out is 1 while next_file's DOCUMENT is with the caller
+// ring_fd, sq_* and cq_* are the io_uring (ring_fd is -1 with the thread pool), queued is the
+// number of requests not submitted yet and in_flight the number not completed yet
+// lock, changed, threads and stop are the thread pool's
+typedef struct _INGEST
+{
+	struct dirent** files;
+	int num_files;
+	int queue_depth;
+	int method;
+	INGEST_SLOT* slots;
+	int next_file;
+	int next_submit;
+	int handed_out;
+
+	int ring_fd;
+	void* sq_ring;
+	long sq_ring_size;
+	void* cq_ring;
+	long cq_ring_size;
+	void* sqes;
+	long sqes_size;
+	unsigned int* sq_head;
+	unsigned int* sq_tail;
+	unsigned int* sq_mask;
+	unsigned int* sq_array;
+	unsigned int* cq_head;
+	unsigned int* cq_tail;
+	unsigned int* cq_mask;
+	void* cqes;
+	int queued;
+	int in_flight;
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	pthread_t* threads;
+	int num_threads;
+	int stop;
+} __INGEST;
+
+typedef struct _INGEST INGEST;
+
+// Usage Example  (the contents of every regular file, in order)
+// INGEST* ingest = startIngest(files, num_files, INGEST_QUEUE_DEPTH, INGEST_IO_URING);
+// DOCUMENT* document;
+// int file;
+// while ((document = nextIngested(ingest, &file)) != NULL) {
+//     /* DO SOMETHING WITH document->contents AND document->length OF files[file] */
+// }
+// finishIngest(ingest);
+//
+// startIngest starts reading the num_files files in files (names relative to the current
+// directory), with method (INGEST_IO_URING falls back to INGEST_THREAD_POOL if io_uring
+// can't be set up).
+INGEST* startIngest(struct dirent** files, int num_files, int queue_depth, int method);
+
+// nextIngested waits for the next regular file in the list that could be read and returns its
+// contents, setting *file to its position in the list.  The DOCUMENT stays valid until the
+// next call.  Returns NULL once every file has been handed out.
+DOCUMENT* nextIngested(INGEST* ingest, int* file);
+
+// finishIngest stops reading (if the files weren't all handed out) and frees ingest.
+void finishIngest(INGEST* ingest);
+
+#endif
@@ -0,0 +1,338 @@
+// Contains the ways of intersecting sorted lists of document ids (see
+// intersect.h): merging, galloping, and comparing blocks of them in scalar,
+// SSE2 and AVX2 versions.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "intersect.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define INTERSECT_X86
+#include <immintrin.h>
+#endif
+
+// -------------------------------
+// ---- MERGING AND GALLOPING ----
+// -------------------------------
+
+// merges a from position i and b from position j, writing the matches from a_matches[found]
+// and b_matches[found] on.  Returns the number found in all.  (There are no branches on the
+// ids, which would be mispredicted about half the time: each pair of positions is written, and
+// kept by moving found on if the ids match.  found never gets past i or j, so the writes stay
+// inside the matches.)
+static int mergeFrom(int* a, int i, int num_a, int* b, int j, int num_b, int* a_matches, int* b_matches, int found)
+{
+	int a_id;
+	int b_id;
+
+	while(i < num_a && j < num_b)
+	{
+		a_id = a[i];
+		b_id = b[j];
+		a_matches[found] = i;
+		b_matches[found] = j;
+		found += (a_id == b_id);
+		i += (a_id <= b_id);
+		j += (b_id <= a_id);
+	}
+
+	return found;
+}
+
+static int intersectMerge(int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+	return mergeFrom(a, 0, num_a, b, 0, num_b, a_matches, b_matches, 0);
+}
+
+// returns the first position at or after from in ids whose id is at least id (num_ids if there
+// isn't one), galloping ahead in doubling steps and then binary searching
+static int gallop(int* ids, int from, int num_ids, int id)
+{
+	int low = from;
+	int high;
+	int middle;
+	int step = 1;
+
+	if(low >= num_ids || ids[low] >= id)
+		return low;
+
+// ids[low] is always under id
+	while(low + step < num_ids && ids[low + step] < id)
+	{
+		low += step;
+		step *= 2;
+	}
+
+	high = (low + step < num_ids) ? low + step : num_ids;
+
+	while(high - low > 1)
+	{
+		middle = low + (high - low) / 2;
+
+		if(ids[middle] < id)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	return high;
+}
+
+// (a is the shorter list)
+static int intersectGallop(int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+	int found = 0;
+	int j = 0;
+
+	for(int i = 0; i < num_a; i++)
+	{
+		if((j = gallop(b, j, num_b, a[i])) == num_b)
+			break;
+
+		if(b[j] == a[i])
+		{
+			a_matches[found] = i;
+			b_matches[found++] = j++;
+		}
+	}
+
+	return found;
+}
+
+// writes the matches in a block of a (from i) and a block of b (from j): a_mask has a bit
+// set for each id of the a block in the b block, and b_mask for each of the b block in the
+// a block.  The ids are sorted in both, so the n'th bit of one goes with the n'th of the other.
+static inline int writeMatches(unsigned int a_mask, unsigned int b_mask, int i, int j, int* a_matches, int* b_matches, int found)
+{
+	while(a_mask != 0)
+	{
+		a_matches[found] = i + __builtin_ctz(a_mask);
+		b_matches[found++] = j + __builtin_ctz(b_mask);
+		a_mask &= a_mask - 1;
+		b_mask &= b_mask - 1;
+	}
+
+	return found;
+}
+
+#ifdef INTERSECT_X86
+
+// -----------------------------
+// ---- SSE2 BLOCK COMPARES ----
+// -----------------------------
+
+// the bits of the 4 bit mask turned left by turn
+#define TURN_4(mask, turn) ((((mask) << (turn)) | ((mask) >> (4 - (turn)))) & 15)
+
+// compares 4 ids of a with 4 of b at a time, by comparing them with b's turned 0, 1, 2 and 3 places
+// (lane l of a against lane l + turn of b), moving ahead whichever block ends lower (or both)
+static int intersectBlocksSSE2(int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+	__m128i a_block;
+	__m128i b_block;
+	unsigned int turned[4];
+	unsigned int a_mask;
+	int a_last;
+	int b_last;
+	int found = 0;
+	int i = 0;
+	int j = 0;
+
+	while(i + 4 <= num_a && j + 4 <= num_b)
+	{
+		a_block = _mm_loadu_si128((__m128i*)(a + i));
+		b_block = _mm_loadu_si128((__m128i*)(b + j));
+
+		turned[0] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a_block, b_block)));
+		turned[1] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a_block, _mm_shuffle_epi32(b_block, _MM_SHUFFLE(0, 3, 2, 1)))));
+		turned[2] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a_block, _mm_shuffle_epi32(b_block, _MM_SHUFFLE(1, 0, 3, 2)))));
+		turned[3] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a_block, _mm_shuffle_epi32(b_block, _MM_SHUFFLE(2, 1, 0, 3)))));
+
+		if((a_mask = turned[0] | turned[1] | turned[2] | turned[3]) != 0)
+			found = writeMatches(a_mask, turned[0] | TURN_4(turned[1], 1) | TURN_4(turned[2], 2) | TURN_4(turned[3], 3),
+				i, j, a_matches, b_matches, found);
+
+		a_last = a[i + 3];
+		b_last = b[j + 3];
+		i += (a_last <= b_last) ? 4 : 0;
+		j += (b_last <= a_last) ? 4 : 0;
+	}
+
+	return mergeFrom(a, i, num_a, b, j, num_b, a_matches, b_matches, found);
+}
+
+// -----------------------------
+// ---- AVX2 BLOCK COMPARES ----
+// -----------------------------
+
+#define AVX2 __attribute__((target("avx2")))
+
+// the lanes of b_block turned on 1 to 7 places (lane l of each gets lane l + turn of b_block)
+#define TURN_8(turn) _mm256_setr_epi32((turn) & 7, ((turn) + 1) & 7, ((turn) + 2) & 7, ((turn) + 3) & 7, \
+	((turn) + 4) & 7, ((turn) + 5) & 7, ((turn) + 6) & 7, ((turn) + 7) & 7)
+
+// the bits of the 8 bit mask turned left by turn
+#define TURN_MASK_8(mask, turn) ((((mask) << (turn)) | ((mask) >> (8 - (turn)))) & 255)
+
+// the same as intersectBlocksSSE2, 8 ids at a time (the masks of b's ids are only worked out
+// for blocks with matches)
+AVX2 static int intersectBlocksAVX2(int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+	__m256i turns[8] = { TURN_8(0), TURN_8(1), TURN_8(2), TURN_8(3), TURN_8(4), TURN_8(5), TURN_8(6), TURN_8(7) };
+	__m256i a_block;
+	__m256i b_block;
+	__m256i equal[8];
+	unsigned int a_mask;
+	unsigned int b_mask;
+	int a_last;
+	int b_last;
+	int found = 0;
+	int i = 0;
+	int j = 0;
+
+	while(i + 8 <= num_a && j + 8 <= num_b)
+	{
+		a_block = _mm256_loadu_si256((__m256i*)(a + i));
+		b_block = _mm256_loadu_si256((__m256i*)(b + j));
+
+		equal[0] = _mm256_cmpeq_epi32(a_block, b_block);
+		equal[1] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[1]));
+		equal[2] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[2]));
+		equal[3] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[3]));
+		equal[4] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[4]));
+		equal[5] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[5]));
+		equal[6] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[6]));
+		equal[7] = _mm256_cmpeq_epi32(a_block, _mm256_permutevar8x32_epi32(b_block, turns[7]));
+
+		a_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(
+			_mm256_or_si256(_mm256_or_si256(equal[0], equal[1]), _mm256_or_si256(equal[2], equal[3])),
+			_mm256_or_si256(_mm256_or_si256(equal[4], equal[5]), _mm256_or_si256(equal[6], equal[7])))));
+
+		if(a_mask != 0)
+		{
+			b_mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal[0]));
+
+			for(int turn = 1; turn < 8; turn++)
+				b_mask |= TURN_MASK_8((unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(equal[turn])), turn);
+
+			found = writeMatches(a_mask, b_mask, i, j, a_matches, b_matches, found);
+		}
+
+		a_last = a[i + 7];
+		b_last = b[j + 7];
+		i += (a_last <= b_last) ? 8 : 0;
+		j += (b_last <= a_last) ? 8 : 0;
+	}
+
+	return mergeFrom(a, i, num_a, b, j, num_b, a_matches, b_matches, found);
+}
+
+#endif
+
+// ------------------
+// ---- DISPATCH ----
+// ------------------
+
+// the block compares of one level
+typedef struct _BlockIntersect
+{
+	int level;
+	int (*intersect)(int*, int, int*, int, int*, int*);
+} __BlockIntersect;
+
+typedef struct _BlockIntersect BlockIntersect;
+
+// (without SIMD, comparing blocks is merging)
+static const BlockIntersect scalar_blocks = { INTERSECT_SCALAR, intersectMerge };
+
+#ifdef INTERSECT_X86
+static const BlockIntersect sse2_blocks = { INTERSECT_SSE2, intersectBlocksSSE2 };
+static const BlockIntersect avx2_blocks = { INTERSECT_AVX2, intersectBlocksAVX2 };
+#endif
+
+// the block compares in use, swapped with an atomic store, so the level can be changed while
+// other threads are intersecting
+static const BlockIntersect* block_intersect = &scalar_blocks;
+
+static pthread_once_t intersect_once = PTHREAD_ONCE_INIT;
+
+// Points the block compares at the version for level, or the best level below it the processor supports.
+static int useIntersectLevel(int level)
+{
+	const BlockIntersect* chosen = &scalar_blocks;
+
+#ifdef INTERSECT_X86
+	__builtin_cpu_init();
+
+	if(level >= INTERSECT_AVX2 && __builtin_cpu_supports("avx2"))
+		chosen = &avx2_blocks;
+	else if(level >= INTERSECT_SSE2 && __builtin_cpu_supports("sse2"))
+		chosen = &sse2_blocks;
+#endif
+
+	__atomic_store_n(&block_intersect, chosen, __ATOMIC_RELEASE);
+
+	return chosen->level;
+}
+
+// Picks SSE2 if the processor supports it (run once, before the first block compare).  Blocks
+// are only compared for lists within GALLOP_RATIO of each other's length, and there AVX2 is no
+// faster (see ../bench/intersect_bench.c), so it's only used if it's asked for.
+static void chooseIntersectLevel()
+{
+	useIntersectLevel(INTERSECT_SSE2);
+}
+
+// Returns the block compares in use, picking them the first time.
+static inline const BlockIntersect* currentBlocks()
+{
+	pthread_once(&intersect_once, chooseIntersectLevel);
+
+	return __atomic_load_n(&block_intersect, __ATOMIC_ACQUIRE);
+}
+
+int setIntersectLevel(int level)
+{
+	pthread_once(&intersect_once, chooseIntersectLevel);
+
+	return useIntersectLevel(level);
+}
+
+int intersectLevel()
+{
+	return currentBlocks()->level;
+}
+
+int intersectWith(int method, int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+// the shorter list goes first
+	if(num_a > num_b)
+		return intersectWith(method, b, num_b, a, num_a, b_matches, a_matches);
+
+	if(num_a == 0)
+		return 0;
+
+	if(method == INTERSECT_GALLOP)
+		return intersectGallop(a, num_a, b, num_b, a_matches, b_matches);
+
+	if(method == INTERSECT_BLOCKS)
+		return currentBlocks()->intersect(a, num_a, b, num_b, a_matches, b_matches);
+
+	return intersectMerge(a, num_a, b, num_b, a_matches, b_matches);
+}
+
+int intersectSorted(int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches)
+{
+	int shorter = (num_a < num_b) ? num_a : num_b;
+	int longer = (num_a < num_b) ? num_b : num_a;
+
+	if(shorter == 0)
+		return 0;
+
+	if(longer / shorter >= GALLOP_RATIO)
+		return intersectWith(INTERSECT_GALLOP, a, num_a, b, num_b, a_matches, b_matches);
+
+	return intersectWith(INTERSECT_BLOCKS, a, num_a, b, num_b, a_matches, b_matches);
+}
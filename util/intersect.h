@@ -0,0 +1,53 @@
+#ifndef _INTERSECT_H_
+#define _INTERSECT_H_
+
+// Intersects sorted lists of document ids (the doc_ids of PostingLists, see
+// postings.h), for ANDing the words of a query.  Each list must be sorted
+// from lowest to highest with no id twice.
+//
+// There are three ways to do it, and intersectSorted picks one by how much
+// longer the long list is than the short one:
+//
+//	INTERSECT_GALLOP	looks each id of the short list up in the long one,
+//				galloping ahead in doubling steps, for lists at
+//				least GALLOP_RATIO times as long as the other
+//	INTERSECT_BLOCKS	compares a block of ids from each list against each
+//				other at once, 4 (SSE2) or 8 (AVX2) at a time, for
+//				lists closer in length than that
+//	INTERSECT_MERGE		walks both lists one id at a time, for lists closer
+//				in length when the processor has no SIMD (the blocks
+//				are merged then), and for the ids left after the
+//				last whole block
+//
+// Like the scans in textscan.h, SSE2 is picked the first time it's needed, if
+// the processor supports it (AVX2 is no faster for lists close enough in length
+// to compare blocks, so it's only used through setIntersectLevel), and every
+// level finds the same ids.
+
+#define INTERSECT_SCALAR 0
+#define INTERSECT_SSE2 1
+#define INTERSECT_AVX2 2
+
+#define INTERSECT_MERGE 0
+#define INTERSECT_GALLOP 1
+#define INTERSECT_BLOCKS 2
+
+#define GALLOP_RATIO 32
+
+// setIntersectLevel makes the block compares use level (or the best level under it the processor
+// supports), even while other threads are intersecting.  Returns the level they'll use.
+int setIntersectLevel(int level);
+
+// intersectLevel returns the level the block compares use.
+int intersectLevel();
+
+// intersectSorted finds the ids in both a (num_a of them) and b (num_b of them).  The position of
+// the i'th one in a goes in a_matches[i] and its position in b in b_matches[i], so each needs room
+// for as many ids as the shorter list has.  Returns the number found.
+int intersectSorted(int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches);
+
+// intersectWith is intersectSorted done with method (INTERSECT_MERGE, _GALLOP or _BLOCKS), whatever
+// the lengths of the lists.
+int intersectWith(int method, int* a, int num_a, int* b, int num_b, int* a_matches, int* b_matches);
+
+#endif
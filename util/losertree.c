@@ -0,0 +1,139 @@
+// Contains the LOSER_TREE functions, which merge PostingLists a document at a
+// time through a tournament tree of losers (see losertree.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "header.h"
+#include "postings.h"
+#include "losertree.h"
+
+// Returns list's key: its next document id in the high 32 bits and list in the low ones,
+// or LLONG_MAX once it's run out.
+static inline long long listKey(LOSER_TREE* tree, int list)
+{
+	LoserCursor* cursor = &tree->cursors[list];
+
+	if(cursor->next == cursor->end)
+		return LLONG_MAX;
+
+	return ((long long)*cursor->next << 32) | list;
+}
+
+// Plays the matches below node, storing each loser, and returns the winner.
+static int playMatches(LOSER_TREE* tree, int node)
+{
+	int left;
+	int right;
+
+// a leaf
+	if(node >= tree->num_lists)
+		return node - tree->num_lists;
+
+	left = playMatches(tree, 2 * node);
+	right = playMatches(tree, 2 * node + 1);
+
+	if(tree->keys[left] < tree->keys[right])
+	{
+		tree->losers[node] = right;
+		return left;
+	}
+
+	tree->losers[node] = left;
+	return right;
+}
+
+// Moves list on to its next document and plays its matches again on its way up from its leaf,
+// against the losers stored there.  Returns the new winner (not stored in losers[0]).
+static inline int replayMatches(LOSER_TREE* tree, int list)
+{
+	LoserCursor* cursor = &tree->cursors[list];
+	long long winner_key;
+	int winner = list;
+	int loser;
+
+	cursor->next++;
+	cursor->frequency++;
+	winner_key = tree->keys[list] = listKey(tree, list);
+
+	for(int node = (tree->num_lists + list) / 2; node > 0; node /= 2)
+	{
+		if(tree->keys[(loser = tree->losers[node])] < winner_key)
+		{
+			tree->losers[node] = winner;
+			winner = loser;
+			winner_key = tree->keys[loser];
+		}
+	}
+
+	return winner;
+}
+
+// Returns a LOSER_TREE with the first documents of the num_lists lists played off.
+LOSER_TREE* initializeLoserTree(PostingList** lists, int num_lists)
+{
+	LOSER_TREE* tree = malloc(sizeof(LOSER_TREE));
+	int size = (num_lists > 0) ? num_lists : 1;
+
+	MALLOC_CHECK(tree);
+
+	tree->num_lists = num_lists;
+	tree->cursors = malloc(size * sizeof(LoserCursor));
+	tree->keys = malloc(size * sizeof(long long));
+	tree->losers = malloc(size * sizeof(int));
+	MALLOC_CHECK(tree->cursors);
+	MALLOC_CHECK(tree->keys);
+	MALLOC_CHECK(tree->losers);
+
+	for(int list = 0; list < num_lists; list++)
+	{
+		tree->cursors[list].next = lists[list]->doc_ids;
+		tree->cursors[list].end = lists[list]->doc_ids + lists[list]->num_docs;
+		tree->cursors[list].frequency = lists[list]->frequencies;
+		tree->keys[list] = listKey(tree, list);
+	}
+
+// (one list wins by default, with no matches to play)
+	tree->losers[0] = (num_lists > 1) ? playMatches(tree, 1) : 0;
+
+	return tree;
+}
+
+// Takes the winner's document, then moves on every list whose next document is the same one
+// (they're the next winners), keeping the highest frequency.
+int nextDocument(LOSER_TREE* tree, int* document_id, int* rank)
+{
+	int winner;
+	long long document;
+	int best = 0;
+
+	if(tree->num_lists == 0 || tree->keys[(winner = tree->losers[0])] == LLONG_MAX)
+		return 0;
+
+	document = tree->keys[winner] >> 32;
+
+	do
+	{
+		if(*tree->cursors[winner].frequency > best)
+			best = *tree->cursors[winner].frequency;
+
+		winner = replayMatches(tree, winner);
+	} while((tree->keys[winner] >> 32) == document && tree->keys[winner] != LLONG_MAX);
+
+	tree->losers[0] = winner;
+	*document_id = (int)document;
+	*rank = best;
+
+	return 1;
+}
+
+// Frees tree's arrays and tree (its lists are left alone).
+void cleanLoserTree(LOSER_TREE* tree)
+{
+	free(tree->cursors);
+	free(tree->keys);
+	free(tree->losers);
+	free(tree);
+}
@@ -0,0 +1,55 @@
+#ifndef _LOSERTREE_H_
+#define _LOSERTREE_H_
+
+// A LOSER_TREE merges k PostingLists (see postings.h) a document at a time,
+// for ORing the clauses of a query: each document in any of the lists comes
+// out once, in order of document id, ranked by its highest frequency in any
+// of them.
+//
+// It's a tournament between the lists' next documents, the lowest id winning
+// (the earlier list between equal ids).  Each node of the tree holds the
+// loser of the match played there, so once the winner moves on, only the
+// matches on its way back up are played again: taking the next document
+// costs O(log k), and merging n postings O(n log k).
+
+#include "postings.h"
+
+// a list's place in the merge: next is its next document id (end once it's run out) and
+// frequency that document's frequency
+typedef struct _LoserCursor
+{
+	int* next;
+	int* end;
+	int* frequency;
+} __LoserCursor;
+
+typedef struct _LoserCursor LoserCursor;
+
+// cursors[i] is lists[i]'s place in the merge (the lists aren't copied, so they must
+// outlast the tree)
+// keys[i] is what lists[i] plays with: its next document id above i (LLONG_MAX once it's
+// run out), so the lowest key wins, and between equal ids the earlier list
+// losers[n] is the list that lost the match at node n (the leaves, lists[i] at node
+// num_lists + i, aren't stored), and losers[0] is the overall winner
+typedef struct _LOSER_TREE
+{
+	LoserCursor* cursors;
+	long long* keys;
+	int* losers;
+	int num_lists;
+} __LOSER_TREE;
+
+typedef struct _LOSER_TREE LOSER_TREE;
+
+// initializeLoserTree returns a LOSER_TREE merging the num_lists lists.
+LOSER_TREE* initializeLoserTree(PostingList** lists, int num_lists);
+
+// nextDocument puts the lowest document id left in any of the lists in document_id, and its
+// highest frequency in any of them in rank, moving every list holding it past it.  Returns 0
+// (leaving them alone) once every list has run out, 1 otherwise.
+int nextDocument(LOSER_TREE* tree, int* document_id, int* rank);
+
+// cleanLoserTree frees tree (but not its lists).
+void cleanLoserTree(LOSER_TREE* tree);
+
+#endif
@@ -0,0 +1,329 @@
+// Contains the functions that write, map, and search mapped index files
+// (see mapindex.h for the format).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "header.h"
+#include "postings.h"
+#include "dictionary.h"
+#include "mapindex.h"
+
+// the header is the magic number followed by this many unsigned ints
+#define MAPPED_HEADER_FIELDS 6
+#define MAPPED_HEADER_LENGTH (4 + MAPPED_HEADER_FIELDS * sizeof(unsigned int))
+
+// unsigned ints per slot and per word
+#define SLOT_FIELDS 2
+#define WORD_FIELDS 4
+
+// Saves index to file_name in the mapped format.  Returns 0 if it succeeds and 1 if it fails.
+int writeMappedIndex(INVERTED_INDEX* index, char* file_name)
+{
+	FILE* fp;
+	WordNode* current;
+	PostingList* postings;
+	unsigned int header[MAPPED_HEADER_FIELDS];
+	unsigned int* slots;
+	unsigned int* words;
+	unsigned int num_words = 0;
+	unsigned int num_slots = 2;
+	unsigned long num_postings = 0;
+	unsigned long keys_length = 0;
+	unsigned int slot;
+	int max_document = maxIndexDocument(index);
+	int failed;
+
+	for(current = index->start; current != NULL; current = current->next)
+	{
+		num_words++;
+		num_postings += ((PostingList*)current->data)->num_docs;
+		keys_length += current->key_length + 1;
+	}
+
+// every offset in the file has to fit in an unsigned int
+	if(num_postings > UINT_MAX || keys_length > UINT_MAX || num_words > UINT_MAX / 4)
+		return 1;
+
+	while(num_slots < num_words * 2)
+		num_slots *= 2;
+
+	slots = calloc((size_t)num_slots * SLOT_FIELDS, sizeof(unsigned int));
+	MALLOC_CHECK(slots);
+	words = malloc(((size_t)num_words * WORD_FIELDS + 1) * sizeof(unsigned int));
+	MALLOC_CHECK(words);
+
+	num_words = 0;
+	num_postings = 0;
+	keys_length = 0;
+
+// fills in each word's entry, and its slot in the hash table
+	for(current = index->start; current != NULL; current = current->next)
+	{
+		postings = current->data;
+
+		words[num_words * WORD_FIELDS] = keys_length;
+		words[num_words * WORD_FIELDS + 1] = current->key_length;
+		words[num_words * WORD_FIELDS + 2] = num_postings;
+		words[num_words * WORD_FIELDS + 3] = postings->num_docs;
+
+		for(slot = current->hash_value & (num_slots - 1); slots[slot * SLOT_FIELDS + 1] != 0; slot = (slot + 1) & (num_slots - 1))
+			;
+
+		slots[slot * SLOT_FIELDS] = (unsigned int)current->hash_value;
+		slots[slot * SLOT_FIELDS + 1] = num_words + 1;
+
+		num_words++;
+		num_postings += postings->num_docs;
+		keys_length += current->key_length + 1;
+	}
+
+	header[0] = MAPPED_INDEX_VERSION;
+	header[1] = num_words;
+	header[2] = num_slots;
+	header[3] = num_postings;
+	header[4] = keys_length;
+	header[5] = (unsigned int)max_document;
+
+	if((fp = fopen(file_name, "wb")) == NULL)
+		failed = 1;
+	else
+	{
+		failed = (fwrite(MAPPED_INDEX_MAGIC, 1, 4, fp) != 4);
+		failed |= (fwrite(header, sizeof(unsigned int), MAPPED_HEADER_FIELDS, fp) != MAPPED_HEADER_FIELDS);
+		failed |= (fwrite(slots, sizeof(unsigned int) * SLOT_FIELDS, num_slots, fp) != num_slots);
+		failed |= (fwrite(words, sizeof(unsigned int) * WORD_FIELDS, num_words, fp) != num_words);
+
+		for(current = index->start; current != NULL && !failed; current = current->next)
+		{
+			postings = current->data;
+			failed |= (fwrite(postings->doc_ids, sizeof(int), postings->num_docs, fp) != postings->num_docs);
+		}
+
+		for(current = index->start; current != NULL && !failed; current = current->next)
+		{
+			postings = current->data;
+			failed |= (fwrite(postings->frequencies, sizeof(int), postings->num_docs, fp) != postings->num_docs);
+		}
+
+		for(current = index->start; current != NULL && !failed; current = current->next)
+			failed |= (fwrite(current->key, 1, current->key_length + 1, fp) != current->key_length + 1);
+
+		failed |= (fclose(fp) != 0);
+	}
+
+	free(slots);
+	free(words);
+
+	return failed;
+}
+
+// Maps file_name into memory and checks its header.  Nothing past the header is read,
+// so this takes the same time for any size of index.  Returns NULL if it fails.
+MAPPED_INDEX* openMappedIndex(char* file_name)
+{
+	MAPPED_INDEX* mapped;
+	struct stat file_stat;
+	unsigned int header[MAPPED_HEADER_FIELDS];
+	unsigned long expected_length;
+	void* map;
+	int fd;
+
+	if((fd = open(file_name, O_RDONLY)) == -1)
+		return NULL;
+
+	if(fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)MAPPED_HEADER_LENGTH)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(map == MAP_FAILED)
+		return NULL;
+
+	memcpy(header, (char*)map + 4, sizeof(header));
+
+// the slots, words and postings must exactly fill the rest of the file
+	expected_length = MAPPED_HEADER_LENGTH + sizeof(unsigned int) * ((unsigned long)header[2] * SLOT_FIELDS
+		+ (unsigned long)header[1] * WORD_FIELDS + (unsigned long)header[3] * 2) + header[4];
+
+	if(memcmp(map, MAPPED_INDEX_MAGIC, 4) != 0 || header[0] != MAPPED_INDEX_VERSION
+		|| header[2] == 0 || (header[2] & (header[2] - 1)) != 0 || header[2] / 2 < header[1]
+		|| expected_length != (unsigned long)file_stat.st_size)
+	{
+		munmap(map, file_stat.st_size);
+		return NULL;
+	}
+
+// lookups jump around the file, so there's no point reading ahead
+	posix_madvise(map, file_stat.st_size, POSIX_MADV_RANDOM);
+
+	mapped = malloc(sizeof(MAPPED_INDEX));
+	MALLOC_CHECK(mapped);
+
+	mapped->map = map;
+	mapped->length = file_stat.st_size;
+	mapped->num_words = header[1];
+	mapped->num_slots = header[2];
+	mapped->num_postings = header[3];
+	mapped->keys_length = header[4];
+	mapped->max_document = (int)header[5];
+	mapped->slots = (unsigned int*)(mapped->map + MAPPED_HEADER_LENGTH);
+	mapped->words = mapped->slots + (unsigned long)mapped->num_slots * SLOT_FIELDS;
+	mapped->doc_ids = (int*)(mapped->words + (unsigned long)mapped->num_words * WORD_FIELDS);
+	mapped->frequencies = mapped->doc_ids + mapped->num_postings;
+	mapped->keys = (char*)(mapped->frequencies + mapped->num_postings);
+
+	return mapped;
+}
+
+// Points postings at word number w of mapped.  Returns 0 if its entry is out of bounds
+// (a damaged file), 1 otherwise.
+static int wordPostings(MAPPED_INDEX* mapped, unsigned int w, PostingList* postings)
+{
+	unsigned int* word = mapped->words + (unsigned long)w * WORD_FIELDS;
+
+	if(word[2] > mapped->num_postings || word[3] > mapped->num_postings - word[2] || word[3] > INT_MAX)
+		return 0;
+
+	postings->num_docs = word[3];
+	postings->capacity = 0;
+	postings->doc_ids = mapped->doc_ids + word[2];
+	postings->frequencies = mapped->frequencies + word[2];
+
+	return 1;
+}
+
+// Returns the key of word number w of mapped, or NULL if it's out of bounds.
+static char* wordKey(MAPPED_INDEX* mapped, unsigned int w, unsigned int* key_length)
+{
+	unsigned int* word = mapped->words + (unsigned long)w * WORD_FIELDS;
+
+	if(word[0] >= mapped->keys_length || word[1] >= mapped->keys_length - word[0] || mapped->keys[word[0] + word[1]] != 0)
+		return NULL;
+
+	*key_length = word[1];
+
+	return mapped->keys + word[0];
+}
+
+// Looks word up in the on-disk hash table of mapped, pointing postings at its postings.
+// Returns 1 if word is in the index and 0 if it isn't.
+int lookupMappedIndex(MAPPED_INDEX* mapped, char* word, PostingList* postings)
+{
+	unsigned long hash_value = hash(word);
+	unsigned int length = strlen(word);
+	unsigned int slot = hash_value & (mapped->num_slots - 1);
+	unsigned int key_length;
+	unsigned int w;
+	char* key;
+
+// at least half the slots are empty, so this stops long before it wraps around
+	for(unsigned int probes = 0; probes < mapped->num_slots; probes++)
+	{
+		if((w = mapped->slots[slot * SLOT_FIELDS + 1]) == 0)
+			return 0;
+
+		if(mapped->slots[slot * SLOT_FIELDS] == (unsigned int)hash_value && --w < mapped->num_words
+			&& (key = wordKey(mapped, w, &key_length)) != NULL && key_length == length && memcmp(key, word, length) == 0)
+			return wordPostings(mapped, w, postings);
+
+		slot = (slot + 1) & (mapped->num_slots - 1);
+	}
+
+	return 0;
+}
+
+// Copies every word of the mapped index file_name (in order) into a new index.
+// Returns NULL if it can't be read or is damaged.
+INVERTED_INDEX* readMappedIndex(char* file_name)
+{
+	MAPPED_INDEX* mapped;
+	INVERTED_INDEX* index;
+	PostingList view;
+	PostingList* postings;
+	unsigned int key_length;
+	char* key;
+	int bad = 0;
+
+	if((mapped = openMappedIndex(file_name)) == NULL)
+		return NULL;
+
+	index = initializeDict();
+
+	for(unsigned int w = 0; w < mapped->num_words && !bad; w++)
+	{
+		if((key = wordKey(mapped, w, &key_length)) == NULL || !wordPostings(mapped, w, &view))
+		{
+			bad = 1;
+			break;
+		}
+
+		postings = initializePostings(view.num_docs);
+		memcpy(postings->doc_ids, view.doc_ids, view.num_docs * sizeof(int));
+		memcpy(postings->frequencies, view.frequencies, view.num_docs * sizeof(int));
+		postings->num_docs = view.num_docs;
+
+		if(addData(index, postings, key) != 0)
+		{
+			cleanPostings(postings);
+			bad = 1;
+		}
+	}
+
+	closeMappedIndex(mapped);
+
+	if(bad)
+	{
+		fprintf(stderr, "Bad mapped index file %s\n", file_name);
+		cleanIndex(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+// Returns the highest document id in mapped, which writeMappedIndex kept in the header.
+int maxMappedDocument(MAPPED_INDEX* mapped)
+{
+	return mapped->max_document;
+}
+
+// Unmaps mapped and frees it.
+void closeMappedIndex(MAPPED_INDEX* mapped)
+{
+	if(mapped == NULL)
+		return;
+
+	munmap(mapped->map, mapped->length);
+	free(mapped);
+}
+
+// Returns 1 if file_name starts with the mapped index magic number, 0 if not.
+int isMappedIndex(char* file_name)
+{
+	FILE* fp;
+	char magic[4];
+	int is_mapped;
+
+	if((fp = fopen(file_name, "rb")) == NULL)
+		return 0;
+
+	is_mapped = (fread(magic, 1, 4, fp) == 4 && memcmp(magic, MAPPED_INDEX_MAGIC, 4) == 0);
+	fclose(fp);
+
+	return is_mapped;
+}
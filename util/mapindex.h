@@ -0,0 +1,76 @@
+#ifndef _MAPINDEX_H_
+#define _MAPINDEX_H_
+
+// A MAPPED index file is laid out so it can be mmapped and searched in place:
+// looking up a word probes an on-disk hash table, and its postings are read
+// straight out of the mapping.  Opening one takes the same (short) time no
+// matter how big it is (the highest document id, which sizes the query engine's
+// accumulator, is kept in the header for that), and every process that maps the same file shares its
+// pages in the page cache.
+//
+// All numbers are 32 bit unsigned ints in the byte order of the machine that
+// wrote the file (the version number doubles as a byte order check), and the
+// slots use hash() from dictionary.h, so the file is meant to be read on the
+// same kind of machine that wrote it.
+//
+//	header		"TSEM", version, num_words, num_slots, num_postings, keys_length,
+//			max_document (the highest document id, as an int, -1 if there are none)
+//	slots		num_slots x (hash value, word number + 1), 0 if empty
+//			(linear probing, num_slots is a power of 2 at least twice num_words)
+//	words		num_words x (key offset, key length, first posting, num_docs)
+//	doc_ids		num_postings ints, each word's postings together, sorted by doc id
+//	frequencies	num_postings ints, matching doc_ids
+//	keys		every key, NUL-terminated
+
+#define MAPPED_INDEX_MAGIC "TSEM"
+#define MAPPED_INDEX_VERSION 2
+
+#include "postings.h"
+#include "dictionary.h"
+
+// an open mapped index file
+// map is the whole file (length bytes), the other pointers point into it
+typedef struct _MAPPED_INDEX
+{
+	char* map;
+	long length;
+	unsigned int num_words;
+	unsigned int num_slots;
+	unsigned int num_postings;
+	unsigned int* slots;
+	unsigned int* words;
+	int* doc_ids;
+	int* frequencies;
+	char* keys;
+	unsigned int keys_length;
+	int max_document;
+} __MAPPED_INDEX;
+
+typedef struct _MAPPED_INDEX MAPPED_INDEX;
+
+// writeMappedIndex saves index to file_name in the mapped format.
+// Returns 0 if it succeeds and 1 if it fails.
+int writeMappedIndex(INVERTED_INDEX* index, char* file_name);
+
+// openMappedIndex maps file_name into memory without reading it.
+// Returns NULL if it can't be mapped or isn't a mapped index.
+MAPPED_INDEX* openMappedIndex(char* file_name);
+
+// lookupMappedIndex points postings at the postings of word in mapped (a read-only view,
+// see postings.h).  Returns 1 if word is in the index and 0 if it isn't.
+int lookupMappedIndex(MAPPED_INDEX* mapped, char* word, PostingList* postings);
+
+// readMappedIndex copies every word in a mapped index file into a new index.
+// Returns NULL if the file can't be read or isn't a valid mapped index.
+INVERTED_INDEX* readMappedIndex(char* file_name);
+
+// maxMappedDocument returns the highest document id in mapped (from its header), or -1 if it's empty.
+int maxMappedDocument(MAPPED_INDEX* mapped);
+
+// closeMappedIndex unmaps mapped and frees it.
+void closeMappedIndex(MAPPED_INDEX* mapped);
+
+// isMappedIndex returns 1 if file_name starts with the mapped index magic number, 0 if not.
+int isMappedIndex(char* file_name);
+
+#endif
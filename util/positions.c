@@ -0,0 +1,561 @@
+// Contains the functions that build, write, map and read the positions of an
+// index file (see positions.h for the format).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "header.h"
+#include "dictionary.h"
+#include "docterms.h"
+#include "positions.h"
+
+// the header is the magic number followed by this many unsigned ints
+#define POSITIONS_HEADER_FIELDS 6
+#define POSITIONS_HEADER_LENGTH (4 + POSITIONS_HEADER_FIELDS * sizeof(unsigned int))
+
+// unsigned ints per slot, per word and per skip
+#define SLOT_FIELDS 2
+#define WORD_FIELDS 6
+#define SKIP_FIELDS 2
+
+// the data of one word while it's being built (the data of each DNODE in a POSITIONAL_INDEX)
+// last_document is the id of the last document added, -1 before the first
+// num_documents is how many have been added, and skips their num_skips skips (SKIP_FIELDS each)
+typedef struct _PositionList
+{
+	unsigned char* bytes;
+	long length;
+	long capacity;
+	int last_document;
+	int num_documents;
+	unsigned int* skips;
+	int num_skips;
+	int skips_capacity;
+} __PositionList;
+
+typedef struct _PositionList PositionList;
+
+// Returns the name of the positions file of index_file_name (malloced).
+static char* positionsName(char* index_file_name)
+{
+	char* name = malloc(strlen(index_file_name) + strlen(POSITIONS_SUFFIX) + 1);
+
+	MALLOC_CHECK(name);
+	sprintf(name, "%s%s", index_file_name, POSITIONS_SUFFIX);
+
+	return name;
+}
+
+// Returns the number of bytes value takes as a varint.
+static int varintLength(unsigned long value)
+{
+	int length = 1;
+
+	while(value >= 0x80)
+	{
+		value >>= 7;
+		length++;
+	}
+
+	return length;
+}
+
+// Appends value to list as a varint (list must have room for it).
+static void putVarint(PositionList* list, unsigned long value)
+{
+	while(value >= 0x80)
+	{
+		list->bytes[list->length++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+
+	list->bytes[list->length++] = (unsigned char)value;
+}
+
+// Reads a varint at *position (not going past end) into *value and moves *position past it.
+// Returns 0 if it succeeds and 1 if the varint is cut off or doesn't fit in an int.
+static inline int getVarint(unsigned char** position, unsigned char* end, unsigned long* value)
+{
+	unsigned long result = 0;
+	int shift = 0;
+	unsigned char byte;
+
+	do
+	{
+		if(*position >= end || shift > 28)
+			return 1;
+
+		byte = *(*position)++;
+		result |= (unsigned long)(byte & 0x7f) << shift;
+		shift += 7;
+	}
+	while(byte & 0x80);
+
+	if(result > INT_MAX)
+		return 1;
+
+	*value = result;
+
+	return 0;
+}
+
+// Returns an empty POSITIONAL_INDEX.
+POSITIONAL_INDEX* initializePositionalIndex(void)
+{
+	return initializeDict();
+}
+
+// Groups the positions counted in doc_terms by term, and appends each term's document
+// to the end of its PositionList (making one if it's a new word).
+void addPositions(POSITIONAL_INDEX* positional, DOC_TERMS* doc_terms, int document_id)
+{
+	DNODE* node;
+	PositionList* list;
+	int* positions;
+	int frequency;
+	long positions_length;
+
+	groupPositions(doc_terms);
+
+	for(int t = 0; t < doc_terms->num_terms; t++)
+	{
+		if((node = getData(positional, docTermKey(doc_terms, t))) != NULL)
+			list = node->data;
+		else
+		{
+			list = malloc(sizeof(PositionList));
+			MALLOC_CHECK(list);
+			BZERO(list, sizeof(PositionList));
+			list->last_document = -1;
+			addData(positional, list, docTermKey(doc_terms, t));
+		}
+
+		positions = termPositions(doc_terms, t);
+		frequency = doc_terms->terms[t].frequency;
+
+// the length of the positions goes before them, so it's worked out first
+		positions_length = varintLength(positions[0]);
+
+		for(int i = 1; i < frequency; i++)
+			positions_length += varintLength(positions[i] - positions[i - 1]);
+
+		if(list->length + positions_length + 30 > list->capacity)
+		{
+			while(list->length + positions_length + 30 > list->capacity)
+				list->capacity = list->capacity * 2 + 16;
+
+			list->bytes = realloc(list->bytes, list->capacity);
+			MALLOC_CHECK(list->bytes);
+		}
+
+// every POSITIONS_SKIP_INTERVAL documents, where the next one starts is kept as a skip
+		if(list->num_documents > 0 && list->num_documents % POSITIONS_SKIP_INTERVAL == 0)
+		{
+			if(list->num_skips == list->skips_capacity)
+			{
+				list->skips_capacity = list->skips_capacity * 2 + 4;
+				list->skips = realloc(list->skips, list->skips_capacity * SKIP_FIELDS * sizeof(unsigned int));
+				MALLOC_CHECK(list->skips);
+			}
+
+			list->skips[list->num_skips * SKIP_FIELDS] = list->last_document;
+			list->skips[list->num_skips * SKIP_FIELDS + 1] = list->length;
+			list->num_skips++;
+		}
+
+		putVarint(list, document_id - list->last_document);
+		putVarint(list, frequency);
+		putVarint(list, positions_length);
+		putVarint(list, positions[0]);
+
+		for(int i = 1; i < frequency; i++)
+			putVarint(list, positions[i] - positions[i - 1]);
+
+		list->last_document = document_id;
+		list->num_documents++;
+	}
+}
+
+// Saves positional as the positions of index_file_name.  Returns 0 if it succeeds and 1 if it fails.
+int writePositions(POSITIONAL_INDEX* positional, char* index_file_name)
+{
+	FILE* fp;
+	DNODE* current;
+	PositionList* list;
+	unsigned int header[POSITIONS_HEADER_FIELDS];
+	unsigned int* slots;
+	unsigned int* words;
+	unsigned int num_words = 0;
+	unsigned int num_slots = 2;
+	unsigned long data_length = 0;
+	unsigned long keys_length = 0;
+	unsigned long num_skips = 0;
+	unsigned int slot;
+	char* name;
+	char* temporary_name;
+	int failed;
+
+	for(current = positional->start; current != NULL; current = current->next)
+	{
+		num_words++;
+		data_length += ((PositionList*)current->data)->length;
+		keys_length += current->key_length + 1;
+		num_skips += ((PositionList*)current->data)->num_skips;
+	}
+
+// every offset in the file has to fit in an unsigned int
+	if(data_length > UINT_MAX || keys_length > UINT_MAX || num_words > UINT_MAX / 4 || num_skips > UINT_MAX / SKIP_FIELDS)
+		return 1;
+
+	while(num_slots < num_words * 2)
+		num_slots *= 2;
+
+	slots = calloc((size_t)num_slots * SLOT_FIELDS, sizeof(unsigned int));
+	MALLOC_CHECK(slots);
+	words = malloc(((size_t)num_words * WORD_FIELDS + 1) * sizeof(unsigned int));
+	MALLOC_CHECK(words);
+
+	num_words = 0;
+	data_length = 0;
+	keys_length = 0;
+	num_skips = 0;
+
+// fills in each word's entry, and its slot in the hash table
+	for(current = positional->start; current != NULL; current = current->next)
+	{
+		list = current->data;
+
+		words[num_words * WORD_FIELDS] = keys_length;
+		words[num_words * WORD_FIELDS + 1] = current->key_length;
+		words[num_words * WORD_FIELDS + 2] = data_length;
+		words[num_words * WORD_FIELDS + 3] = list->length;
+		words[num_words * WORD_FIELDS + 4] = num_skips;
+		words[num_words * WORD_FIELDS + 5] = list->num_skips;
+
+		for(slot = current->hash_value & (num_slots - 1); slots[slot * SLOT_FIELDS + 1] != 0; slot = (slot + 1) & (num_slots - 1))
+			;
+
+		slots[slot * SLOT_FIELDS] = (unsigned int)current->hash_value;
+		slots[slot * SLOT_FIELDS + 1] = num_words + 1;
+
+		num_words++;
+		data_length += list->length;
+		keys_length += current->key_length + 1;
+		num_skips += list->num_skips;
+	}
+
+	header[0] = POSITIONS_VERSION;
+	header[1] = num_words;
+	header[2] = num_slots;
+	header[3] = data_length;
+	header[4] = keys_length;
+	header[5] = num_skips;
+
+	name = positionsName(index_file_name);
+	temporary_name = malloc(strlen(name) + 5);
+	MALLOC_CHECK(temporary_name);
+	sprintf(temporary_name, "%s.new", name);
+
+	if((fp = fopen(temporary_name, "wb")) == NULL)
+		failed = 1;
+	else
+	{
+		failed = (fwrite(POSITIONS_MAGIC, 1, 4, fp) != 4);
+		failed |= (fwrite(header, sizeof(unsigned int), POSITIONS_HEADER_FIELDS, fp) != POSITIONS_HEADER_FIELDS);
+		failed |= (fwrite(slots, sizeof(unsigned int) * SLOT_FIELDS, num_slots, fp) != num_slots);
+		failed |= (fwrite(words, sizeof(unsigned int) * WORD_FIELDS, num_words, fp) != num_words);
+
+		for(current = positional->start; current != NULL && !failed; current = current->next)
+		{
+			list = current->data;
+
+			if(list->num_skips > 0)
+				failed |= (fwrite(list->skips, sizeof(unsigned int) * SKIP_FIELDS, list->num_skips, fp) != (size_t)list->num_skips);
+		}
+
+		for(current = positional->start; current != NULL && !failed; current = current->next)
+		{
+			list = current->data;
+			failed |= (fwrite(list->bytes, 1, list->length, fp) != (size_t)list->length);
+		}
+
+		for(current = positional->start; current != NULL && !failed; current = current->next)
+			failed |= (fwrite(current->key, 1, current->key_length + 1, fp) != (size_t)current->key_length + 1);
+
+		failed |= (fclose(fp) != 0);
+		failed = failed || (rename(temporary_name, name) != 0);
+
+		if(failed)
+			unlink(temporary_name);
+	}
+
+	free(slots);
+	free(words);
+	free(temporary_name);
+	free(name);
+
+	return failed;
+}
+
+// Frees positional and every PositionList in it.
+void cleanPositionalIndex(POSITIONAL_INDEX* positional)
+{
+	DNODE* current;
+
+	for(current = positional->start; current != NULL; current = current->next)
+	{
+		free(((PositionList*)current->data)->bytes);
+		free(((PositionList*)current->data)->skips);
+	}
+
+// cleanDict frees the PositionLists themselves
+	cleanDict(positional);
+}
+
+// Maps the positions of index_file_name and checks their header.  Returns NULL if there
+// aren't any, or they're broken.
+POSITIONS_FILE* openPositions(char* index_file_name)
+{
+	POSITIONS_FILE* positions;
+	struct stat file_stat;
+	unsigned int header[POSITIONS_HEADER_FIELDS];
+	unsigned long expected_length;
+	char* name = positionsName(index_file_name);
+	void* map;
+	int fd;
+
+	fd = open(name, O_RDONLY);
+	free(name);
+
+	if(fd == -1)
+		return NULL;
+
+	if(fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)POSITIONS_HEADER_LENGTH)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(map == MAP_FAILED)
+		return NULL;
+
+	memcpy(header, (char*)map + 4, sizeof(header));
+
+// the slots, words, skips, data and keys must exactly fill the rest of the file
+	expected_length = POSITIONS_HEADER_LENGTH + sizeof(unsigned int) * ((unsigned long)header[2] * SLOT_FIELDS
+		+ (unsigned long)header[1] * WORD_FIELDS + (unsigned long)header[5] * SKIP_FIELDS) + (unsigned long)header[3] + header[4];
+
+	if(memcmp(map, POSITIONS_MAGIC, 4) != 0 || header[0] != POSITIONS_VERSION
+		|| header[2] == 0 || (header[2] & (header[2] - 1)) != 0 || header[2] / 2 < header[1]
+		|| expected_length != (unsigned long)file_stat.st_size)
+	{
+		munmap(map, file_stat.st_size);
+		return NULL;
+	}
+
+	posix_madvise(map, file_stat.st_size, POSIX_MADV_RANDOM);
+
+	positions = malloc(sizeof(POSITIONS_FILE));
+	MALLOC_CHECK(positions);
+
+	positions->map = map;
+	positions->length = file_stat.st_size;
+	positions->num_words = header[1];
+	positions->num_slots = header[2];
+	positions->data_length = header[3];
+	positions->keys_length = header[4];
+	positions->num_skips = header[5];
+	positions->slots = (unsigned int*)(positions->map + POSITIONS_HEADER_LENGTH);
+	positions->words = positions->slots + (unsigned long)positions->num_slots * SLOT_FIELDS;
+	positions->skips = positions->words + (unsigned long)positions->num_words * WORD_FIELDS;
+	positions->data = (unsigned char*)(positions->skips + (unsigned long)positions->num_skips * SKIP_FIELDS);
+	positions->keys = (char*)(positions->data + positions->data_length);
+
+	return positions;
+}
+
+// Looks word up in the on-disk hash table of positions, pointing cursor before its first document.
+// Returns 1 if word is there and 0 if it isn't.
+int lookupPositions(POSITIONS_FILE* positions, char* word, PositionCursor* cursor)
+{
+	unsigned long hash_value = hash(word);
+	unsigned int length = strlen(word);
+	unsigned int slot = hash_value & (positions->num_slots - 1);
+	unsigned int* entry;
+	unsigned int w;
+
+// at least half the slots are empty, so this stops long before it wraps around
+	for(unsigned int probes = 0; probes < positions->num_slots; probes++)
+	{
+		if((w = positions->slots[slot * SLOT_FIELDS + 1]) == 0)
+			return 0;
+
+		entry = positions->words + (unsigned long)(w - 1) * WORD_FIELDS;
+
+// entries that point outside the file are skipped (a damaged file)
+		if(positions->slots[slot * SLOT_FIELDS] == (unsigned int)hash_value && w - 1 < positions->num_words
+			&& entry[0] < positions->keys_length && entry[1] < positions->keys_length - entry[0]
+			&& entry[1] == length && memcmp(positions->keys + entry[0], word, length) == 0
+			&& entry[2] <= positions->data_length && entry[3] <= positions->data_length - entry[2]
+			&& entry[4] <= positions->num_skips && entry[5] <= positions->num_skips - entry[4])
+		{
+			cursor->data = positions->data + entry[2];
+			cursor->next = cursor->data;
+			cursor->end = cursor->next + entry[3];
+			cursor->skips = positions->skips + (unsigned long)entry[4] * SKIP_FIELDS;
+			cursor->num_skips = entry[5];
+			cursor->skip = 0;
+			cursor->document_id = -1;
+			cursor->num_positions = 0;
+			cursor->positions = cursor->positions_end = cursor->next;
+
+			return 1;
+		}
+
+		slot = (slot + 1) & (positions->num_slots - 1);
+	}
+
+	return 0;
+}
+
+// Moves cursor to the next document of its word, skipping the positions of the one it's at
+// without decoding them.  Returns 0 at the end (or if the data is damaged), 1 otherwise.
+static int nextPositions(PositionCursor* cursor)
+{
+	unsigned long delta;
+	unsigned long num_positions;
+	unsigned long length;
+	unsigned char* position = cursor->next;
+
+	if(position >= cursor->end || getVarint(&position, cursor->end, &delta) || delta == 0
+		|| getVarint(&position, cursor->end, &num_positions) || getVarint(&position, cursor->end, &length)
+		|| length > (unsigned long)(cursor->end - position) || num_positions > length
+		|| delta > (unsigned long)((long)INT_MAX - cursor->document_id))
+	{
+		cursor->next = cursor->end;
+		cursor->document_id = INT_MAX;
+		return 0;
+	}
+
+	cursor->document_id += delta;
+	cursor->num_positions = num_positions;
+	cursor->positions = position;
+	cursor->positions_end = position + length;
+	cursor->next = cursor->positions_end;
+
+	return 1;
+}
+
+// Jumps cursor to the last skip before document_id, galloping (1, 2, 4, ... skips ahead) until
+// it's passed and then binary searching the last step, like seekPosting (see postings.h).
+// It's left where it is if it's already past that skip, or the skip points outside the word.
+static void skipPositions(PositionCursor* cursor, int document_id)
+{
+	unsigned int low = cursor->skip;
+	unsigned int high;
+	unsigned int step = 1;
+	unsigned int middle;
+	unsigned int* skips = cursor->skips;
+
+	if(low >= cursor->num_skips || (int)skips[low * SKIP_FIELDS] >= document_id)
+		return;
+
+// skips[low] is always before document_id
+	while(low + step < cursor->num_skips && (int)skips[(low + step) * SKIP_FIELDS] < document_id)
+	{
+		low += step;
+		step *= 2;
+	}
+
+	high = (low + step < cursor->num_skips) ? low + step : cursor->num_skips;
+
+// and skips[high] isn't (or high is the end)
+	while(high - low > 1)
+	{
+		middle = low + (high - low) / 2;
+
+		if((int)skips[middle * SKIP_FIELDS] < document_id)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	cursor->skip = low + 1;
+
+	if((int)skips[low * SKIP_FIELDS] > cursor->document_id && skips[low * SKIP_FIELDS + 1] <= cursor->end - cursor->data
+		&& cursor->data + skips[low * SKIP_FIELDS + 1] > cursor->next)
+	{
+		cursor->document_id = skips[low * SKIP_FIELDS];
+		cursor->next = cursor->data + skips[low * SKIP_FIELDS + 1];
+	}
+}
+
+// Moves cursor forward until it's at document_id or past it, jumping over the skips before it
+// first.  Returns 1 if it's at document_id.
+int seekPositions(PositionCursor* cursor, int document_id)
+{
+	if(cursor->document_id < document_id)
+		skipPositions(cursor, document_id);
+
+	while(cursor->document_id < document_id)
+	{
+		if(!nextPositions(cursor))
+			return 0;
+	}
+
+	return cursor->document_id == document_id;
+}
+
+// Decodes the positions of the document cursor is at into positions.  Returns the number decoded.
+int readPositions(PositionCursor* cursor, int* positions)
+{
+	unsigned char* position = cursor->positions;
+	unsigned long delta;
+	unsigned long current = 0;
+	int i;
+
+	for(i = 0; i < cursor->num_positions; i++)
+	{
+		if(getVarint(&position, cursor->positions_end, &delta) || delta > INT_MAX - current)
+			break;
+
+		current += delta;
+		positions[i] = current;
+	}
+
+	return i;
+}
+
+// Unmaps positions and frees it.
+void closePositions(POSITIONS_FILE* positions)
+{
+	if(positions == NULL)
+		return;
+
+	munmap(positions->map, positions->length);
+	free(positions);
+}
+
+// Deletes the positions of index_file_name.  Returns 1 if there were any.
+int removePositions(char* index_file_name)
+{
+	char* name = positionsName(index_file_name);
+	int removed = (unlink(name) == 0);
+
+	free(name);
+
+	return removed;
+}
@@ -0,0 +1,125 @@
+#ifndef _POSITIONS_H_
+#define _POSITIONS_H_
+
+// The POSITIONS of an index file are where each word occurs in each of its
+// documents, kept next to it in [INDEX FILE].positions when it's built with the
+// indexer's -p option.  A position counts the words of the document before it
+// (the way countDocument counts them, see docterms.h), so two words are next to
+// each other when their positions differ by 1.  The query engine uses them to
+// answer phrase queries: the documents holding every word of a phrase come from
+// the index, and only their positions are read.
+//
+// Like a mapped index (see mapindex.h), the file is mmapped and searched in
+// place, and its 32 bit numbers are in the byte order of the machine that wrote it.
+//
+//	header		"TSEP", version, num_words, num_slots, data_length, keys_length, num_skips
+//	slots		num_slots x (hash value, word number + 1), 0 if empty
+//	words		num_words x (key offset, key length, data offset, data length,
+//			first skip, number of skips)
+//	skips		num_skips x (doc id, byte offset), each word's together
+//	data		data_length bytes, each word's documents together, sorted by doc id
+//	keys		every key, NUL-terminated
+//
+// A word's data is made of varints (see indexfile.h), for each document:
+//	doc_id - previous doc_id	(previous doc_id starts at -1)
+//	num_positions			(the word's frequency in the document)
+//	length in bytes of the positions that follow
+//	first position, then each position - the one before it
+//
+// Every POSITIONS_SKIP_INTERVAL documents a word has a skip: the id of the document
+// before and the offset (in the word's data) where the next one starts, so seekPositions
+// can jump most of the way to a document instead of stepping through every one.
+
+#define POSITIONS_SUFFIX ".positions"
+#define POSITIONS_MAGIC "TSEP"
+#define POSITIONS_VERSION 2
+
+// a word gets a skip every this many documents
+#define POSITIONS_SKIP_INTERVAL 64
+
+#include "dictionary.h"
+#include "docterms.h"
+
+// the positions of every word while an index is being built, one PositionList
+// (private to positions.c) per word
+typedef struct _DICTIONARY POSITIONAL_INDEX;
+
+// an open positions file
+// map is the whole file (length bytes), the other pointers point into it
+typedef struct _POSITIONS_FILE
+{
+	char* map;
+	long length;
+	unsigned int num_words;
+	unsigned int num_slots;
+	unsigned int data_length;
+	unsigned int keys_length;
+	unsigned int num_skips;
+	unsigned int* slots;
+	unsigned int* words;
+	unsigned int* skips;
+	unsigned char* data;
+	char* keys;
+} __POSITIONS_FILE;
+
+typedef struct _POSITIONS_FILE POSITIONS_FILE;
+
+// reads through the documents of one word in a positions file
+// document_id is the document it's at (-1 before the first), with num_positions
+// positions starting at positions; next is where the document after it starts
+// skips are the word's num_skips skips (offsets from data, the start of its data),
+// skip the first one the cursor hasn't passed
+typedef struct _PositionCursor
+{
+	unsigned char* data;
+	unsigned char* next;
+	unsigned char* end;
+	unsigned int* skips;
+	unsigned int num_skips;
+	unsigned int skip;
+	int document_id;
+	int num_positions;
+	unsigned char* positions;
+	unsigned char* positions_end;
+} __PositionCursor;
+
+typedef struct _PositionCursor PositionCursor;
+
+// initializePositionalIndex returns an empty POSITIONAL_INDEX.
+POSITIONAL_INDEX* initializePositionalIndex(void);
+
+// addPositions adds the positions of every term of a document counted in doc_terms (with
+// recordPositions on) to positional.  Documents must be added in increasing id order.
+void addPositions(POSITIONAL_INDEX* positional, DOC_TERMS* doc_terms, int document_id);
+
+// writePositions saves positional as the positions of index_file_name (through a temporary
+// file that's renamed over the old one).  Returns 0 if it succeeds and 1 if it fails.
+int writePositions(POSITIONAL_INDEX* positional, char* index_file_name);
+
+// cleanPositionalIndex frees positional.
+void cleanPositionalIndex(POSITIONAL_INDEX* positional);
+
+// openPositions maps the positions of index_file_name.  Returns NULL if it has none (or the
+// file is broken).
+POSITIONS_FILE* openPositions(char* index_file_name);
+
+// lookupPositions points cursor before the first document of word.  Returns 1 if word is in
+// positions and 0 if it isn't.
+int lookupPositions(POSITIONS_FILE* positions, char* word, PositionCursor* cursor);
+
+// seekPositions moves cursor forward to document_id, jumping over the skips before it.  Returns 1 if the word occurs in it, and 0
+// if it doesn't (the cursor is then past it, or at the end).
+int seekPositions(PositionCursor* cursor, int document_id);
+
+// readPositions decodes the num_positions positions of the document cursor is at into positions.
+// Returns the number decoded (fewer if the file is damaged).
+int readPositions(PositionCursor* cursor, int* positions);
+
+// closePositions unmaps positions and frees it.
+void closePositions(POSITIONS_FILE* positions);
+
+// removePositions deletes the positions of index_file_name (once they're out of date).  Returns 1
+// if it had any, 0 if not.
+int removePositions(char* index_file_name);
+
+#endif
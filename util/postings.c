@@ -0,0 +1,249 @@
+// Contains the functions for PostingLists: growable, document id sorted
+// arrays of (document id, frequency) pairs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "header.h"
+#include "postings.h"
+
+// Makes sure postings has room for at least capacity postings.
+static void reservePostings(PostingList* postings, int capacity)
+{
+	int new_capacity;
+
+	if(capacity <= postings->capacity)
+		return;
+
+	new_capacity = (postings->capacity > 0) ? postings->capacity : INITIAL_POSTINGS_CAPACITY;
+
+	while(new_capacity < capacity)
+		new_capacity *= 2;
+
+	postings->doc_ids = realloc(postings->doc_ids, new_capacity * sizeof(int));
+	MALLOC_CHECK(postings->doc_ids);
+	postings->frequencies = realloc(postings->frequencies, new_capacity * sizeof(int));
+	MALLOC_CHECK(postings->frequencies);
+
+	postings->capacity = new_capacity;
+}
+
+// Returns an empty PostingList with room for capacity postings.
+PostingList* initializePostings(int capacity)
+{
+	PostingList* postings = malloc(sizeof(PostingList));
+	MALLOC_CHECK(postings);
+	BZERO(postings, sizeof(PostingList));
+
+	if(capacity < INITIAL_POSTINGS_CAPACITY)
+		capacity = INITIAL_POSTINGS_CAPACITY;
+
+	reservePostings(postings, capacity);
+
+	return postings;
+}
+
+// Adds document_id to the end of postings (doubling its arrays when they're full).
+void appendPosting(PostingList* postings, int document_id, int frequency)
+{
+	reservePostings(postings, postings->num_docs + 1);
+
+	postings->doc_ids[postings->num_docs] = document_id;
+	postings->frequencies[postings->num_docs] = frequency;
+	postings->num_docs++;
+}
+
+// Returns the position of document_id in postings (binary search), or -1.
+int findPosting(PostingList* postings, int document_id)
+{
+	int low = 0;
+	int high = postings->num_docs - 1;
+	int middle;
+
+	while(low <= high)
+	{
+		middle = low + (high - low) / 2;
+
+		if(postings->doc_ids[middle] == document_id)
+			return middle;
+		else if(postings->doc_ids[middle] < document_id)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+
+	return -1;
+}
+
+// Returns the position of the first posting from from on with a document id of at least
+// document_id, galloping (1, 2, 4, ... postings ahead) until it's passed and then binary
+// searching the last step.
+int seekPosting(PostingList* postings, int from, int document_id)
+{
+	int low = from;
+	int high;
+	int step = 1;
+	int middle;
+
+	if(from >= postings->num_docs || postings->doc_ids[from] >= document_id)
+		return from;
+
+// doc_ids[low] is always below document_id
+	while(low + step < postings->num_docs && postings->doc_ids[low + step] < document_id)
+	{
+		low += step;
+		step *= 2;
+	}
+
+	high = (low + step < postings->num_docs) ? low + step : postings->num_docs;
+
+// and doc_ids[high] is at least document_id (or high is the end)
+	while(high - low > 1)
+	{
+		middle = low + (high - low) / 2;
+
+		if(postings->doc_ids[middle] < document_id)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	return high;
+}
+
+// Adds frequency occurences of a word in document_id to postings.  The last
+// posting is checked first, since documents are usually indexed in order.
+void addPosting(PostingList* postings, int document_id, int frequency)
+{
+	int last = postings->num_docs - 1;
+	int position;
+
+	if(last < 0 || postings->doc_ids[last] < document_id)
+	{
+		appendPosting(postings, document_id, frequency);
+		return;
+	}
+
+	if(postings->doc_ids[last] == document_id)
+	{
+		postings->frequencies[last] += frequency;
+		return;
+	}
+
+	if((position = findPosting(postings, document_id)) != -1)
+	{
+		postings->frequencies[position] += frequency;
+		return;
+	}
+
+// an out of order document, so it's inserted in its sorted place
+	reservePostings(postings, postings->num_docs + 1);
+
+	for(position = postings->num_docs; position > 0 && postings->doc_ids[position - 1] > document_id; position--)
+	{
+		postings->doc_ids[position] = postings->doc_ids[position - 1];
+		postings->frequencies[position] = postings->frequencies[position - 1];
+	}
+
+	postings->doc_ids[position] = document_id;
+	postings->frequencies[position] = frequency;
+	postings->num_docs++;
+}
+
+// compares two (document id, frequency) pairs by document id for qsort
+static int comparePairs(const void* a, const void* b)
+{
+	int first = ((const int*)a)[0];
+	int second = ((const int*)b)[0];
+
+	return (first > second) - (first < second);
+}
+
+// Sorts postings by document id (only does any work if they're out of order).
+void sortPostings(PostingList* postings)
+{
+	int* pairs;
+	int sorted = 1;
+
+	for(int i = 1; i < postings->num_docs && sorted; i++)
+		if(postings->doc_ids[i - 1] > postings->doc_ids[i])
+			sorted = 0;
+
+	if(sorted)
+		return;
+
+	pairs = malloc(2 * postings->num_docs * sizeof(int));
+	MALLOC_CHECK(pairs);
+
+	for(int i = 0; i < postings->num_docs; i++)
+	{
+		pairs[2 * i] = postings->doc_ids[i];
+		pairs[2 * i + 1] = postings->frequencies[i];
+	}
+
+	qsort(pairs, postings->num_docs, 2 * sizeof(int), comparePairs);
+
+	for(int i = 0; i < postings->num_docs; i++)
+	{
+		postings->doc_ids[i] = pairs[2 * i];
+		postings->frequencies[i] = pairs[2 * i + 1];
+	}
+
+	free(pairs);
+}
+
+// Merges two sorted PostingLists into a new one, like the merge step of a merge sort.
+PostingList* mergePostings(PostingList* first, PostingList* second)
+{
+	PostingList* merged = initializePostings(first->num_docs + second->num_docs);
+	int i = 0;
+	int j = 0;
+	int k = 0;
+
+	while(i < first->num_docs && j < second->num_docs)
+	{
+		if(first->doc_ids[i] < second->doc_ids[j])
+		{
+			merged->doc_ids[k] = first->doc_ids[i];
+			merged->frequencies[k++] = first->frequencies[i++];
+		}
+		else if(first->doc_ids[i] > second->doc_ids[j])
+		{
+			merged->doc_ids[k] = second->doc_ids[j];
+			merged->frequencies[k++] = second->frequencies[j++];
+		}
+		else
+		{
+			merged->doc_ids[k] = first->doc_ids[i];
+			merged->frequencies[k++] = first->frequencies[i++] + second->frequencies[j++];
+		}
+	}
+
+	for(; i < first->num_docs; i++, k++)
+	{
+		merged->doc_ids[k] = first->doc_ids[i];
+		merged->frequencies[k] = first->frequencies[i];
+	}
+
+	for(; j < second->num_docs; j++, k++)
+	{
+		merged->doc_ids[k] = second->doc_ids[j];
+		merged->frequencies[k] = second->frequencies[j];
+	}
+
+	merged->num_docs = k;
+
+	return merged;
+}
+
+// Frees postings and its arrays.
+void cleanPostings(PostingList* postings)
+{
+	if(postings == NULL)
+		return;
+
+	free(postings->doc_ids);
+	free(postings->frequencies);
+	free(postings);
+}
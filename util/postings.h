@@ -0,0 +1,54 @@
+#ifndef _POSTINGS_H_
+#define _POSTINGS_H_
+
+// number of postings a new PostingList has room for before it first grows
+#define INITIAL_POSTINGS_CAPACITY 2
+
+// contains the PostingList structure (the data of every WordNode in an index)
+// num_docs is the number of documents the word occurs in (its document frequency)
+// capacity is how many postings fit before doc_ids and frequencies must grow
+// doc_ids holds the id of each document, sorted from lowest to highest
+// frequencies[i] is the number of times the word occurs in document doc_ids[i]
+// a PostingList with capacity 0 is a read-only view of arrays it doesn't own (e.g. postings
+// in a mapped index, see mapindex.h), and can't be added to or cleaned
+typedef struct _PostingList
+{
+	int num_docs;
+	int capacity;
+	int* doc_ids;
+	int* frequencies;
+} __PostingList;
+
+typedef struct _PostingList PostingList;
+
+// initializePostings returns an empty PostingList with room for capacity postings.
+PostingList* initializePostings(int capacity);
+
+// addPosting adds frequency occurences of a word in document_id to postings, keeping
+// doc_ids sorted.  Adding to the last document or appending a higher document_id
+// (the indexer's case) takes amortized constant time.
+void addPosting(PostingList* postings, int document_id, int frequency);
+
+// appendPosting adds document_id to the end of postings without checking order.
+// Callers that might append out of order call sortPostings afterwards.
+void appendPosting(PostingList* postings, int document_id, int frequency);
+
+// sortPostings sorts postings by document id.
+void sortPostings(PostingList* postings);
+
+// findPosting returns the position of document_id in postings, or -1 if it isn't there.
+int findPosting(PostingList* postings, int document_id);
+
+// seekPosting returns the position of the first posting at or after from whose document id is at
+// least document_id (num_docs if there isn't one).  It gallops ahead from from in doubling steps
+// and then binary searches, so skipping n postings takes O(log n) time.
+int seekPosting(PostingList* postings, int from, int document_id);
+
+// mergePostings returns a new PostingList holding the postings of both first and second
+// (adding the frequencies of documents in both).  Neither argument is changed.
+PostingList* mergePostings(PostingList* first, PostingList* second);
+
+// cleanPostings frees postings and the arrays it contains.
+void cleanPostings(PostingList* postings);
+
+#endif
@@ -0,0 +1,167 @@
+// Contains the functions that read and write the segment list of an index
+// file (see segments.h for the format).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "header.h"
+#include "segments.h"
+
+// Returns the name of the segment list of index_file_name (malloced).
+static char* segmentListName(char* index_file_name)
+{
+	char* name = malloc(strlen(index_file_name) + strlen(SEGMENTS_SUFFIX) + 1);
+
+	MALLOC_CHECK(name);
+	sprintf(name, "%s%s", index_file_name, SEGMENTS_SUFFIX);
+
+	return name;
+}
+
+char* segmentName(char* index_file_name, int number)
+{
+	char* name = malloc(strlen(index_file_name) + 13);
+
+	MALLOC_CHECK(name);
+	sprintf(name, "%s.%d", index_file_name, number);
+
+	return name;
+}
+
+SEGMENT_LIST* initializeSegmentList(void)
+{
+	SEGMENT_LIST* list = malloc(sizeof(SEGMENT_LIST));
+
+	MALLOC_CHECK(list);
+	list->high_water_mark = 0;
+	list->next_number = 1;
+	list->num_segments = 0;
+	list->capacity = 0;
+	list->numbers = NULL;
+
+	return list;
+}
+
+void addSegment(SEGMENT_LIST* list, int number)
+{
+	if(list->num_segments == list->capacity)
+	{
+		list->capacity = list->capacity * 2 + 8;
+		list->numbers = realloc(list->numbers, list->capacity * sizeof(int));
+		MALLOC_CHECK(list->numbers);
+	}
+
+	list->numbers[list->num_segments++] = number;
+
+	if(number >= list->next_number)
+		list->next_number = number + 1;
+}
+
+SEGMENT_LIST* readSegmentList(char* index_file_name)
+{
+	char* name = segmentListName(index_file_name);
+	FILE* fp = fopen(name, "r");
+	SEGMENT_LIST* list;
+	char magic[16];
+	int version;
+	int number;
+
+	free(name);
+
+	if(fp == NULL)
+		return NULL;
+
+	list = initializeSegmentList();
+
+	if(fscanf(fp, "%15s %d high_water_mark %d next %d", magic, &version, &list->high_water_mark, &list->next_number) != 4 ||
+		strcmp(magic, SEGMENTS_MAGIC) != 0 || version != SEGMENTS_VERSION)
+	{
+		fclose(fp);
+		cleanSegmentList(list);
+		return NULL;
+	}
+
+	while(fscanf(fp, "%d", &number) == 1)
+		addSegment(list, number);
+
+	if(!feof(fp))
+	{
+		fclose(fp);
+		cleanSegmentList(list);
+		return NULL;
+	}
+
+	fclose(fp);
+
+	return list;
+}
+
+// Writes the list through a temporary file that's renamed over the old one.
+int writeSegmentList(SEGMENT_LIST* list, char* index_file_name)
+{
+	char* name = segmentListName(index_file_name);
+	char* temporary_name = malloc(strlen(name) + 5);
+	FILE* fp;
+	int failed;
+
+	MALLOC_CHECK(temporary_name);
+	sprintf(temporary_name, "%s.new", name);
+
+	if((fp = fopen(temporary_name, "w")) == NULL)
+	{
+		free(temporary_name);
+		free(name);
+		return 1;
+	}
+
+	fprintf(fp, "%s %d\nhigh_water_mark %d\nnext %d\n", SEGMENTS_MAGIC, SEGMENTS_VERSION, list->high_water_mark, list->next_number);
+
+	for(int i = 0; i < list->num_segments; i++)
+		fprintf(fp, "%d\n", list->numbers[i]);
+
+	failed = (ferror(fp) != 0);
+	failed |= (fclose(fp) != 0);
+	failed = failed || (rename(temporary_name, name) != 0);
+
+	if(failed)
+		unlink(temporary_name);
+
+	free(temporary_name);
+	free(name);
+
+	return failed;
+}
+
+void removeSegments(char* index_file_name)
+{
+	SEGMENT_LIST* list = readSegmentList(index_file_name);
+	char* name;
+
+	if(list == NULL)
+		return;
+
+// the list goes first, so nothing is left listing a missing segment
+	name = segmentListName(index_file_name);
+	unlink(name);
+	free(name);
+
+	for(int i = 0; i < list->num_segments; i++)
+	{
+		name = segmentName(index_file_name, list->numbers[i]);
+		unlink(name);
+		free(name);
+	}
+
+	cleanSegmentList(list);
+}
+
+void cleanSegmentList(SEGMENT_LIST* list)
+{
+	free(list->numbers);
+	free(list);
+}
@@ -0,0 +1,60 @@
+#ifndef _SEGMENTS_H_
+#define _SEGMENTS_H_
+
+// The SEGMENTS of an index file are mapped index files (see mapindex.h) holding
+// documents indexed after it, written by the query engine's live index (see
+// ../queryengine/live.c).  Segment n of INDEX is the file INDEX.n, and the ones
+// in use are listed in INDEX.segments, oldest (lowest document ids) first:
+//
+//	segments 1
+//	high_water_mark 2107		(the highest document id in any segment)
+//	next 9				(the number the next segment gets)
+//	3
+//	8
+//
+// A segment never changes once it's written.  New segments, and the segment
+// that replaces several merged ones, are written first and then the list is
+// replaced (through a rename), so a reader always sees a whole list of whole
+// segments.  The query engine searches INDEX and then each segment.
+
+#define SEGMENTS_SUFFIX ".segments"
+#define SEGMENTS_MAGIC "segments"
+#define SEGMENTS_VERSION 1
+
+// the segments of an index file
+typedef struct _SEGMENT_LIST
+{
+	int high_water_mark;
+	int next_number;
+	int num_segments;
+	int capacity;
+	int* numbers;
+} __SEGMENT_LIST;
+
+typedef struct _SEGMENT_LIST SEGMENT_LIST;
+
+// initializeSegmentList returns an empty list.
+SEGMENT_LIST* initializeSegmentList(void);
+
+// readSegmentList reads the segments of index_file_name.  Returns NULL if it has none
+// (or the list is broken).
+SEGMENT_LIST* readSegmentList(char* index_file_name);
+
+// writeSegmentList saves list as the segments of index_file_name.  Returns 0 if it
+// succeeds and 1 if it fails.
+int writeSegmentList(SEGMENT_LIST* list, char* index_file_name);
+
+// addSegment adds segment number to the end of list.
+void addSegment(SEGMENT_LIST* list, int number);
+
+// segmentName returns the file name of segment number of index_file_name (malloced).
+char* segmentName(char* index_file_name, int number);
+
+// removeSegments deletes every segment of index_file_name and its list (once the index
+// itself holds their documents).
+void removeSegments(char* index_file_name);
+
+// cleanSegmentList frees list.
+void cleanSegmentList(SEGMENT_LIST* list);
+
+#endif
@@ -0,0 +1,363 @@
+// Contains the scanning loops of the TOKENIZER, in scalar, SSE2 and AVX2
+// versions (see textscan.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "textscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TEXT_SCAN_X86
+#include <immintrin.h>
+#endif
+
+// ---------------------
+// ---- SCALAR SCANS ----
+// ---------------------
+
+// returns 1 if c is an ASCII letter
+static inline int isLetter(char c)
+{
+	return (unsigned char)((c | 32) - 'a') < 26;
+}
+
+// returns c lower cased the way NormalizeWord does it
+static inline char lowerCase(char c)
+{
+	return (c < 91 && c > 64) ? c + 32 : c;
+}
+
+static char* findCharScalar(char* position, char* end, char c)
+{
+	while(position < end && *position != c && *position != 0)
+		position++;
+
+	return position;
+}
+
+static char* findTextStartScalar(char* position, char* end)
+{
+	while(position < end && *position != '<' && *position != 0 && !isLetter(*position))
+		position++;
+
+	return position;
+}
+
+static char* findWordEndScalar(char* position, char* end, char* lower)
+{
+	if(lower == NULL)
+	{
+		while(position < end && (isLetter(*position) || *position == '>'))
+			position++;
+
+		return position;
+	}
+
+	while(position < end && (isLetter(*position) || *position == '>'))
+		*lower++ = lowerCase(*position++);
+
+	return position;
+}
+
+static void lowercaseCopyScalar(char* to, char* from, int length)
+{
+	for(int i = 0; i < length; i++)
+		to[i] = lowerCase(from[i]);
+}
+
+#ifdef TEXT_SCAN_X86
+
+// -------------------
+// ---- SSE2 SCANS ----
+// -------------------
+
+// returns 0xff in every byte of chars that's a letter.  Bytes over 127 stay negative
+// after or-ing in the lower case bit, so they fail the signed comparison with 'a' - 1.
+static inline __m128i lettersSSE2(__m128i chars)
+{
+	__m128i folded = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+
+	return _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+}
+
+// returns chars with 'A' to 'Z' lower cased
+static inline __m128i lowerCaseSSE2(__m128i chars)
+{
+	__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('Z' + 1)));
+
+	return _mm_add_epi8(chars, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static char* findCharSSE2(char* position, char* end, char c)
+{
+	__m128i chars;
+	unsigned int mask;
+
+	while(end - position >= 16)
+	{
+		chars = _mm_loadu_si128((__m128i*)position);
+		mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(c)), _mm_cmpeq_epi8(chars, _mm_setzero_si128())));
+
+		if(mask != 0)
+			return position + __builtin_ctz(mask);
+
+		position += 16;
+	}
+
+	return findCharScalar(position, end, c);
+}
+
+static char* findTextStartSSE2(char* position, char* end)
+{
+	__m128i chars;
+	unsigned int mask;
+
+	while(end - position >= 16)
+	{
+		chars = _mm_loadu_si128((__m128i*)position);
+		mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('<')),
+			_mm_cmpeq_epi8(chars, _mm_setzero_si128())), lettersSSE2(chars)));
+
+		if(mask != 0)
+			return position + __builtin_ctz(mask);
+
+		position += 16;
+	}
+
+	return findTextStartScalar(position, end);
+}
+
+static char* findWordEndSSE2(char* position, char* end, char* lower)
+{
+	__m128i chars;
+	unsigned int mask;
+
+	while(end - position >= 16)
+	{
+		chars = _mm_loadu_si128((__m128i*)position);
+
+		if(lower != NULL)
+		{
+			_mm_storeu_si128((__m128i*)lower, lowerCaseSSE2(chars));
+			lower += 16;
+		}
+
+		mask = ~_mm_movemask_epi8(_mm_or_si128(lettersSSE2(chars), _mm_cmpeq_epi8(chars, _mm_set1_epi8('>')))) & 0xffff;
+
+		if(mask != 0)
+			return position + __builtin_ctz(mask);
+
+		position += 16;
+	}
+
+	return findWordEndScalar(position, end, lower);
+}
+
+static void lowercaseCopySSE2(char* to, char* from, int length)
+{
+	int i;
+
+	for(i = 0; i + 16 <= length; i += 16)
+		_mm_storeu_si128((__m128i*)(to + i), lowerCaseSSE2(_mm_loadu_si128((__m128i*)(from + i))));
+
+	lowercaseCopyScalar(to + i, from + i, length - i);
+}
+
+// -------------------
+// ---- AVX2 SCANS ----
+// -------------------
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i lettersAVX2(__m256i chars)
+{
+	__m256i folded = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+
+	return _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+}
+
+AVX2 static inline __m256i lowerCaseAVX2(__m256i chars)
+{
+	__m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), chars));
+
+	return _mm256_add_epi8(chars, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+AVX2 static char* findCharAVX2(char* position, char* end, char c)
+{
+	__m256i chars;
+	unsigned int mask;
+
+	while(end - position >= 32)
+	{
+		chars = _mm256_loadu_si256((__m256i*)position);
+		mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c)), _mm256_cmpeq_epi8(chars, _mm256_setzero_si256())));
+
+		if(mask != 0)
+			return position + __builtin_ctz(mask);
+
+		position += 32;
+	}
+
+	return findCharSSE2(position, end, c);
+}
+
+AVX2 static char* findTextStartAVX2(char* position, char* end)
+{
+	__m256i chars;
+	unsigned int mask;
+
+	while(end - position >= 32)
+	{
+		chars = _mm256_loadu_si256((__m256i*)position);
+		mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('<')),
+			_mm256_cmpeq_epi8(chars, _mm256_setzero_si256())), lettersAVX2(chars)));
+
+		if(mask != 0)
+			return position + __builtin_ctz(mask);
+
+		position += 32;
+	}
+
+	return findTextStartSSE2(position, end);
+}
+
+AVX2 static char* findWordEndAVX2(char* position, char* end, char* lower)
+{
+	__m256i chars;
+	unsigned int mask;
+
+	while(end - position >= 32)
+	{
+		chars = _mm256_loadu_si256((__m256i*)position);
+
+		if(lower != NULL)
+		{
+			_mm256_storeu_si256((__m256i*)lower, lowerCaseAVX2(chars));
+			lower += 32;
+		}
+
+		mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_or_si256(lettersAVX2(chars), _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('>'))));
+
+		if(mask != 0)
+			return position + __builtin_ctz(mask);
+
+		position += 32;
+	}
+
+	return findWordEndSSE2(position, end, lower);
+}
+
+AVX2 static void lowercaseCopyAVX2(char* to, char* from, int length)
+{
+	int i;
+
+	for(i = 0; i + 32 <= length; i += 32)
+		_mm256_storeu_si256((__m256i*)(to + i), lowerCaseAVX2(_mm256_loadu_si256((__m256i*)(from + i))));
+
+	lowercaseCopySSE2(to + i, from + i, length - i);
+}
+
+#endif
+
+// ------------------
+// ---- DISPATCH ----
+// ------------------
+
+// the scans of one level
+typedef struct _TextScans
+{
+	int level;
+	char* (*char_scan)(char*, char*, char);
+	char* (*text_start_scan)(char*, char*);
+	char* (*word_end_scan)(char*, char*, char*);
+	void (*lowercase_copy)(char*, char*, int);
+} __TextScans;
+
+typedef struct _TextScans TextScans;
+
+static const TextScans scalar_scans = { TEXT_SCAN_SCALAR, findCharScalar, findTextStartScalar, findWordEndScalar, lowercaseCopyScalar };
+
+#ifdef TEXT_SCAN_X86
+static const TextScans sse2_scans = { TEXT_SCAN_SSE2, findCharSSE2, findTextStartSSE2, findWordEndSSE2, lowercaseCopySSE2 };
+static const TextScans avx2_scans = { TEXT_SCAN_AVX2, findCharAVX2, findTextStartAVX2, findWordEndAVX2, lowercaseCopyAVX2 };
+#endif
+
+// the scans in use, swapped whole with an atomic store, so the level can be changed while other
+// threads are scanning (each scan uses one level or the other, never a mix)
+static const TextScans* scans = &scalar_scans;
+
+static pthread_once_t scan_once = PTHREAD_ONCE_INIT;
+
+// Points the scans at the versions for level, or the best level below it the processor supports.
+static int useTextScanLevel(int level)
+{
+	const TextScans* chosen = &scalar_scans;
+
+#ifdef TEXT_SCAN_X86
+	__builtin_cpu_init();
+
+	if(level >= TEXT_SCAN_AVX2 && __builtin_cpu_supports("avx2"))
+		chosen = &avx2_scans;
+	else if(level >= TEXT_SCAN_SSE2 && __builtin_cpu_supports("sse2"))
+		chosen = &sse2_scans;
+#endif
+
+	__atomic_store_n(&scans, chosen, __ATOMIC_RELEASE);
+
+	return chosen->level;
+}
+
+// Picks SSE2 if the processor supports it (run once, before the first scan).  AVX2 is slower
+// on real pages (see ../bench/tokenizer_bench.c), whose runs between tags and words are
+// mostly too short for 32 characters at a time to pay, so it's only used if it's asked for.
+static void chooseTextScanLevel()
+{
+	useTextScanLevel(TEXT_SCAN_SSE2);
+}
+
+// Returns the scans in use, picking them the first time.
+static inline const TextScans* currentScans()
+{
+	pthread_once(&scan_once, chooseTextScanLevel);
+
+	return __atomic_load_n(&scans, __ATOMIC_ACQUIRE);
+}
+
+int setTextScanLevel(int level)
+{
+	pthread_once(&scan_once, chooseTextScanLevel);
+
+	return useTextScanLevel(level);
+}
+
+int textScanLevel()
+{
+	return currentScans()->level;
+}
+
+char* findTagEnd(char* position, char* end)
+{
+	return currentScans()->char_scan(position, end, '>');
+}
+
+char* findTagStart(char* position, char* end)
+{
+	return currentScans()->char_scan(position, end, '<');
+}
+
+char* findTextStart(char* position, char* end)
+{
+	return currentScans()->text_start_scan(position, end);
+}
+
+char* findWordEnd(char* position, char* end, char* lower)
+{
+	return currentScans()->word_end_scan(position, end, lower);
+}
+
+void lowercaseCopy(char* to, char* from, int length)
+{
+	currentScans()->lowercase_copy(to, from, length);
+}
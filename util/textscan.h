@@ -0,0 +1,43 @@
+#ifndef _TEXTSCAN_H_
+#define _TEXTSCAN_H_
+
+// The scanning loops of the TOKENIZER (see html.h), which look at 16 (SSE2) or
+// 32 (AVX2) characters at a time when the processor can.  SSE2 is picked the
+// first time one of them is used, if the processor supports it (AVX2 is slower
+// on real pages, so it's only used through setTextScanLevel); every level finds
+// exactly the same positions.
+//
+// A letter is an ASCII letter (what isalpha is in the C locale) and lower
+// casing only changes 'A' to 'Z', like NormalizeWord.  Every scan stops at end
+// or at a NUL, whichever comes first.
+
+#define TEXT_SCAN_SCALAR 0
+#define TEXT_SCAN_SSE2 1
+#define TEXT_SCAN_AVX2 2
+
+// setTextScanLevel makes the scans use level (or the best level under it the
+// processor supports), even while other threads are scanning.  Returns the
+// level they'll use.
+int setTextScanLevel(int level);
+
+// textScanLevel returns the level the scans use.
+int textScanLevel();
+
+// findTagEnd returns the first '>' or NUL at or after position, or end.
+char* findTagEnd(char* position, char* end);
+
+// findTagStart returns the first '<' or NUL at or after position, or end.
+char* findTagStart(char* position, char* end);
+
+// findTextStart returns the first '<', letter or NUL at or after position, or end.
+char* findTextStart(char* position, char* end);
+
+// findWordEnd returns the first character at or after position that's neither a letter
+// nor a '>', or end.  If lower isn't NULL, the characters before it are copied there,
+// lower cased, on the way (lower needs room for 32 characters more than that).
+char* findWordEnd(char* position, char* end, char* lower);
+
+// lowercaseCopy copies length characters from from to to, lower casing them.
+void lowercaseCopy(char* to, char* from, int length);
+
+#endif
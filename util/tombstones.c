@@ -0,0 +1,223 @@
+// Contains the functions that read and change the deleted documents of an index
+// file (see tombstones.h for the format).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "header.h"
+#include "tombstones.h"
+
+// Returns the name of the tombstones file of index_file_name (malloced).
+static char* tombstonesName(char* index_file_name)
+{
+	char* name = malloc(strlen(index_file_name) + strlen(TOMBSTONES_SUFFIX) + 1);
+
+	MALLOC_CHECK(name);
+	sprintf(name, "%s%s", index_file_name, TOMBSTONES_SUFFIX);
+
+	return name;
+}
+
+// Waits for a lock of the given type (F_RDLCK or F_WRLCK) on the whole open file fd, so a delete
+// and a compaction don't lose each other's changes.  It's let go when fd is closed.
+static int lockFile(int fd, int type)
+{
+	struct flock lock;
+
+	BZERO(&lock, sizeof(lock));
+	lock.l_type = type;
+	lock.l_whence = SEEK_SET;
+
+	return fcntl(fd, F_SETLKW, &lock);
+}
+
+// Reads the bits of the open (and locked) tombstones file fd into tombstones.  Returns 0 if it
+// succeeds and 1 if the file can't be read or isn't a tombstones file.
+static int readBits(int fd, TOMBSTONES* tombstones)
+{
+	char magic[TOMBSTONES_HEADER_LENGTH];
+	struct stat s;
+	long total = 0;
+	ssize_t bytes;
+
+	if(fstat(fd, &s) != 0 || s.st_size < TOMBSTONES_HEADER_LENGTH)
+		return 1;
+
+	if(pread(fd, magic, TOMBSTONES_HEADER_LENGTH, 0) != TOMBSTONES_HEADER_LENGTH ||
+		memcmp(magic, TOMBSTONES_MAGIC, TOMBSTONES_HEADER_LENGTH) != 0)
+		return 1;
+
+	tombstones->num_bytes = s.st_size - TOMBSTONES_HEADER_LENGTH;
+	tombstones->bits = malloc(tombstones->num_bytes + 1);
+	MALLOC_CHECK(tombstones->bits);
+
+	while(total < tombstones->num_bytes)
+	{
+		if((bytes = pread(fd, tombstones->bits + total, tombstones->num_bytes - total, TOMBSTONES_HEADER_LENGTH + total)) <= 0)
+		{
+			free(tombstones->bits);
+			return 1;
+		}
+
+		total += bytes;
+	}
+
+	tombstones->num_deleted = 0;
+
+	for(long i = 0; i < tombstones->num_bytes; i++)
+	{
+		for(unsigned char byte = tombstones->bits[i]; byte != 0; byte &= byte - 1)
+			tombstones->num_deleted++;
+	}
+
+	return 0;
+}
+
+TOMBSTONES* readTombstones(char* index_file_name)
+{
+	char* name = tombstonesName(index_file_name);
+	TOMBSTONES* tombstones;
+	int fd = open(name, O_RDONLY);
+	int failed;
+
+	free(name);
+
+	if(fd == -1)
+		return NULL;
+
+	tombstones = malloc(sizeof(TOMBSTONES));
+	MALLOC_CHECK(tombstones);
+
+	failed = (lockFile(fd, F_RDLCK) != 0 || readBits(fd, tombstones) != 0);
+	close(fd);
+
+	if(failed)
+	{
+		free(tombstones);
+		return NULL;
+	}
+
+	if(tombstones->num_deleted == 0)
+	{
+		cleanTombstones(tombstones);
+		return NULL;
+	}
+
+	return tombstones;
+}
+
+// Sets doc_id's bit with a one byte read and write, starting the file if it's new.
+int deleteDocument(char* index_file_name, int doc_id)
+{
+	char* name = tombstonesName(index_file_name);
+	char magic[TOMBSTONES_HEADER_LENGTH];
+	unsigned char byte = 0;
+	off_t offset = TOMBSTONES_HEADER_LENGTH + (off_t)(doc_id / 8);
+	struct stat s;
+	int fd;
+	int failed;
+
+	if(doc_id < 0)
+	{
+		free(name);
+		return 1;
+	}
+
+	fd = open(name, O_RDWR | O_CREAT, 0644);
+	free(name);
+
+	if(fd == -1)
+		return 1;
+
+	failed = (lockFile(fd, F_WRLCK) != 0 || fstat(fd, &s) != 0);
+
+	if(!failed && s.st_size < TOMBSTONES_HEADER_LENGTH)
+		failed = (pwrite(fd, TOMBSTONES_MAGIC, TOMBSTONES_HEADER_LENGTH, 0) != TOMBSTONES_HEADER_LENGTH);
+	else if(!failed)
+		failed = (pread(fd, magic, TOMBSTONES_HEADER_LENGTH, 0) != TOMBSTONES_HEADER_LENGTH ||
+			memcmp(magic, TOMBSTONES_MAGIC, TOMBSTONES_HEADER_LENGTH) != 0);
+
+// past the end of the file, no document in the byte has been deleted yet
+	if(!failed)
+		failed = (pread(fd, &byte, 1, offset) < 0);
+
+	if(!failed)
+	{
+		byte |= 1 << (doc_id % 8);
+		failed = (pwrite(fd, &byte, 1, offset) != 1);
+	}
+
+	failed |= (close(fd) != 0);
+
+	return failed;
+}
+
+// Rewrites the bits in place (rather than through a new file), so a delete waiting on the lock
+// still writes to the file that's kept.
+int clearTombstones(char* index_file_name, TOMBSTONES* compacted)
+{
+	char* name = tombstonesName(index_file_name);
+	TOMBSTONES current;
+	long length;
+	int fd = open(name, O_RDWR);
+	int failed;
+
+	free(name);
+
+	if(fd == -1)
+		return 0;
+
+	if(lockFile(fd, F_WRLCK) != 0 || readBits(fd, &current) != 0)
+	{
+		close(fd);
+		return 1;
+	}
+
+	for(long i = 0; i < current.num_bytes && i < compacted->num_bytes; i++)
+		current.bits[i] &= ~compacted->bits[i];
+
+	for(length = current.num_bytes; length > 0 && current.bits[length - 1] == 0; length--)
+		;
+
+	failed = (length > 0 && pwrite(fd, current.bits, length, TOMBSTONES_HEADER_LENGTH) != length);
+	failed = failed || (ftruncate(fd, TOMBSTONES_HEADER_LENGTH + length) != 0);
+	failed |= (close(fd) != 0);
+
+	free(current.bits);
+
+	return failed;
+}
+
+void keepTombstones(TOMBSTONES* tombstones, char* documents, int highest)
+{
+	for(long doc_id = 0; doc_id < 8 * tombstones->num_bytes; doc_id++)
+	{
+		if((doc_id > highest || !documents[doc_id]) && isTombstoned(tombstones, doc_id))
+		{
+			tombstones->bits[doc_id / 8] &= ~(1 << (doc_id % 8));
+			tombstones->num_deleted--;
+		}
+	}
+}
+
+void removeTombstones(char* index_file_name)
+{
+	char* name = tombstonesName(index_file_name);
+
+	unlink(name);
+	free(name);
+}
+
+void cleanTombstones(TOMBSTONES* tombstones)
+{
+	free(tombstones->bits);
+	free(tombstones);
+}
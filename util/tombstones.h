@@ -0,0 +1,59 @@
+#ifndef _TOMBSTONES_H_
+#define _TOMBSTONES_H_
+
+// The TOMBSTONES of an index file are the documents deleted from it since it was
+// written, kept next to it in [INDEX FILE].deleted as one bit per document id.
+// Deleting a document sets its bit in place, which costs the same however big the
+// index is.  The query engine loads the bits along with the index and leaves
+// deleted documents out of every result, and compacting the index (see
+// ../index/compact.c) drops their postings for good and clears their bits.
+//
+//	header		"TSED"
+//	bits		byte i holds documents 8i to 8i+7, lowest bit first
+//			(the file is only as long as the highest deleted id needs)
+
+#define TOMBSTONES_SUFFIX ".deleted"
+#define TOMBSTONES_MAGIC "TSED"
+#define TOMBSTONES_HEADER_LENGTH 4
+
+// the deleted documents of an index file
+// bits has num_bytes bytes (so covers document ids below 8 * num_bytes), num_deleted bits are set
+typedef struct _TOMBSTONES
+{
+	unsigned char* bits;
+	long num_bytes;
+	long num_deleted;
+} __TOMBSTONES;
+
+typedef struct _TOMBSTONES TOMBSTONES;
+
+// isTombstoned is 1 if doc_id is deleted in tombstones (which mustn't be NULL), 0 if not
+#define isTombstoned(tombstones, doc_id) \
+	((doc_id) >= 0 && (doc_id) / 8 < (tombstones)->num_bytes && \
+	 ((tombstones)->bits[(doc_id) / 8] >> ((doc_id) % 8) & 1))
+
+// readTombstones reads the deleted documents of index_file_name.  Returns NULL if none are
+// deleted (or the file isn't a tombstones file).
+TOMBSTONES* readTombstones(char* index_file_name);
+
+// deleteDocument marks doc_id deleted in index_file_name, without reading the index or the other
+// tombstones.  Returns 0 if it succeeds and 1 if it fails.
+int deleteDocument(char* index_file_name, int doc_id);
+
+// clearTombstones undeletes the documents in compacted (once their postings have been dropped from
+// index_file_name), keeping any deleted since compacted was read.  Returns 0 if it succeeds and 1 if
+// it fails.
+int clearTombstones(char* index_file_name, TOMBSTONES* compacted);
+
+// keepTombstones unsets every bit in tombstones but those of the documents marked in documents
+// (indexed by doc id, up to highest), e.g. before clearTombstones undeletes only the documents whose
+// postings were dropped.
+void keepTombstones(TOMBSTONES* tombstones, char* documents, int highest);
+
+// removeTombstones undeletes every document of index_file_name (after it's been rebuilt).
+void removeTombstones(char* index_file_name);
+
+// cleanTombstones frees tombstones.
+void cleanTombstones(TOMBSTONES* tombstones);
+
+#endif
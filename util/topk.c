@@ -0,0 +1,120 @@
+// Contains the TOP_K functions, which keep the best k results of a query in a
+// bounded heap (see topk.h).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "header.h"
+#include "dictionary.h"
+#include "topk.h"
+
+// Returns 1 if a ranks ahead of b: a higher rank, or the same rank and a lower document id.
+int betterResult(DocumentNode* a, DocumentNode* b)
+{
+	if(a->page_word_frequency != b->page_word_frequency)
+		return a->page_word_frequency > b->page_word_frequency;
+
+	return a->document_id < b->document_id;
+}
+
+// Returns an empty TOP_K with room for k results.
+TOP_K* initializeTopK(int k)
+{
+	TOP_K* top = malloc(sizeof(TOP_K));
+
+	MALLOC_CHECK(top);
+
+	top->k = (k > 0) ? k : 1;
+	top->size = 0;
+	top->heap = malloc(top->k * sizeof(DocumentNode));
+	MALLOC_CHECK(top->heap);
+
+	return top;
+}
+
+// Moves the result at i down the heap until neither of its children is worse than it.
+static void siftDown(TOP_K* top, int i)
+{
+	DocumentNode moved = top->heap[i];
+	int child;
+
+	while((child = 2 * i + 1) < top->size)
+	{
+// the worse of the two children
+		if(child + 1 < top->size && betterResult(&top->heap[child], &top->heap[child + 1]))
+			child++;
+
+		if(!betterResult(&moved, &top->heap[child]))
+			break;
+
+		top->heap[i] = top->heap[child];
+		i = child;
+	}
+
+	top->heap[i] = moved;
+}
+
+// Keeps (document_id, rank) if there's room, or if it's better than the worst result kept
+// (which it then replaces).
+void offerTopK(TOP_K* top, int document_id, int rank)
+{
+	DocumentNode offered;
+	int i;
+
+	offered.document_id = document_id;
+	offered.page_word_frequency = rank;
+
+	if(top->size == top->k)
+	{
+		if(!betterResult(&offered, &top->heap[0]))
+			return;
+
+		top->heap[0] = offered;
+		siftDown(top, 0);
+		return;
+	}
+
+// moves it up from the bottom while it's worse than its parent
+	for(i = top->size++; i > 0 && betterResult(&top->heap[(i - 1) / 2], &offered); i = (i - 1) / 2)
+		top->heap[i] = top->heap[(i - 1) / 2];
+
+	top->heap[i] = offered;
+}
+
+// Takes the worst result off the heap repeatedly, filling sorted from the back.
+int finishTopK(TOP_K* top, DocumentNode* sorted)
+{
+	int num_results = top->size;
+
+	while(top->size > 0)
+	{
+		sorted[top->size - 1] = top->heap[0];
+		top->heap[0] = top->heap[--(top->size)];
+		siftDown(top, 0);
+	}
+
+	return num_results;
+}
+
+// qsort's comparison for sortDocuments.
+static int compareResults(const void* a, const void* b)
+{
+	if(betterResult((DocumentNode*)a, (DocumentNode*)b))
+		return -1;
+
+	return betterResult((DocumentNode*)b, (DocumentNode*)a);
+}
+
+// Sorts every result, best first.
+void sortDocuments(DocumentNode* results, int num_results)
+{
+	qsort(results, num_results, sizeof(DocumentNode), compareResults);
+}
+
+// Frees top.
+void cleanTopK(TOP_K* top)
+{
+	free(top->heap);
+	free(top);
+}
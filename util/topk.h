@@ -0,0 +1,44 @@
+#ifndef _TOPK_H_
+#define _TOPK_H_
+
+// A TOP_K keeps the k best of the DocumentNodes offered to it (a query's
+// results, see dictionary.h), so ranking n results takes O(n log k) time and
+// O(k) memory instead of sorting all of them.  It's a min-heap of size k: the
+// worst result kept is at the top, and a new one only goes in if it's better.
+//
+// "Better" is the same order everywhere: a higher page_word_frequency (rank)
+// first, and between equal ranks the lower document_id, so the results of a
+// query come out in the same order every time, whichever way they're found.
+
+#include "dictionary.h"
+
+typedef struct _TOP_K
+{
+	DocumentNode* heap;
+	int size;
+	int k;
+} __TOP_K;
+
+typedef struct _TOP_K TOP_K;
+
+// betterResult is 1 if a ranks ahead of b, 0 if not.
+int betterResult(DocumentNode* a, DocumentNode* b);
+
+// initializeTopK returns an empty TOP_K keeping the best k (at least 1) results.
+TOP_K* initializeTopK(int k);
+
+// offerTopK offers the result (document_id, rank), keeping it if it's among the best k so far.
+void offerTopK(TOP_K* top, int document_id, int rank);
+
+// finishTopK writes the results kept in top into sorted, best first, and empties top.
+// Returns the number written (at most k).
+int finishTopK(TOP_K* top, DocumentNode* sorted);
+
+// sortDocuments sorts the num_results results in results, best first (a full sort, for when
+// every result is wanted).
+void sortDocuments(DocumentNode* results, int num_results);
+
+// cleanTopK frees top.
+void cleanTopK(TOP_K* top);
+
+#endif